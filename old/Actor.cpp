@@ -1,13 +1,23 @@
 #include "Actor.hpp"
 #include <QGLWidget>
 
-Actor::Actor() : mNextActor(0), mPreviousActor(0)
+Actor::Actor(TransformHierarchy& inHierarchy)
+    : mHierarchy(inHierarchy), mNode(inHierarchy.createNode()),
+      mNextActor(0), mPreviousActor(0)
+{
+}
+
+Actor::Actor(Actor& inParent)
+    : mHierarchy(inParent.mHierarchy),
+      mNode(inParent.mHierarchy.createNode(inParent.mNode)),
+      mNextActor(0), mPreviousActor(0)
 {
 }
 
 Actor::~Actor()
 {
     removeFromChain();
+    mHierarchy.destroyNode(mNode);
 }
 
 void Actor::draw()
@@ -1,21 +1,50 @@
 #ifndef ACTOR_HPP
 #define ACTOR_HPP
 
-#include "SceneGraphNode.hpp"
+#include "TransformHierarchy.hpp"
 
-class Actor : public SceneGraphNode
+/// Each actor is a node in a TransformHierarchy. Root actors are given the
+/// hierarchy; every other actor is created as the child of another and ends
+/// up in the same one.
+class Actor
 {
 public:
-    Actor();
+    explicit Actor(TransformHierarchy& inHierarchy);
+    explicit Actor(Actor& inParent);
     virtual ~Actor();
 
     virtual void draw();
 
+    inline const mat4f& modelMatrix() const
+    {
+        return mHierarchy.modelMatrix(mNode);
+    }
+
+    inline const mat4f& modelViewMatrix() const
+    {
+        return mHierarchy.modelViewMatrix(mNode);
+    }
+
     void addToChain(Actor& inActor);
     void removeFromChain();
     void drawChain();
 
+protected:
+    inline const mat4f& localMatrix() const
+    {
+        return mHierarchy.localMatrix(mNode);
+    }
+
+    /// Only call this when the matrix actually changes, since it marks the
+    /// node dirty.
+    inline void setLocalMatrix(const mat4f& inMatrix)
+    {
+        mHierarchy.setLocalMatrix(mNode, inMatrix);
+    }
+
 private:
+    TransformHierarchy& mHierarchy;
+    TransformHierarchy::Node mNode;
     Actor* mNextActor;
     Actor* mPreviousActor;
 };
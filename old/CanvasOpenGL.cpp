@@ -1,6 +1,17 @@
 #include "CanvasOpenGL.hpp"
-#include "PingActor.hpp"
+#include "ImageKernels.hpp"
+#include "VectorKernels.hpp"
 #include <QtOpenGL>
+#include <cstring>
+#include <vector>
+
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+
+#ifndef GL_UNSIGNED_INT_8_8_8_8_REV
+#define GL_UNSIGNED_INT_8_8_8_8_REV 0x8367
+#endif
 
 CanvasOpenGL::CanvasOpenGL(QWidget *inParent)
     : QGLWidget(QGLFormat(QGL::AlphaChannel
@@ -8,20 +19,38 @@ CanvasOpenGL::CanvasOpenGL(QWidget *inParent)
                           | QGL::DepthBuffer
                           | QGL::DoubleBuffer
                           | QGL::DeprecatedFunctions
-                          ), inParent)
+                          ), inParent),
+      mHeadCardActor(mHierarchy)
 {
     setFocusPolicy(Qt::NoFocus);
     setMouseTracking(true);
 
-    QTimer* timer = new QTimer(this);
-    connect(timer, SIGNAL(timeout()), this, SLOT(onPulse()));
-    timer->start(25);
+    mPulseTimer = new QTimer(this);
+    connect(mPulseTimer, SIGNAL(timeout()), this, SLOT(onPulse()));
+    mClock.start();
     mSelectedCard = 0;
+    mDragPile = 0;
+    mDropPile = 0;
     mCardModel = 0;
+    mCardGrid = 0;
+    mTablePhysics = 0;
+    mPingPool = 0;
     mTableModel = 0;
     mTableActor = 0;
     mTableTexture = 0;
     mMouseMode = None;
+    mSampleX = 0;
+    mSampleY = 0;
+    mViewport[2] = 0;
+    mViewport[3] = 0;
+    mIsPhysicsEnabled = true;
+    mDragVelocity[0] = 0.0f;
+    mDragVelocity[1] = 0.0f;
+    mLastDragX = 0.0f;
+    mLastDragY = 0.0f;
+    mLastPulse = 0;
+    mHasNpot = false;
+    mTexStorage2D = 0;
 }
 
 CanvasOpenGL::~CanvasOpenGL()
@@ -30,13 +59,34 @@ CanvasOpenGL::~CanvasOpenGL()
 
     delete mTableActor;
     delete mTableModel;
+    delete mTablePhysics;
+    delete mCardGrid;
     delete mCardModel;
+    delete mPingPool;
 
     deleteTexture(mTableTexture);
 }
 
 void CanvasOpenGL::onPulse()
 {
+    qint64 now = mClock.elapsed();
+    float seconds = float(now - mLastPulse) / 1000.0f;
+    mLastPulse = now;
+
+    if (mIsPhysicsEnabled && mTablePhysics->awakeCount() > 0)
+    {
+        mMovedPiles.clear();
+        mTablePhysics->step(seconds, mMovedPiles);
+
+        for (int i = 0; i < mMovedPiles.size(); ++i)
+        {
+            CardPile& pile = *mMovedPiles[i];
+
+            for (size_t j = 0; j < pile.size(); ++j)
+                mCardGrid->update(*pile.at(j));
+        }
+    }
+
     for (QList<CardActor*>::Iterator i = mCardActors.begin();
          i != mCardActors.end(); ++i)
     {
@@ -47,8 +97,12 @@ void CanvasOpenGL::onPulse()
     //mCamera.changeRotation(1.0f);
     //mCamera.changeAngle(-0.5f);
     mCamera.update();
+    mat4f(mProjectionMatrix, mCamera.matrix()).copyInverseTo(mInverseMatrix);
+    updateMouse3D();
+
+    mHierarchy.update(mCamera.matrix());
+    updateFacing();
 
-    mHeadCardActor.updateMatrices(mat4f(), mCamera.matrix());
     updateGL();
 
     switch (mMouseMode)
@@ -87,26 +141,44 @@ void CanvasOpenGL::onPulse()
         x += delta[0];
         y += delta[1];
 
-        mSelectedCard->setPosition(x, y);
-        mSelectedCard->confirmParent();
+        mDragPile->setPosition(x, y);
+        mDropPile = 0;
 
-        if (!mSelectedCard->parent())
+        /// The release velocity is a running average so that the last,
+        /// often jittery, mouse movement does not decide the whole toss.
+        if (seconds > 0.0f)
         {
-            for (QList<CardActor*>::Iterator i = mCardActors.begin();
-                 i != mCardActors.end(); ++i)
-            {
-                CardActor& ca = *(*i);
-
-                if (mSelectedCard->lineage() != ca.lineage()
-                    && mSelectedCard->overlaps(ca)
-                    && !ca.child())
-                {
-                    ca.setChild(mSelectedCard);
-                    break;
-                }
-            }
+            mDragVelocity[0] = 0.5f * mDragVelocity[0]
+                + 0.5f * (x - mLastDragX) / seconds;
+            mDragVelocity[1] = 0.5f * mDragVelocity[1]
+                + 0.5f * (y - mLastDragY) / seconds;
         }
 
+        mLastDragX = x;
+        mLastDragY = y;
+
+        for (size_t i = 0; i < mDragPile->size(); ++i)
+            mCardGrid->update(*mDragPile->at(i));
+
+        CardActor& bottom = *mDragPile->bottom();
+        mDropCandidates.clear();
+        mCardGrid->findOverlapping(bottom.x() - bottom.radiusX(),
+            bottom.y() - bottom.radiusY(), bottom.x() + bottom.radiusX(),
+            bottom.y() + bottom.radiusY(), mDropCandidates);
+
+        for (int i = 0; i < mDropCandidates.size(); ++i)
+        {
+            CardActor* ca = mDropCandidates[i];
+            CardPile* pile = ca->pile();
+
+            if (pile != mDragPile && ca == pile->top()
+                && (!mDropPile || ca->z() > mDropPile->top()->z()))
+                mDropPile = pile;
+        }
+
+        mDragPile->setBase(mDropPile
+            ? mDropPile->base() + mDropPile->height() : 0.0f);
+
         break;
     }
 
@@ -120,17 +192,8 @@ void CanvasOpenGL::onPulse()
 
         vec3f black;
 
-        CardActor* hoverCandidate = 0;
-        for (int i = 0; i < mCardActors.size(); ++i)
-        {
-            CardActor* ca = mCardActors[i];
-
-            if (ca->contains(mMouse3D[0], mMouse3D[1]))
-            {
-                if (!hoverCandidate || ca->z() > hoverCandidate->z())
-                    hoverCandidate = ca;
-            }
-        }
+        CardActor* hoverCandidate = mCardGrid->topAt(mMouse3D[0],
+            mMouse3D[1]);
 
         if (mSelectedCard)
             mSelectedCard->setHighlight(black);
@@ -151,14 +214,28 @@ void CanvasOpenGL::onPulse()
 
 void CanvasOpenGL::initializeGL()
 {
+    /// OpenGL 2.0 made non power of two textures core, mipmaps and all.
+    mHasNpot = QGLFormat::openGLVersionFlags()
+        & QGLFormat::OpenGL_Version_2_0;
+
+    const char* extensions =
+        reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+
+    if (extensions && strstr(extensions, "GL_ARB_texture_storage"))
+    {
+        mTexStorage2D = reinterpret_cast<TexStorage2D>(
+            context()->getProcAddress("glTexStorage2D"));
+    }
+
     mTableTexture = bindTexture(QImage("wood.jpg"), GL_TEXTURE_2D);
 
-    mPingModel = new PingModel;
+    mPingPool = new PingPool;
     mCardModel = new CardModel;
+    mCardGrid = new CardGrid(qMax(mCardModel->width(),
+        mCardModel->height()));
+    mTablePhysics = new TablePhysics;
     mTableModel = new TableModel(mTableTexture);
-    mTableActor = new TableActor(*mTableModel);
-
-    mHeadCardActor.addChildNode(*mTableActor);
+    mTableActor = new TableActor(*mTableModel, mHeadCardActor);
     mTableActor->addToChain(mHeadCardActor);
 
     GLuint frontTexture = loadCardTextureByName(QString("localuprising.gif"));
@@ -167,12 +244,15 @@ void CanvasOpenGL::initializeGL()
     for (int i = 0; i < 40; ++i)
     {
         CardActor* cardActor = new CardActor(*mCardModel, frontTexture,
-            backTexture);
+            backTexture, mHeadCardActor);
 
         float x = float(i) * (mCardModel->width() + 0.5f);
-        cardActor->setPosition(x, 0.0f);
+        CardPile* pile = new CardPile(x, 0.0f);
+        pile->push(*cardActor);
+        mPiles.append(pile);
+        mCardGrid->insert(*cardActor);
+        mTablePhysics->add(*pile);
 
-        mHeadCardActor.addChildNode(*cardActor);
         cardActor->addToChain(mHeadCardActor);
         mCardActors.append(cardActor);
     }
@@ -187,6 +267,10 @@ void CanvasOpenGL::initializeGL()
     glMatrixMode(GL_MODELVIEW);
     glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_ADD);
     glColor3f(0.0f, 0.0f, 0.0f);
+
+    /// The pulse works on the table built above, so it only starts now.
+    mLastPulse = mClock.elapsed();
+    mPulseTimer->start(25);
 }
 
 void CanvasOpenGL::resizeGL(int inWidth, int inHeight)
@@ -211,15 +295,10 @@ void CanvasOpenGL::paintGL()
     glEnable(GL_DEPTH_TEST);
     mHeadCardActor.drawChain();
 
-    GLfloat depthSample;
-    glReadPixels(mSampleX, mSampleY, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT,
-        &depthSample);
-    unproject(mSampleX, mSampleY, depthSample,
-        mat4f(mProjectionMatrix, mCamera.matrix()), mMouse3D);
-
     glDisable(GL_DEPTH_TEST);
 
-    mHeadPingActor.drawChain();
+    mPingPool->draw(mat4f(mProjectionMatrix, mCamera.matrix()),
+        float(mClock.elapsed()) / 1000.0f);
 }
 
 void CanvasOpenGL::mousePressEvent(QMouseEvent* inEvent)
@@ -234,7 +313,7 @@ void CanvasOpenGL::mousePressEvent(QMouseEvent* inEvent)
             if (mSelectedCard)
             {
                 mMouseMode = MoveCard;
-                mOriginalPosition = mSelectedCard->position();
+                beginDrag();
             }
             else
             {
@@ -247,16 +326,10 @@ void CanvasOpenGL::mousePressEvent(QMouseEvent* inEvent)
         break;
 
     case Qt::MiddleButton:
-    {
         //qDebug() << mMouse3D[0] << mMouse3D[1] << mMouse3D[2];
-        PingActor* pingActor = new PingActor(*mPingModel, mMouse3D[0],
-            mMouse3D[1], 1.0f, 0.0f, 0.0f);
-
-        mHeadCardActor.addChildNode(*pingActor);
-        pingActor->addToChain(mHeadPingActor);
-
+        mPingPool->spawn(mMouse3D[0], mMouse3D[1], 1.0f, 0.0f, 0.0f,
+            float(mClock.elapsed()) / 1000.0f);
         break;
-    }
 
     case Qt::RightButton:
         if (mMouseMode == None)
@@ -276,6 +349,7 @@ void CanvasOpenGL::mousePressEvent(QMouseEvent* inEvent)
         else if (mMouseMode == MoveCard)
         {
             mSelectedCard->rotate90();
+            mCardGrid->update(*mSelectedCard);
         }
 
         break;
@@ -292,6 +366,9 @@ void CanvasOpenGL::mouseReleaseEvent(QMouseEvent* inEvent)
     switch (inEvent->button())
     {
     case Qt::LeftButton:
+        if (mMouseMode == MoveCard)
+            endDrag();
+
         if (mMouseMode == PanCamera || mMouseMode == MoveCard)
             mMouseMode = None;
         break;
@@ -352,12 +429,71 @@ void CanvasOpenGL::keyPressEvent(QKeyEvent* inEvent)
 {
     switch (inEvent->key())
     {
+    case Qt::Key_P:
+        mIsPhysicsEnabled = !mIsPhysicsEnabled;
+        break;
 
     default:
         break;
     }
 }
 
+/// Picking up a card picks up everything stacked on top of it. The card and
+/// the cards above it are split off into their own pile, which is the only
+/// thing that moves while dragging.
+void CanvasOpenGL::beginDrag()
+{
+    CardPile* pile = mSelectedCard->pile();
+    size_t index = mSelectedCard->pileIndex();
+
+    if (index == 0)
+    {
+        mDragPile = pile;
+    }
+    else
+    {
+        mDragPile = new CardPile;
+        pile->split(index, *mDragPile);
+        mPiles.append(mDragPile);
+        mTablePhysics->refresh(*pile);
+    }
+
+    mTablePhysics->hold(*mDragPile);
+
+    mDropPile = 0;
+    mOriginalPosition[0] = mDragPile->x();
+    mOriginalPosition[1] = mDragPile->y();
+    mLastDragX = mDragPile->x();
+    mLastDragY = mDragPile->y();
+    mDragVelocity[0] = 0.0f;
+    mDragVelocity[1] = 0.0f;
+}
+
+void CanvasOpenGL::endDrag()
+{
+    if (mDropPile)
+    {
+        mDropPile->merge(*mDragPile);
+        mTablePhysics->remove(*mDragPile);
+        mTablePhysics->refresh(*mDropPile);
+        mPiles.removeOne(mDragPile);
+        delete mDragPile;
+    }
+    else
+    {
+        mDragPile->setBase(0.0f);
+
+        if (mIsPhysicsEnabled)
+            mTablePhysics->toss(*mDragPile, mDragVelocity[0],
+                mDragVelocity[1]);
+        else
+            mTablePhysics->toss(*mDragPile, 0.0f, 0.0f);
+    }
+
+    mDragPile = 0;
+    mDropPile = 0;
+}
+
 void CanvasOpenGL::destroyAll()
 {
     for (int i = 0; i < mTextures.size(); ++i)
@@ -366,8 +502,14 @@ void CanvasOpenGL::destroyAll()
     mTextures.clear();
     mTexturesByName.clear();
 
+    if (mCardGrid) mCardGrid->clear();
+    if (mTablePhysics) mTablePhysics->clear();
+
     while (!mCardActors.isEmpty())
         delete mCardActors.takeFirst();
+
+    while (!mPiles.isEmpty())
+        delete mPiles.takeFirst();
 }
 
 void CanvasOpenGL::testFolders()
@@ -389,10 +531,7 @@ GLuint CanvasOpenGL::loadCardTextureByName(const QString& inName)
 
         if (!image.isNull())
         {
-            QImage square(QSize(512, 512), image.format());
-            QPainter painter(&square);
-            painter.drawImage(QRect(0, 0, 512, 512), image);
-            outTexture = bindTexture(square, GL_TEXTURE_2D);
+            outTexture = uploadImage(image);
             mTextures.append(outTexture);
             mTexturesByName.insert(inName, outTexture);
         }
@@ -405,19 +544,132 @@ GLuint CanvasOpenGL::loadCardTextureByName(const QString& inName)
     return outTexture;
 }
 
-void CanvasOpenGL::unproject(GLint inX, GLint inY, GLfloat inDepth,
-    const mat4f& inModelViewProjectionMatrix, GLfloat *inResult)
+/// Replaces QGLWidget::bindTexture, which had the image painted into a power
+/// of two square and then converted and flipped it again. Here the image is
+/// scaled (if it must be) and flipped in one pass, and the result goes to GL
+/// as BGRA, which is how ARGB32 pixels sit in memory. Packed as
+/// UNSIGNED_INT_8_8_8_8_REV, that holds on big endian machines too.
+GLuint CanvasOpenGL::uploadImage(const QImage& inImage)
 {
-    float v[4];
+    QImage image = inImage;
+
+    if (image.format() != QImage::Format_ARGB32
+        && image.format() != QImage::Format_RGB32)
+        image = image.convertToFormat(QImage::Format_ARGB32);
+
+    int width = image.width();
+    int height = image.height();
+
+    if (!mHasNpot)
+    {
+        width = 512;
+        height = 512;
+    }
+
+    int levelCount = 1;
+
+    while ((qMax(width, height) >> levelCount) > 0)
+        ++levelCount;
+
+    GLuint outTexture;
+    glGenTextures(1, &outTexture);
+    glBindTexture(GL_TEXTURE_2D, outTexture);
+
+    if (mTexStorage2D)
+        mTexStorage2D(GL_TEXTURE_2D, levelCount, GL_RGBA8, width, height);
+
+    std::vector<unsigned char> levels[2];
+    levels[0].resize(width * height * 4);
+    levels[1].resize(qMax(width / 2, 1) * qMax(height / 2, 1) * 4);
+    CGE::resampleImage(image, width, height, &levels[0][0]);
+
+    for (int i = 0; i < levelCount; ++i)
+    {
+        int levelWidth = qMax(width >> i, 1);
+        int levelHeight = qMax(height >> i, 1);
+        const unsigned char* pixels = &levels[i & 1][0];
+
+        if (i > 0)
+        {
+            CGE::halveImage(&levels[(i - 1) & 1][0], qMax(width >> (i - 1), 1),
+                qMax(height >> (i - 1), 1), &levels[i & 1][0]);
+        }
+
+        if (mTexStorage2D)
+            glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, levelWidth, levelHeight,
+                GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, pixels);
+        else
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, levelWidth, levelHeight,
+                0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, pixels);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+        GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return outTexture;
+}
+
+/// The mouse position on the table is found by intersecting the ray under the
+/// cursor with the table plane (Z = 0) rather than by reading back the depth
+/// buffer, which would stall the GPU pipeline every frame.
+void CanvasOpenGL::updateMouse3D()
+{
+    if (mViewport[2] <= 0 || mViewport[3] <= 0) return;
+
+    GLfloat x = GLfloat(mSampleX - mViewport[0]) * 2.0f
+        / GLfloat(mViewport[2]) - 1.0f;
+    GLfloat y = GLfloat(mSampleY - mViewport[1]) * 2.0f
+        / GLfloat(mViewport[3]) - 1.0f;
+
+    /// The near and far ends of the ray, unprojected as one batch.
+    GLfloat points[8] = { x, y, -1.0f, 1.0f, x, y, 1.0f, 1.0f };
+    GLfloat results[8];
+    CGE::transformPoints(mInverseMatrix, points, results, 2);
+
+    const GLfloat* nearPoint = results;
+    const GLfloat* farPoint = results + 4;
+
+    GLfloat deltaZ = farPoint[2] - nearPoint[2];
+
+    if (deltaZ != 0.0f)
+    {
+        GLfloat t = -nearPoint[2] / deltaZ;
+
+        mMouse3D[0] = nearPoint[0] + t * (farPoint[0] - nearPoint[0]);
+        mMouse3D[1] = nearPoint[1] + t * (farPoint[1] - nearPoint[1]);
+        mMouse3D[2] = 0.0f;
+        mMouse3D[3] = 1.0f;
+    }
+}
+
+/// A card shows its front when its normal points away from the camera. In
+/// eye space, the card's origin and normal are just the last two columns of
+/// its model view matrix, so every card is tested in two batches: one that
+/// normalizes the origins and one that takes the dot products.
+void CanvasOpenGL::updateFacing()
+{
+    int count = mCardActors.size();
+
+    mFacingOrigins.resize(count * 4);
+    mFacingNormals.resize(count * 4);
+    mFacingDots.resize(count);
+
+    float* origins = mFacingOrigins.data();
+    float* normals = mFacingNormals.data();
+
+    for (int i = 0; i < count; ++i)
+    {
+        const float* m = mCardActors[i]->modelViewMatrix();
+        memcpy(normals + i * 4, m + 8, sizeof(float) * 4);
+        memcpy(origins + i * 4, m + 12, sizeof(float) * 4);
+    }
 
-    v[0] = GLfloat(inX - mViewport[0]) * 2.0f / GLfloat(mViewport[2]) - 1.0f;
-    v[1] = GLfloat(inY - mViewport[1]) * 2.0f / GLfloat(mViewport[3]) - 1.0f;
-    v[2] = 2.0f * inDepth - 1.0f;
-    v[3] = 1.0f;
+    CGE::normalizeVectors3(origins, count, 4);
+    CGE::dotProducts3(origins, normals, mFacingDots.data(), count, 4);
 
-    mat4f m;
-    inModelViewProjectionMatrix.copyInverseTo(m);
-    m.transform(v, inResult);
+    for (int i = 0; i < count; ++i)
+        mCardActors[i]->setDrawFront(mFacingDots[i] < 0.0f);
 }
 
 void CanvasOpenGL::onKeyPress(QKeyEvent* inEvent)
@@ -3,9 +3,13 @@
 
 #include "TrackballCamera.hpp"
 #include "CardActor.hpp"
+#include "CardGrid.hpp"
+#include "TablePhysics.hpp"
 #include "TableActor.hpp"
-#include "PingModel.hpp"
+#include "PingPool.hpp"
 #include <QGLWidget>
+#include <QElapsedTimer>
+#include <QTimer>
 #include <QList>
 #include <QVector>
 #include <QMap>
@@ -35,9 +39,8 @@ protected:
     virtual void keyPressEvent(QKeyEvent* inEvent);
 
 private:
-    void unproject(GLint inX, GLint inY, GLfloat inDepth,
-        const mat4f& inModelViewProjectionMatrix,
-        GLfloat* inResult);
+    void updateMouse3D();
+    void updateFacing();
 
     enum { None, RotateCamera, PanCamera, MoveCard } mMouseMode;
 
@@ -50,26 +53,54 @@ private:
     vec4f mAnchor3D;
     vec3f mOriginalPosition;
     bool mWillUpdatePanning;
+    bool mIsPhysicsEnabled;
+    float mDragVelocity[2];
+    float mLastDragX;
+    float mLastDragY;
+    qint64 mLastPulse;
+
+    void beginDrag();
+    void endDrag();
 
     void destroyAll();
     void testFolders();
     GLuint loadCardTextureByName(const QString& inName);
+    GLuint uploadImage(const QImage& inImage);
 
     CardActor* mSelectedCard;
+    CardPile* mDragPile;
+    CardPile* mDropPile;
     QList<CardActor*> mCardActors;
+    QList<CardPile*> mPiles;
+    QVector<CardActor*> mDropCandidates;
+    QVector<CardPile*> mMovedPiles;
     QVector<GLuint> mTextures;
+    QVector<float> mFacingOrigins;
+    QVector<float> mFacingNormals;
+    QVector<float> mFacingDots;
     QMap<QString, GLuint> mTexturesByName;
 
     mat4f mProjectionMatrix;
+    mat4f mInverseMatrix;
     GLint mViewport[4];
     TrackballCamera mCamera;
+    TransformHierarchy mHierarchy;
     Actor mHeadCardActor;
-    Actor mHeadPingActor;
     CardModel* mCardModel;
+    CardGrid* mCardGrid;
+    TablePhysics* mTablePhysics;
     TableModel* mTableModel;
-    PingModel* mPingModel;
+    PingPool* mPingPool;
     TableActor* mTableActor;
     GLuint mTableTexture;
+    QElapsedTimer mClock;
+    QTimer* mPulseTimer;
+
+    typedef void (APIENTRY *TexStorage2D)(GLenum inTarget, GLsizei inLevels,
+        GLenum inInternalFormat, GLsizei inWidth, GLsizei inHeight);
+
+    bool mHasNpot;
+    TexStorage2D mTexStorage2D;
 };
 
 #endif
@@ -2,16 +2,15 @@
 #include <QDebug>
 
 CardActor::CardActor(CardModel& inCardModel, GLuint inFrontTexture,
-    GLuint inBackTexture)
-    : mCardModel(inCardModel), mFrontTexture(inFrontTexture),
+    GLuint inBackTexture, Actor& inParent)
+    : Actor(inParent), mCardModel(inCardModel), mFrontTexture(inFrontTexture),
       mBackTexture(inBackTexture), mRotation(0.0f), mFlip(0.0f),
       mRotationStepsLeft(0), mFlipStepsLeft(0)
 {
-    mLineage = this;
-    mParent = 0;
-    mChild = 0;
+    mPile = 0;
+    mPileIndex = 0;
+    mDrawFront = true;
 
-    mUnderneath = 0.0f;
     mRadiusX = mCardModel.width() / 2.0f;
     mRadiusY = mCardModel.height() / 2.0f;
     mRadiusZ = mCardModel.depth() / 2.0f;
@@ -59,41 +58,47 @@ void CardActor::update()
         mOccupyZ = sum * 2;
         mPosition[2] = sum;
 
-        updateUnderneath();
+        updatePile();
 
         --mFlipStepsLeft;
     }
+
+    /// Most cards sit still most of the time; leaving their matrices alone
+    /// keeps them out of the hierarchy's next sweep.
+    mat4f local;
+    local.translate(x(), y(), z());
+    local.rotateZ(mRotation);
+    local.rotateY(mFlip);
+    local.scaleZ(mThickness);
+
+    if (local != localMatrix()) setLocalMatrix(local);
 }
 
-void CardActor::confirmParent()
+float CardActor::x() const
 {
-    if (mParent && !overlaps(*mParent))
-    {
-        mParent->mChild = 0;
-        mParent = 0;
-        mUnderneath = 0.0f;
-        setLineage(this);
-        updateUnderneath();
-    }
+    return mPile ? mPile->x() + mPosition[0] : mPosition[0];
 }
 
-void CardActor::setChild(CardActor* inCardActor)
+float CardActor::y() const
 {
-    if (!mChild && inCardActor && inCardActor != this && !inCardActor->mParent)
-    {
-        mChild = inCardActor;
-        mChild->mParent = this;
-        mChild->setLineage(mLineage);
-        updateUnderneath();
-    }
+    return mPile ? mPile->y() + mPosition[1] : mPosition[1];
+}
+
+float CardActor::z() const
+{
+    return mPile ? mPile->underneath(mPileIndex) + mPosition[2]
+        : mPosition[2];
 }
 
 bool CardActor::contains(float inX, float inY)
 {
-    return inX > mPosition[0] - mRadiusX
-        && inX < mPosition[0] + mRadiusX
-        && inY > mPosition[1] - mRadiusY
-        && inY < mPosition[1] + mRadiusY;
+    float cx = x();
+    float cy = y();
+
+    return inX > cx - mRadiusX
+        && inX < cx + mRadiusX
+        && inY > cy - mRadiusY
+        && inY < cy + mRadiusY;
 }
 
 bool CardActor::overlaps(const CardActor& inCardActor)
@@ -125,7 +130,7 @@ void CardActor::setThickness(float inThickness)
     mRadiusZ = mThickness * mCardModel.depth() / 2.0f;
     mPosition[2] = mRadiusZ;
     mOccupyZ = mRadiusZ * 2.0f;
-    updateUnderneath();
+    updatePile();
 }
 
 void CardActor::setPosition(float inX, float inY)
@@ -135,64 +140,17 @@ void CardActor::setPosition(float inX, float inY)
     move(deltaX, deltaY);
 }
 
+/// The position of a card is relative to the origin of its pile. Moving a
+/// whole stack is done through CardPile instead.
 void CardActor::move(float inDeltaX, float inDeltaY)
 {
     mPosition[0] += inDeltaX;
     mPosition[1] += inDeltaY;
-
-    if (mChild) mChild->move(inDeltaX, inDeltaY);
-}
-
-void CardActor::willUpdate()
-{
-    localMatrix().loadIdentity();
-    localMatrix().translate(mPosition[0], mPosition[1],
-        mUnderneath + mPosition[2]);
-    localMatrix().rotateZ(mRotation);
-    localMatrix().rotateY(mFlip);
-    localMatrix().scaleZ(mThickness);
-}
-
-void CardActor::didUpdate()
-{
-    vec4f origin;
-    origin[3] = 1.0f;
-
-    modelMatrix().transform(origin, mModelOrigin);
-    modelViewMatrix().transform(origin, mModelViewOrigin);
-
-    origin[2] = 1.0f;
-    modelViewMatrix().transform(origin, mDirection);
-
-    mDirection[0] -= mModelViewOrigin[0];
-    mDirection[1] -= mModelViewOrigin[1];
-    mDirection[2] -= mModelViewOrigin[2];
-
-    vec4f cameraToPolygon = mModelViewOrigin;
-    CGE::normalize3(cameraToPolygon.getData());
-
-    float dotProduct = CGE::dot(cameraToPolygon.getData(),
-        mDirection.getData());
-
-    mDrawFront = dotProduct < 0.0f;
-}
-
-void CardActor::updateUnderneath()
-{
-    updateUnderneath(mUnderneath);
-}
-
-void CardActor::updateUnderneath(float inPreviousUnderneath)
-{
-    mUnderneath = inPreviousUnderneath;
-
-    if (mChild) mChild->updateUnderneath(mUnderneath + mOccupyZ);
 }
 
-void CardActor::setLineage(CardActor *inLineage)
+void CardActor::updatePile()
 {
-    for (CardActor* i = this; i; i = i->mChild)
-        i->mLineage = inLineage;
+    if (mPile) mPile->invalidate(mPileIndex);
 }
 
 bool CardActor::isInRange(float inPointA, float inRadiusA, float inPointB,
@@ -4,36 +4,41 @@
 #include "Actor.hpp"
 #include "Vectors.hpp"
 #include "CardModel.hpp"
+#include "CardPile.hpp"
 
 class CardActor : public Actor
 {
 public:
     CardActor(CardModel& inCardModel, GLuint inFrontTexture,
-        GLuint inBackTexture);
+        GLuint inBackTexture, Actor& inParent);
     virtual ~CardActor();
 
     virtual void draw();
+
+    /// Steps the animations and hands the hierarchy the new local matrix.
     void update();
 
+    /// Which side faces the camera is worked out for every card at once by
+    /// the canvas, once the hierarchy has been updated.
+    inline void setDrawFront(bool inDrawFront) { mDrawFront = inDrawFront; }
+
     inline void setHighlight(float* inHighlight) { mHighlight = inHighlight; }
 
-    inline float x() const { return mPosition[0]; }
-    inline float y() const { return mPosition[1]; }
-    inline float z() const { return mUnderneath + mPosition[2]; }
+    float x() const;
+    float y() const;
+    float z() const;
 
+    inline float radiusX() const { return mRadiusX; }
+    inline float radiusY() const { return mRadiusY; }
     inline float radiusZ() const { return mRadiusZ; }
+    inline float occupyZ() const { return mOccupyZ; }
 
     inline bool isHorizontal() const { return mRadiusX > mRadiusY; }
     inline bool isVertical() const { return mRadiusY > mRadiusX; }
     inline const vec3f& position() const { return mPosition; }
 
-    inline CardActor* parent() const { return mParent; }
-    inline CardActor* child() const { return mChild; }
-
-    inline CardActor* lineage() const { return mLineage; }
-
-    void confirmParent();
-    void setChild(CardActor* inCardActor);
+    inline CardPile* pile() const { return mPile; }
+    inline size_t pileIndex() const { return mPileIndex; }
 
     bool contains(float inX, float inY);
     bool overlaps(const CardActor& inCardActor);
@@ -43,34 +48,24 @@ public:
     void setPosition(float inX, float inY);
     void move(float inDeltaX, float inDeltaY);
 
-protected:
-    virtual void willUpdate();
-    virtual void didUpdate();
-
 private:
     static bool isInRange(float inPointA, float inRadiusA, float inPointB,
         float inRadiusB);
 
-    void updateUnderneath();
-    void updateUnderneath(float inPreviousUnderneath);
-    void setLineage(CardActor* inLineage);
+    void updatePile();
 
-    CardActor* mLineage;
-    CardActor* mParent;
-    CardActor* mChild;
+    friend class CardPile;
+    CardPile* mPile;
+    size_t mPileIndex;
 
     CardModel& mCardModel;
     GLuint mFrontTexture;
     GLuint mBackTexture;
 
-    vec4f mModelOrigin;
-    vec4f mModelViewOrigin;
-    vec4f mDirection;
     bool mDrawFront;
 
     vec3f mHighlight;
     vec3f mPosition;
-    float mUnderneath;
     float mRadiusX;
     float mRadiusY;
     float mRadiusZ;
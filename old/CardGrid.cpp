@@ -0,0 +1,207 @@
+#include "CardGrid.hpp"
+#include "CardActor.hpp"
+
+CardGrid::CardGrid(float inCellSize, size_t inBucketCount)
+    : mInverseCellSize(1.0f / inCellSize),
+      mBuckets(inBucketCount > 0 ? inBucketCount : 1), mQueryStamp(0)
+{
+}
+
+CardGrid::~CardGrid()
+{
+}
+
+void CardGrid::insert(CardActor& inCardActor)
+{
+    if (mRecordsByCard.contains(&inCardActor)) return;
+
+    size_t index;
+
+    if (mFreeRecords.empty())
+    {
+        index = mRecords.size();
+        mRecords.push_back(Record());
+    }
+    else
+    {
+        index = mFreeRecords.back();
+        mFreeRecords.pop_back();
+    }
+
+    Record& record = mRecords[index];
+    record.cardActor = &inCardActor;
+    record.queryStamp = mQueryStamp;
+    cellsFor(inCardActor, record);
+
+    file(index);
+    mRecordsByCard.insert(&inCardActor, index);
+}
+
+void CardGrid::remove(CardActor& inCardActor)
+{
+    QHash<CardActor*, size_t>::Iterator i = mRecordsByCard.find(&inCardActor);
+
+    if (i != mRecordsByCard.end())
+    {
+        unfile(i.value());
+        mRecords[i.value()].cardActor = 0;
+        mFreeRecords.push_back(i.value());
+        mRecordsByCard.erase(i);
+    }
+}
+
+void CardGrid::update(CardActor& inCardActor)
+{
+    QHash<CardActor*, size_t>::ConstIterator i =
+        mRecordsByCard.constFind(&inCardActor);
+
+    if (i == mRecordsByCard.constEnd()) return;
+
+    size_t index = i.value();
+    Record cells = mRecords[index];
+    cellsFor(inCardActor, cells);
+
+    const Record& record = mRecords[index];
+
+    if (cells.minX != record.minX || cells.minY != record.minY
+        || cells.maxX != record.maxX || cells.maxY != record.maxY)
+    {
+        unfile(index);
+        mRecords[index] = cells;
+        file(index);
+    }
+}
+
+void CardGrid::clear()
+{
+    for (size_t i = 0; i < mBuckets.size(); ++i)
+        mBuckets[i].clear();
+
+    mRecords.clear();
+    mFreeRecords.clear();
+    mRecordsByCard.clear();
+}
+
+CardActor* CardGrid::topAt(float inX, float inY) const
+{
+    CardActor* outCardActor = 0;
+    const std::vector<size_t>& b = mBuckets[bucket(cell(inX), cell(inY))];
+
+    for (size_t i = 0; i < b.size(); ++i)
+    {
+        CardActor* cardActor = mRecords[b[i]].cardActor;
+
+        if (cardActor->contains(inX, inY)
+            && (!outCardActor || cardActor->z() > outCardActor->z()))
+            outCardActor = cardActor;
+    }
+
+    return outCardActor;
+}
+
+void CardGrid::findAt(float inX, float inY, QVector<CardActor*>& inResults)
+    const
+{
+    unsigned int stamp = ++mQueryStamp;
+    const std::vector<size_t>& b = mBuckets[bucket(cell(inX), cell(inY))];
+
+    for (size_t i = 0; i < b.size(); ++i)
+    {
+        const Record& record = mRecords[b[i]];
+
+        if (record.queryStamp == stamp) continue;
+
+        record.queryStamp = stamp;
+
+        if (record.cardActor->contains(inX, inY))
+            inResults.append(record.cardActor);
+    }
+}
+
+/// A card spanning several cells appears in several buckets (and unrelated
+/// cells can hash to the same bucket), so each record is stamped the first
+/// time this query sees it.
+void CardGrid::findOverlapping(float inMinX, float inMinY, float inMaxX,
+    float inMaxY, QVector<CardActor*>& inResults) const
+{
+    unsigned int stamp = ++mQueryStamp;
+    int minX = cell(inMinX);
+    int minY = cell(inMinY);
+    int maxX = cell(inMaxX);
+    int maxY = cell(inMaxY);
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            const std::vector<size_t>& b = mBuckets[bucket(x, y)];
+
+            for (size_t i = 0; i < b.size(); ++i)
+            {
+                const Record& record = mRecords[b[i]];
+
+                if (record.queryStamp == stamp) continue;
+
+                record.queryStamp = stamp;
+                CardActor* cardActor = record.cardActor;
+
+                if (cardActor->x() + cardActor->radiusX() > inMinX
+                    && cardActor->x() - cardActor->radiusX() < inMaxX
+                    && cardActor->y() + cardActor->radiusY() > inMinY
+                    && cardActor->y() - cardActor->radiusY() < inMaxY)
+                    inResults.append(cardActor);
+            }
+        }
+    }
+}
+
+void CardGrid::cellsFor(const CardActor& inCardActor, Record& inRecord) const
+{
+    float x = inCardActor.x();
+    float y = inCardActor.y();
+
+    inRecord.minX = cell(x - inCardActor.radiusX());
+    inRecord.minY = cell(y - inCardActor.radiusY());
+    inRecord.maxX = cell(x + inCardActor.radiusX());
+    inRecord.maxY = cell(y + inCardActor.radiusY());
+}
+
+void CardGrid::file(size_t inRecord)
+{
+    const Record& record = mRecords[inRecord];
+
+    for (int y = record.minY; y <= record.maxY; ++y)
+    {
+        for (int x = record.minX; x <= record.maxX; ++x)
+        {
+            std::vector<size_t>& b = mBuckets[bucket(x, y)];
+
+            /// Neighboring cells may share a bucket.
+            if (b.empty() || b.back() != inRecord)
+                b.push_back(inRecord);
+        }
+    }
+}
+
+void CardGrid::unfile(size_t inRecord)
+{
+    const Record& record = mRecords[inRecord];
+
+    for (int y = record.minY; y <= record.maxY; ++y)
+    {
+        for (int x = record.minX; x <= record.maxX; ++x)
+        {
+            std::vector<size_t>& b = mBuckets[bucket(x, y)];
+
+            for (size_t i = 0; i < b.size(); ++i)
+            {
+                if (b[i] == inRecord)
+                {
+                    b[i] = b.back();
+                    b.pop_back();
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef CARDGRID_HPP
+#define CARDGRID_HPP
+
+#include <QHash>
+#include <QVector>
+#include <vector>
+
+class CardActor;
+
+/// A uniform hash grid over the XY plane of the table. Each card is filed
+/// under every cell its footprint touches, so point and rectangle queries only
+/// need to look at the cards in a handful of cells instead of every card on
+/// the table. Cells are hashed into a fixed number of buckets, which means the
+/// table has no bounds and empty areas cost nothing.
+///
+/// The grid does not watch the cards. Whoever moves or rotates a card is
+/// expected to call update() afterward; cards that did not change cells are
+/// left alone.
+class CardGrid
+{
+public:
+    CardGrid(float inCellSize, size_t inBucketCount = 1024);
+    ~CardGrid();
+
+    void insert(CardActor& inCardActor);
+    void remove(CardActor& inCardActor);
+    void update(CardActor& inCardActor);
+    void clear();
+
+    /// the highest card containing the given point, or null if none
+    CardActor* topAt(float inX, float inY) const;
+
+    void findAt(float inX, float inY, QVector<CardActor*>& inResults) const;
+    void findOverlapping(float inMinX, float inMinY, float inMaxX,
+        float inMaxY, QVector<CardActor*>& inResults) const;
+
+private:
+    struct Record
+    {
+        CardActor* cardActor;
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+        mutable unsigned int queryStamp;
+    };
+
+    inline int cell(float inValue) const
+    {
+        float c = inValue * mInverseCellSize;
+        int outCell = int(c);
+        return float(outCell) > c ? outCell - 1 : outCell;
+    }
+
+    inline size_t bucket(int inX, int inY) const
+    {
+        return size_t((unsigned(inX) * 73856093u)
+            ^ (unsigned(inY) * 19349663u)) % mBuckets.size();
+    }
+
+    void cellsFor(const CardActor& inCardActor, Record& inRecord) const;
+    void file(size_t inRecord);
+    void unfile(size_t inRecord);
+
+    float mInverseCellSize;
+    std::vector<std::vector<size_t> > mBuckets;
+    std::vector<Record> mRecords;
+    std::vector<size_t> mFreeRecords;
+    QHash<CardActor*, size_t> mRecordsByCard;
+    mutable unsigned int mQueryStamp;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "CardPile.hpp"
+#include "CardActor.hpp"
+
+CardPile::CardPile(float inX, float inY)
+    : mX(inX), mY(inY), mBase(0.0f), mHeight(0.0f)
+{
+}
+
+CardPile::~CardPile()
+{
+}
+
+void CardPile::setPosition(float inX, float inY)
+{
+    mX = inX;
+    mY = inY;
+}
+
+void CardPile::move(float inDeltaX, float inDeltaY)
+{
+    mX += inDeltaX;
+    mY += inDeltaY;
+}
+
+void CardPile::push(CardActor& inCardActor)
+{
+    mCards.push_back(&inCardActor);
+    mUnderneaths.push_back(0.0f);
+    attach(mCards.size() - 1);
+}
+
+/// Places every card of inPile on top of this pile, leaving inPile empty. The
+/// cards keep their absolute positions on the table.
+void CardPile::merge(CardPile& inPile)
+{
+    if (&inPile == this || inPile.isEmpty()) return;
+
+    float deltaX = inPile.mX - mX;
+    float deltaY = inPile.mY - mY;
+    size_t first = mCards.size();
+
+    mCards.insert(mCards.end(), inPile.mCards.begin(), inPile.mCards.end());
+    mUnderneaths.resize(mCards.size());
+
+    for (size_t i = first; i < mCards.size(); ++i)
+        mCards[i]->move(deltaX, deltaY);
+
+    attach(first);
+
+    inPile.mCards.clear();
+    inPile.mUnderneaths.clear();
+    inPile.mHeight = 0.0f;
+}
+
+/// Moves the card at inIndex and every card above it onto inPile. When inPile
+/// is empty, it takes over this pile's origin and starts out resting exactly
+/// where the removed cards were, so nothing visibly jumps.
+void CardPile::split(size_t inIndex, CardPile& inPile)
+{
+    if (&inPile == this || inIndex >= mCards.size()) return;
+
+    if (inPile.isEmpty())
+    {
+        inPile.mX = mX;
+        inPile.mY = mY;
+        inPile.mBase = mBase + mUnderneaths[inIndex];
+    }
+
+    float deltaX = mX - inPile.mX;
+    float deltaY = mY - inPile.mY;
+    size_t first = inPile.mCards.size();
+
+    inPile.mCards.insert(inPile.mCards.end(), mCards.begin() + inIndex,
+        mCards.end());
+    inPile.mUnderneaths.resize(inPile.mCards.size());
+
+    for (size_t i = first; i < inPile.mCards.size(); ++i)
+        inPile.mCards[i]->move(deltaX, deltaY);
+
+    inPile.attach(first);
+
+    mHeight = mUnderneaths[inIndex];
+    mCards.resize(inIndex);
+    mUnderneaths.resize(inIndex);
+}
+
+/// Called when the thickness of the card at inIndex changes (a flip in
+/// progress, for instance). Only the cards from that point up are restacked.
+void CardPile::invalidate(size_t inIndex)
+{
+    if (inIndex < mCards.size()) attach(inIndex);
+}
+
+void CardPile::attach(size_t inFirst)
+{
+    float underneath = inFirst ? mUnderneaths[inFirst - 1]
+        + mCards[inFirst - 1]->occupyZ() : 0.0f;
+
+    for (size_t i = inFirst; i < mCards.size(); ++i)
+    {
+        CardActor& cardActor = *mCards[i];
+        cardActor.mPile = this;
+        cardActor.mPileIndex = i;
+
+        mUnderneaths[i] = underneath;
+        underneath += cardActor.occupyZ();
+    }
+
+    mHeight = underneath;
+}
@@ -0,0 +1,68 @@
+#ifndef CARDPILE_HPP
+#define CARDPILE_HPP
+
+#include <vector>
+#include <cstddef>
+
+class CardActor;
+
+/// A pile is an ordered stack of cards sharing one origin on the table. Cards
+/// are stored bottom to top in a contiguous array, and the height at which
+/// each card rests is cached, so the top, the bottom and the total height are
+/// all O(1). Every card on the table belongs to exactly one pile (a lone card
+/// is simply a pile of one).
+///
+/// Each card keeps its own XY offset relative to the pile origin, which lets a
+/// stack stay slightly fanned out. Dragging a pile only moves the origin; none
+/// of the cards are touched.
+class CardPile
+{
+public:
+    CardPile(float inX = 0.0f, float inY = 0.0f);
+    ~CardPile();
+
+    inline size_t size() const { return mCards.size(); }
+    inline bool isEmpty() const { return mCards.empty(); }
+
+    inline CardActor* at(size_t inIndex) const { return mCards[inIndex]; }
+    inline CardActor* bottom() const { return mCards.front(); }
+    inline CardActor* top() const { return mCards.back(); }
+
+    inline float x() const { return mX; }
+    inline float y() const { return mY; }
+
+    /// The base is the height of whatever the pile is resting on (normally the
+    /// table). A pile being dragged across another pile rides on top of it.
+    inline float base() const { return mBase; }
+    inline void setBase(float inBase) { mBase = inBase; }
+
+    /// total height of the cards in this pile (excluding the base)
+    inline float height() const { return mHeight; }
+
+    /// height at which the card at inIndex rests, including the base
+    inline float underneath(size_t inIndex) const
+    {
+        return mBase + mUnderneaths[inIndex];
+    }
+
+    void setPosition(float inX, float inY);
+    void move(float inDeltaX, float inDeltaY);
+
+    void push(CardActor& inCardActor);
+    void merge(CardPile& inPile);
+    void split(size_t inIndex, CardPile& inPile);
+
+    void invalidate(size_t inIndex);
+
+private:
+    void attach(size_t inFirst);
+
+    std::vector<CardActor*> mCards;
+    std::vector<float> mUnderneaths;
+    float mX;
+    float mY;
+    float mBase;
+    float mHeight;
+};
+
+#endif
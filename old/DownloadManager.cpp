@@ -0,0 +1,406 @@
+#include "DownloadManager.hpp"
+#include <QNetworkRequest>
+
+static const int BufferSize = 64 * 1024;
+static const qint64 CheckpointBytes = 4 * 1024 * 1024;
+
+/// Reads "bytes first-last/total" or "bytes */total"; whatever is missing or
+/// unknown comes back as -1.
+static void parseContentRange(const QByteArray& inValue, qint64& inFirst,
+    qint64& inTotal)
+{
+    inFirst = -1;
+    inTotal = -1;
+
+    QByteArray value = inValue.trimmed();
+
+    if (!value.startsWith("bytes ")) return;
+
+    int slash = value.indexOf('/');
+
+    if (slash < 0) return;
+
+    QByteArray range = value.mid(6, slash - 6).trimmed();
+    QByteArray total = value.mid(slash + 1).trimmed();
+    bool isValid;
+
+    if (range != "*")
+    {
+        qint64 first = range.left(range.indexOf('-')).toLongLong(&isValid);
+
+        if (isValid) inFirst = first;
+    }
+
+    if (total != "*")
+    {
+        qint64 count = total.toLongLong(&isValid);
+
+        if (isValid) inTotal = count;
+    }
+}
+
+/// Only a strong ETag can be used with If-Range.
+static QByteArray validatorOf(QNetworkReply* inReply)
+{
+    QByteArray tag = inReply->rawHeader("ETag");
+
+    if (!tag.isEmpty() && !tag.startsWith("W/")) return tag;
+
+    return inReply->rawHeader("Last-Modified");
+}
+
+DownloadManager::DownloadManager(QObject* inParent, int inMaxTransfers)
+    : QObject(inParent), mMaxTransfers(qMax(inMaxTransfers, 1)),
+      mBuffer(BufferSize, '\0')
+{
+    mNetworkAccessManager = new QNetworkAccessManager(this);
+}
+
+/// Transfers still running are saved for resuming rather than reported.
+DownloadManager::~DownloadManager()
+{
+    while (!mQueue.isEmpty())
+        destroy(mQueue.takeFirst());
+
+    QList<Transfer*> active = mActive.values();
+    mActive.clear();
+
+    for (int i = 0; i < active.size(); ++i)
+    {
+        Transfer* transfer = active[i];
+        disconnect(transfer->reply, 0, this, 0);
+        transfer->reply->abort();
+        saveCheckpoint(*transfer);
+        destroy(transfer);
+    }
+}
+
+void DownloadManager::download(const QUrl& inUrl, const QString& inPath,
+    qint64 inSize, const QByteArray& inSha1)
+{
+    if (isPending(inPath)) return;
+
+    Transfer* transfer = new Transfer;
+    transfer->url = inUrl;
+    transfer->path = inPath;
+    transfer->size = inSize;
+    transfer->expectedSha1 = inSha1.toLower();
+    transfer->reply = 0;
+    transfer->file = 0;
+    transfer->hash = 0;
+    transfer->received = 0;
+    transfer->checkpoint = 0;
+    transfer->isStarted = false;
+    transfer->isFailed = false;
+
+    mQueue.append(transfer);
+    startNext();
+}
+
+/// Aborted transfers report failure, and can be resumed later.
+void DownloadManager::abortAll()
+{
+    while (!mQueue.isEmpty())
+    {
+        Transfer* transfer = mQueue.takeFirst();
+        emit finished(transfer->path, false, QByteArray());
+        destroy(transfer);
+    }
+
+    QList<QNetworkReply*> replies = mActive.keys();
+
+    for (int i = 0; i < replies.size(); ++i)
+        replies[i]->abort();
+}
+
+void DownloadManager::onReadyRead()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    Transfer* transfer = mActive.value(reply);
+
+    if (transfer) receive(*transfer);
+}
+
+void DownloadManager::onFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    Transfer* transfer = mActive.take(reply);
+
+    if (!transfer) return;
+
+    receive(*transfer);
+
+    int status = reply->attribute(
+        QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool isSuccess = reply->error() == QNetworkReply::NoError;
+
+    // Asking for the rest of a file that was already whole is fine. Any
+    // other unsatisfiable range means what was kept no longer fits the file,
+    // so the next attempt starts over rather than asking for it again.
+    if (status == 416 && !transfer->isFailed)
+    {
+        qint64 first;
+        qint64 total;
+        parseContentRange(reply->rawHeader("Content-Range"), first, total);
+
+        if (total < 0) total = transfer->size;
+
+        if (total > 0 && transfer->received == total
+            && (transfer->size < 0 || transfer->size == total))
+        {
+            transfer->size = total;
+            isSuccess = true;
+        }
+        else
+        {
+            restart(*transfer);
+        }
+    }
+
+    if (transfer->isFailed || (isSuccess && transfer->size >= 0
+        && transfer->received != transfer->size))
+        isSuccess = false;
+
+    QByteArray sha1;
+    QString part = transfer->path + ".part";
+    QString resume = transfer->path + ".resume";
+
+    if (isSuccess)
+    {
+        sha1 = transfer->hash->result().toHex();
+        transfer->file->resize(transfer->received);
+        transfer->file->close();
+
+        if (!transfer->expectedSha1.isEmpty()
+            && sha1 != transfer->expectedSha1)
+        {
+            qWarning("%s does not match its hash",
+                qPrintable(transfer->path));
+            QFile::remove(part);
+            QFile::remove(resume);
+            isSuccess = false;
+        }
+        else
+        {
+            QFile::remove(resume);
+            QFile::remove(transfer->path);
+            isSuccess = QFile::rename(part, transfer->path);
+        }
+    }
+    else
+    {
+        saveCheckpoint(*transfer);
+    }
+
+    emit finished(transfer->path, isSuccess, sha1);
+
+    reply->deleteLater();
+    destroy(transfer);
+    startNext();
+
+    if (isIdle()) emit allFinished();
+}
+
+bool DownloadManager::isPending(const QString& inPath) const
+{
+    for (int i = 0; i < mQueue.size(); ++i)
+        if (mQueue[i]->path == inPath) return true;
+
+    QHash<QNetworkReply*, Transfer*>::const_iterator active =
+        mActive.constBegin();
+
+    for (; active != mActive.constEnd(); ++active)
+        if (active.value()->path == inPath) return true;
+
+    return false;
+}
+
+void DownloadManager::startNext()
+{
+    while (!mQueue.isEmpty() && mActive.size() < mMaxTransfers)
+    {
+        Transfer* transfer = mQueue.takeFirst();
+
+        if (!start(*transfer))
+        {
+            emit finished(transfer->path, false, QByteArray());
+            destroy(transfer);
+        }
+    }
+}
+
+/// Whatever is already in the part file gets hashed again before the rest
+/// is asked for, so the hash covers the whole file when it is done.
+bool DownloadManager::start(Transfer& inTransfer)
+{
+    inTransfer.file = new QFile(inTransfer.path + ".part");
+
+    if (!inTransfer.file->open(QIODevice::ReadWrite)) return false;
+
+    QFile resume(inTransfer.path + ".resume");
+    qint64 offset = 0;
+
+    if (resume.open(QIODevice::ReadOnly))
+    {
+        if (resume.read(reinterpret_cast<char*>(&offset), sizeof(offset))
+            == sizeof(offset))
+            inTransfer.validator = resume.readAll();
+        else
+            offset = 0;
+    }
+
+    if (inTransfer.validator.isEmpty()) offset = 0;
+
+    offset = qBound(qint64(0), offset, inTransfer.file->size());
+    inTransfer.hash = new QCryptographicHash(QCryptographicHash::Sha1);
+
+    while (inTransfer.received < offset)
+    {
+        qint64 count = inTransfer.file->read(mBuffer.data(),
+            qMin(qint64(BufferSize), offset - inTransfer.received));
+
+        if (count <= 0) break;
+
+        inTransfer.hash->addData(mBuffer.constData(), int(count));
+        inTransfer.received += count;
+    }
+
+    inTransfer.checkpoint = inTransfer.received;
+
+    if (inTransfer.size > inTransfer.file->size())
+        inTransfer.file->resize(inTransfer.size);
+
+    QNetworkRequest request(inTransfer.url);
+
+    if (inTransfer.received > 0)
+    {
+        request.setRawHeader("Range", "bytes="
+            + QByteArray::number(inTransfer.received) + "-");
+        request.setRawHeader("If-Range", inTransfer.validator);
+    }
+
+    inTransfer.reply = mNetworkAccessManager->get(request);
+    inTransfer.reply->setReadBufferSize(BufferSize * 4);
+    mActive.insert(inTransfer.reply, &inTransfer);
+
+    connect(inTransfer.reply, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(inTransfer.reply, SIGNAL(finished()), this, SLOT(onFinished()));
+    return true;
+}
+
+void DownloadManager::receive(Transfer& inTransfer)
+{
+    QNetworkReply* reply = inTransfer.reply;
+    int status = reply->attribute(
+        QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    // Error pages are not file contents.
+    if (inTransfer.isFailed || (status != 200 && status != 206)) return;
+
+    if (!inTransfer.isStarted)
+    {
+        inTransfer.isStarted = true;
+
+        qint64 first = 0;
+        qint64 total = -1;
+
+        if (status == 200)
+        {
+            if (inTransfer.received > 0) restart(inTransfer);
+
+            inTransfer.validator = validatorOf(reply);
+        }
+        else
+        {
+            parseContentRange(reply->rawHeader("Content-Range"), first,
+                total);
+        }
+
+        // A partial answer that does not pick up where the part file leaves
+        // off is no use; the part is dropped and the transfer failed.
+        if (first != inTransfer.received || (total >= 0
+            && inTransfer.size >= 0 && total != inTransfer.size))
+        {
+            qWarning("%s does not continue where it left off",
+                qPrintable(inTransfer.url.toString()));
+            restart(inTransfer);
+            inTransfer.isFailed = true;
+            reply->abort();
+            return;
+        }
+
+        qint64 length = reply->header(
+            QNetworkRequest::ContentLengthHeader).toLongLong();
+
+        if (inTransfer.size < 0 && total < 0 && length > 0)
+            total = inTransfer.received + length;
+
+        if (inTransfer.size < 0 && total > 0)
+        {
+            inTransfer.size = total;
+            inTransfer.file->resize(inTransfer.size);
+        }
+
+        inTransfer.file->seek(inTransfer.received);
+    }
+
+    qint64 count;
+
+    while ((count = reply->read(mBuffer.data(), BufferSize)) > 0)
+    {
+        // A full disk fails the transfer, keeping what was written before.
+        // Aborting can finish the transfer, and destroy it, right away.
+        if (inTransfer.file->write(mBuffer.constData(), count) != count)
+        {
+            qWarning("Could not write %s",
+                qPrintable(inTransfer.file->fileName()));
+            inTransfer.isFailed = true;
+            reply->abort();
+            return;
+        }
+
+        inTransfer.hash->addData(mBuffer.constData(), int(count));
+        inTransfer.received += count;
+    }
+
+    if (inTransfer.received - inTransfer.checkpoint >= CheckpointBytes)
+        saveCheckpoint(inTransfer);
+
+    emit progress(inTransfer.path, inTransfer.received, inTransfer.size);
+}
+
+/// The data goes to disk before the offset claiming it does, and when it
+/// cannot, the offset saved last stands.
+void DownloadManager::saveCheckpoint(Transfer& inTransfer)
+{
+    if (!inTransfer.file || !inTransfer.file->isOpen()
+        || !inTransfer.file->flush())
+        return;
+
+    QFile resume(inTransfer.path + ".resume");
+
+    if (resume.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        resume.write(reinterpret_cast<const char*>(&inTransfer.received),
+            sizeof(inTransfer.received));
+        resume.write(inTransfer.validator);
+    }
+
+    inTransfer.checkpoint = inTransfer.received;
+}
+
+/// Forgets what the part file holds; the next checkpoint saves that.
+void DownloadManager::restart(Transfer& inTransfer)
+{
+    inTransfer.received = 0;
+    inTransfer.checkpoint = 0;
+    inTransfer.validator.clear();
+    inTransfer.hash->reset();
+}
+
+void DownloadManager::destroy(Transfer* inTransfer)
+{
+    delete inTransfer->file;
+    delete inTransfer->hash;
+    delete inTransfer;
+}
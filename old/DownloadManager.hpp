@@ -0,0 +1,91 @@
+#ifndef DOWNLOADMANAGER_HPP
+#define DOWNLOADMANAGER_HPP
+
+#include <QObject>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QUrl>
+
+/// Downloads files to disk. Every transfer goes through one network access
+/// manager, so requests to the same host reuse its keep-alive connections,
+/// and no more than a fixed number run at once; the rest wait their turn.
+///
+/// Each reply is drained through one fixed buffer straight into the file, and
+/// into a SHA-1 of the file as it goes, so nothing is ever converted or
+/// collected in memory. The file is written as <path>.part, preallocated as
+/// soon as its size is known, and renamed into place once complete (and
+/// matching the hash, if one was given). How far it got is saved beside it
+/// in <path>.resume every few megabytes and whenever a transfer fails, along
+/// with the file's ETag (or Last-Modified date), and the next download of
+/// the same path asks only for the rest with a Range header, made
+/// conditional on that validator with If-Range. Servers that ignore the
+/// range, or whose file has changed since, just send it all again, and a
+/// part with no validator to check it against is started over.
+class DownloadManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    DownloadManager(QObject* inParent = 0, int inMaxTransfers = 4);
+    ~DownloadManager();
+
+    /// inSize and inSha1 (in hex) may be left out when they are not known
+    /// ahead of time. A path that is already queued or downloading is not
+    /// downloaded again; the one finished() signal for it answers both.
+    void download(const QUrl& inUrl, const QString& inPath,
+        qint64 inSize = -1, const QByteArray& inSha1 = QByteArray());
+    void abortAll();
+
+    inline bool isIdle() const
+    {
+        return mQueue.isEmpty() && mActive.isEmpty();
+    }
+
+    bool isPending(const QString& inPath) const;
+
+signals:
+    void progress(QString inPath, qint64 inReceived, qint64 inSize);
+    void finished(QString inPath, bool inSuccess, QByteArray inSha1);
+    void allFinished();
+
+private slots:
+    void onReadyRead();
+    void onFinished();
+
+private:
+    struct Transfer
+    {
+        QUrl url;
+        QString path;
+        qint64 size;
+        QByteArray expectedSha1;
+        QNetworkReply* reply;
+        QFile* file;
+        QCryptographicHash* hash;
+        qint64 received;
+        qint64 checkpoint;
+        QByteArray validator;
+        bool isStarted;
+        bool isFailed;
+    };
+
+    void startNext();
+    bool start(Transfer& inTransfer);
+    void receive(Transfer& inTransfer);
+    void saveCheckpoint(Transfer& inTransfer);
+    void restart(Transfer& inTransfer);
+    void destroy(Transfer* inTransfer);
+
+    QNetworkAccessManager* mNetworkAccessManager;
+    int mMaxTransfers;
+    QByteArray mBuffer;
+    QList<Transfer*> mQueue;
+    QHash<QNetworkReply*, Transfer*> mActive;
+};
+
+#endif
@@ -23,13 +23,19 @@ SOURCES += main.cpp\
     CardActor.cpp \
     TableModel.cpp \
     TableActor.cpp \
-    PingModel.cpp \
-    PingActor.cpp
+    PingPool.cpp \
+    TransformHierarchy.cpp \
+    CardPile.cpp \
+    CardGrid.cpp \
+    TablePhysics.cpp \
+    ImageKernels.cpp \
+    DownloadManager.cpp
 
 HEADERS  += \
     Matrix4x4.hpp \
     SceneGraphNode.hpp \
     Vectors.hpp \
+    VectorKernels.hpp \
     CardModel.hpp \
     TrackballCamera.hpp \
     VertexBufferObject.hpp \
@@ -41,8 +47,13 @@ HEADERS  += \
     CardActor.hpp \
     TableModel.hpp \
     TableActor.hpp \
-    PingModel.hpp \
-    PingActor.hpp
+    PingPool.hpp \
+    TransformHierarchy.hpp \
+    CardPile.hpp \
+    CardGrid.hpp \
+    TablePhysics.hpp \
+    ImageKernels.hpp \
+    DownloadManager.hpp
 
 FORMS    += LoginWindow.ui
 
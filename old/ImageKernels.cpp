@@ -0,0 +1,227 @@
+#include "ImageKernels.hpp"
+#include <QVector>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define CGE_USE_SSE
+#   include <emmintrin.h>
+#endif
+
+namespace CGE
+{
+    /// The taps for one axis. Each target pixel reads a run of source pixels
+    /// starting at first; taps hanging off either edge fold onto the edge.
+    struct Filter
+    {
+        Filter(int inSourceSize, int inSize)
+        {
+            float scale = float(inSourceSize) / float(inSize);
+            float radius = qMax(scale, 1.0f);
+            stride = int(std::ceil(radius)) * 2 + 1;
+            first.resize(inSize);
+            counts.resize(inSize);
+            weights.fill(0.0f, inSize * stride);
+
+            for (int i = 0; i < inSize; ++i)
+            {
+                float center = (float(i) + 0.5f) * scale - 0.5f;
+                int low = int(std::floor(center - radius)) + 1;
+                int high = int(std::floor(center + radius));
+                first[i] = qBound(0, low, inSourceSize - 1);
+                counts[i] = qBound(0, high, inSourceSize - 1) - first[i] + 1;
+
+                float* w = weights.data() + i * stride;
+                float total = 0.0f;
+
+                for (int j = low; j <= high; ++j)
+                {
+                    float weight = 1.0f - qAbs(float(j) - center) / radius;
+
+                    if (weight <= 0.0f) continue;
+
+                    w[qBound(0, j, inSourceSize - 1) - first[i]] += weight;
+                    total += weight;
+                }
+
+                for (int k = 0; k < counts[i]; ++k)
+                    w[k] /= total;
+            }
+        }
+
+        int stride;
+        QVector<int> first;
+        QVector<int> counts;
+        QVector<float> weights;
+    };
+
+    /// Adds a weighted source row to a row of float channels.
+    static void accumulateRow(const unsigned char* inSource, int inCount,
+        float inWeight, float* inRow)
+    {
+        int x = 0;
+
+#ifdef CGE_USE_SSE
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 w = _mm_set1_ps(inWeight);
+
+        for (; x + 4 <= inCount; x += 4)
+        {
+            __m128i p = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(inSource + x * 4));
+            __m128i low = _mm_unpacklo_epi8(p, zero);
+            __m128i high = _mm_unpackhi_epi8(p, zero);
+            __m128 pixels[4] = {
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)),
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)),
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)),
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)) };
+            float* r = inRow + x * 4;
+
+            for (int k = 0; k < 4; ++k)
+            {
+                _mm_storeu_ps(r + k * 4, _mm_add_ps(_mm_loadu_ps(r + k * 4),
+                    _mm_mul_ps(pixels[k], w)));
+            }
+        }
+#endif
+
+        for (int i = x * 4; i < inCount * 4; ++i)
+            inRow[i] += float(inSource[i]) * inWeight;
+    }
+
+    static void filterRow(const float* inRow, const Filter& inFilter,
+        int inCount, unsigned char* inTarget)
+    {
+        const float* weights = inFilter.weights.constData();
+
+        for (int x = 0; x < inCount; ++x)
+        {
+            const float* p = inRow + inFilter.first[x] * 4;
+            const float* w = weights + x * inFilter.stride;
+            int taps = inFilter.counts[x];
+
+#ifdef CGE_USE_SSE
+            __m128 sum = _mm_setzero_ps();
+
+            for (int k = 0; k < taps; ++k)
+            {
+                sum = _mm_add_ps(sum,
+                    _mm_mul_ps(_mm_loadu_ps(p + k * 4), _mm_set1_ps(w[k])));
+            }
+
+            __m128i v = _mm_cvtps_epi32(sum);
+            v = _mm_packs_epi32(v, v);
+            v = _mm_packus_epi16(v, v);
+            int pixel = _mm_cvtsi128_si32(v);
+            memcpy(inTarget + x * 4, &pixel, 4);
+#else
+            for (int c = 0; c < 4; ++c)
+            {
+                float sum = 0.0f;
+
+                for (int k = 0; k < taps; ++k)
+                    sum += p[k * 4 + c] * w[k];
+
+                inTarget[x * 4 + c] = (unsigned char)qBound(0,
+                    int(sum + 0.5f), 255);
+            }
+#endif
+        }
+    }
+
+    void resampleImage(const QImage& inImage, int inWidth, int inHeight,
+        unsigned char* inTarget)
+    {
+        int sourceWidth = inImage.width();
+        int sourceHeight = inImage.height();
+
+        if (inWidth == sourceWidth && inHeight == sourceHeight)
+        {
+            for (int y = 0; y < inHeight; ++y)
+            {
+                memcpy(inTarget + (inHeight - 1 - y) * inWidth * 4,
+                    inImage.constScanLine(y), inWidth * 4);
+            }
+
+            return;
+        }
+
+        /// Rows are filtered first, into one row of floats at the source
+        /// width, and that row is then filtered across into the target.
+        Filter columns(sourceWidth, inWidth);
+        Filter rows(sourceHeight, inHeight);
+        QVector<float> row(sourceWidth * 4);
+
+        for (int y = 0; y < inHeight; ++y)
+        {
+            row.fill(0.0f);
+            const float* w = rows.weights.constData() + y * rows.stride;
+
+            for (int k = 0; k < rows.counts[y]; ++k)
+            {
+                accumulateRow(inImage.constScanLine(rows.first[y] + k),
+                    sourceWidth, w[k], row.data());
+            }
+
+            filterRow(row.constData(), columns, inWidth,
+                inTarget + (inHeight - 1 - y) * inWidth * 4);
+        }
+    }
+
+    void halveImage(const unsigned char* inPixels, int inWidth, int inHeight,
+        unsigned char* inTarget)
+    {
+        int width = qMax(inWidth / 2, 1);
+        int height = qMax(inHeight / 2, 1);
+        int stepX = inWidth > 1 ? 4 : 0;
+
+        for (int y = 0; y < height; ++y)
+        {
+            const unsigned char* top = inPixels
+                + qMin(y * 2, inHeight - 1) * inWidth * 4;
+            const unsigned char* bottom = inPixels
+                + qMin(y * 2 + 1, inHeight - 1) * inWidth * 4;
+            unsigned char* line = inTarget + y * width * 4;
+            int x = 0;
+
+#ifdef CGE_USE_SSE
+            /// Two target pixels from four source pixels in each row, summed
+            /// in 16 bits so the rounding matches the scalar loop exactly.
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i two = _mm_set1_epi16(2);
+
+            for (; stepX && x + 2 <= width; x += 2)
+            {
+                __m128i a = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(top + x * 8));
+                __m128i b = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(bottom + x * 8));
+                __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                    _mm_unpacklo_epi8(b, zero));
+                __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                    _mm_unpackhi_epi8(b, zero));
+                low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+                high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+                __m128i sum = _mm_unpacklo_epi64(low, high);
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(line + x * 4),
+                    _mm_packus_epi16(sum, sum));
+            }
+#endif
+
+            for (; x < width; ++x)
+            {
+                const unsigned char* a = top + x * 8;
+                const unsigned char* b = bottom + x * 8;
+
+                for (int k = 0; k < 4; ++k)
+                {
+                    line[x * 4 + k] =
+                        (a[k] + a[k + stepX] + b[k] + b[k + stepX] + 2) / 4;
+                }
+            }
+        }
+    }
+}
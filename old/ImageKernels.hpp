@@ -0,0 +1,25 @@
+#ifndef IMAGEKERNELS_HPP
+#define IMAGEKERNELS_HPP
+
+#include <QImage>
+
+/// These kernels get 32 bit images ready for OpenGL without going through
+/// QPainter or QGLWidget::bindTexture. Every channel is filtered alike, so
+/// ARGB32 pixels keep their order and can be handed to GL as BGRA as is. The
+/// SSE2 paths filter all four channels of a pixel at once.
+
+namespace CGE
+{
+    /// Scales inImage (ARGB32 or RGB32) to inWidth by inHeight pixels, tightly
+    /// packed and flipped bottom up, in a single pass. The filter is a
+    /// triangle, widened when shrinking so that every source pixel counts.
+    void resampleImage(const QImage& inImage, int inWidth, int inHeight,
+        unsigned char* inTarget);
+
+    /// Averages each 2 x 2 square of pixels (or pair, once a side is down to
+    /// one) into the next mip level.
+    void halveImage(const unsigned char* inPixels, int inWidth, int inHeight,
+        unsigned char* inTarget);
+}
+
+#endif
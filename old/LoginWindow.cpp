@@ -1,9 +1,6 @@
 #include "LoginWindow.hpp"
 #include "ui_LoginWindow.h"
 
-#include <QNetworkRequest>
-#include <QFile>
-#include <QTextOStream>
 #include <QMessageBox>
 
 LoginWindow::LoginWindow(QWidget *parent) :
@@ -13,7 +10,9 @@ LoginWindow::LoginWindow(QWidget *parent) :
     ui->setupUi(this);
     ui->playerLineEdit->setFocus();
 
-    mNetworkAccessManager = new QNetworkAccessManager(this);
+    mDownloadManager = new DownloadManager(this);
+    connect(mDownloadManager, SIGNAL(finished(QString, bool, QByteArray)),
+        this, SLOT(onDownloaded(QString, bool, QByteArray)));
 }
 
 LoginWindow::~LoginWindow()
@@ -28,34 +27,26 @@ void LoginWindow::on_playerLineEdit_returnPressed()
 
 void LoginWindow::on_loginButton_clicked()
 {
-    connect(mNetworkAccessManager, SIGNAL(finished(QNetworkReply*)), this, SLOT(finished(QNetworkReply*)));
+    // DROIDEKA_ASSET_URL points the download at another server, such as a
+    // local one for testing.
+    QByteArray url = qgetenv("DROIDEKA_ASSET_URL");
 
-    QNetworkRequest request;
-    request.setUrl(QUrl("http://qt.nokia.com/"));
+    if (url.isEmpty()) url = "http://qt.nokia.com/";
 
-    mNetworkReply = mNetworkAccessManager->get(request);
-    connect(mNetworkReply, SIGNAL(readyRead()), this, SLOT(onRead()));
+    mDownloadManager->download(QUrl::fromEncoded(url), QString("result.txt"));
 }
 
-void LoginWindow::onRead()
+void LoginWindow::onDownloaded(QString inPath, bool inSuccess,
+    QByteArray inSha1)
 {
-    QString response = QString(mNetworkReply->readAll().data());
-
-    QFile file;
-    file.setFileName(QString("result.txt"));
-    if (file.open(QIODevice::Append))
-    {
-        QTextStream out(&file);
-        out << response;
-        file.close();
-    }
-}
+    Q_UNUSED(inSha1);
 
-void LoginWindow::finished(QNetworkReply *networkReply)
-{
     QMessageBox box;
-    box.setInformativeText(QString("Download is done!"));
-    box.exec();
 
-    networkReply->deleteLater();
+    if (inSuccess)
+        box.setInformativeText(QString("Download is done!"));
+    else
+        box.setInformativeText(QString("Download of %1 failed.").arg(inPath));
+
+    box.exec();
 }
@@ -1,9 +1,8 @@
 #ifndef LOGINWINDOW_HPP
 #define LOGINWINDOW_HPP
 
+#include "DownloadManager.hpp"
 #include <QMainWindow>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
 
 namespace Ui {
 class LoginWindow;
@@ -20,13 +19,11 @@ public:
 private slots:
     void on_playerLineEdit_returnPressed();
     void on_loginButton_clicked();
-    void onRead();
-    void finished(QNetworkReply* networkReply);
+    void onDownloaded(QString inPath, bool inSuccess, QByteArray inSha1);
 
 private:
     Ui::LoginWindow* ui;
-    QNetworkAccessManager* mNetworkAccessManager;
-    QNetworkReply* mNetworkReply;
+    DownloadManager* mDownloadManager;
 };
 
 #endif
@@ -0,0 +1,154 @@
+#include "PingPool.hpp"
+#include <QDebug>
+#include <cmath>
+
+static const char* VertexShader =
+    "uniform mat4 uMatrix;\n"
+    "uniform float uTime;\n"
+    "uniform float uLifetime;\n"
+    "uniform float uRadius;\n"
+    "attribute vec2 aCorner;\n"
+    "attribute vec2 aCenter;\n"
+    "attribute vec3 aColor;\n"
+    "attribute float aSpawnTime;\n"
+    "varying vec3 vColor;\n"
+    "void main()\n"
+    "{\n"
+    "    float age = (uTime - aSpawnTime) / uLifetime;\n"
+    "    vColor = aColor;\n"
+    "    if (age < 0.0 || age >= 1.0)\n"
+    "    {\n"
+    "        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);\n"
+    "        return;\n"
+    "    }\n"
+    "    float radius = uRadius * (1.0 - age);\n"
+    "    gl_Position = uMatrix * vec4(aCenter + aCorner * radius, 0.0, 1.0);\n"
+    "}\n";
+
+static const char* FragmentShader =
+    "varying vec3 vColor;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = vec4(vColor, 1.0);\n"
+    "}\n";
+
+PingPool::PingPool(size_t inCapacity, size_t inSegments, float inLifetime,
+    float inRadius)
+    : mBuffer(QGLBuffer::VertexBuffer), mCapacity(inCapacity),
+      mSegments(inSegments), mNextSlot(0), mUsedSlots(0),
+      mLifetime(inLifetime), mRadius(inRadius), mLastSpawnTime(0.0f)
+{
+    /// Rings are stored as GL_LINES rather than GL_LINE_LOOP so that the
+    /// rings of every slot can go into the same draw.
+    mRing.resize(mSegments * 4);
+
+    for (size_t i = 0; i < mSegments; ++i)
+    {
+        float a = 3.1415926535898f * 2.0f * float(i) / float(mSegments);
+        float b = 3.1415926535898f * 2.0f * float(i + 1)
+            / float(mSegments);
+
+        mRing[i * 4 + 0] = sin(a);
+        mRing[i * 4 + 1] = cos(a);
+        mRing[i * 4 + 2] = sin(b);
+        mRing[i * 4 + 3] = cos(b);
+    }
+
+    mSlot.resize(mSegments * 2 * FloatsPerVertex);
+
+    /// Slots that have never been spawned are never drawn (see mUsedSlots),
+    /// so the buffer can start out uninitialized.
+    mBuffer.create();
+    mBuffer.setUsagePattern(QGLBuffer::DynamicDraw);
+    mBuffer.bind();
+    mBuffer.allocate(mCapacity * mSlot.size() * sizeof(GLfloat));
+    mBuffer.release();
+
+    mProgram.addShaderFromSourceCode(QGLShader::Vertex, VertexShader);
+    mProgram.addShaderFromSourceCode(QGLShader::Fragment, FragmentShader);
+
+    if (!mProgram.link())
+        qDebug() << "PingPool:" << mProgram.log();
+
+    mMatrixUniform = mProgram.uniformLocation("uMatrix");
+    mTimeUniform = mProgram.uniformLocation("uTime");
+    mLifetimeUniform = mProgram.uniformLocation("uLifetime");
+    mRadiusUniform = mProgram.uniformLocation("uRadius");
+    mCornerAttribute = mProgram.attributeLocation("aCorner");
+    mCenterAttribute = mProgram.attributeLocation("aCenter");
+    mColorAttribute = mProgram.attributeLocation("aColor");
+    mSpawnTimeAttribute = mProgram.attributeLocation("aSpawnTime");
+}
+
+PingPool::~PingPool()
+{
+    mBuffer.destroy();
+}
+
+void PingPool::spawn(float inX, float inY, float inRed, float inGreen,
+    float inBlue, float inTime)
+{
+    if (mCapacity == 0) return;
+
+    GLfloat* vertex = &mSlot[0];
+
+    for (size_t i = 0; i < mSegments * 2; ++i)
+    {
+        *vertex++ = mRing[i * 2 + 0];
+        *vertex++ = mRing[i * 2 + 1];
+        *vertex++ = inX;
+        *vertex++ = inY;
+        *vertex++ = inRed;
+        *vertex++ = inGreen;
+        *vertex++ = inBlue;
+        *vertex++ = inTime;
+    }
+
+    size_t slotBytes = mSlot.size() * sizeof(GLfloat);
+
+    mBuffer.bind();
+    mBuffer.write(int(mNextSlot * slotBytes), &mSlot[0], int(slotBytes));
+    mBuffer.release();
+
+    mNextSlot = (mNextSlot + 1) % mCapacity;
+    if (mUsedSlots < mCapacity) ++mUsedSlots;
+    mLastSpawnTime = inTime;
+}
+
+void PingPool::draw(const mat4f& inMatrix, float inTime)
+{
+    /// Once the newest ping has run its course, every slot is expired.
+    if (mUsedSlots == 0 || inTime - mLastSpawnTime >= mLifetime) return;
+
+    const GLfloat* matrix = inMatrix;
+    const int Stride = FloatsPerVertex * sizeof(GLfloat);
+
+    mProgram.bind();
+    mProgram.setUniformValue(mMatrixUniform,
+        reinterpret_cast<const GLfloat (*)[4]>(matrix));
+    mProgram.setUniformValue(mTimeUniform, inTime);
+    mProgram.setUniformValue(mLifetimeUniform, mLifetime);
+    mProgram.setUniformValue(mRadiusUniform, mRadius);
+
+    mBuffer.bind();
+    mProgram.enableAttributeArray(mCornerAttribute);
+    mProgram.enableAttributeArray(mCenterAttribute);
+    mProgram.enableAttributeArray(mColorAttribute);
+    mProgram.enableAttributeArray(mSpawnTimeAttribute);
+    mProgram.setAttributeBuffer(mCornerAttribute, GL_FLOAT, 0, 2, Stride);
+    mProgram.setAttributeBuffer(mCenterAttribute, GL_FLOAT,
+        2 * sizeof(GLfloat), 2, Stride);
+    mProgram.setAttributeBuffer(mColorAttribute, GL_FLOAT,
+        4 * sizeof(GLfloat), 3, Stride);
+    mProgram.setAttributeBuffer(mSpawnTimeAttribute, GL_FLOAT,
+        7 * sizeof(GLfloat), 1, Stride);
+
+    glDrawArrays(GL_LINES, 0, GLsizei(mUsedSlots * mSegments * 2));
+
+    mProgram.disableAttributeArray(mCornerAttribute);
+    mProgram.disableAttributeArray(mCenterAttribute);
+    mProgram.disableAttributeArray(mColorAttribute);
+    mProgram.disableAttributeArray(mSpawnTimeAttribute);
+    mBuffer.release();
+    mProgram.release();
+}
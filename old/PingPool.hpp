@@ -0,0 +1,57 @@
+#ifndef PINGPOOL_HPP
+#define PINGPOOL_HPP
+
+#include "Matrix4x4.hpp"
+#include <QGLBuffer>
+#include <QGLShaderProgram>
+#include <vector>
+
+/// A fixed number of ping rings that all share one vertex buffer and are all
+/// drawn with a single call. Every ping lasts equally long, so slots are handed
+/// out round robin and the slot being reused is always the oldest one; nothing
+/// is ever allocated or freed after construction.
+///
+/// Each slot holds the line segments of a unit ring along with the ping's
+/// center, color, and spawn time. The vertex shader works out how far along
+/// the ping is from the current time, so a ping costs nothing on the CPU after
+/// it is spawned.
+class PingPool
+{
+public:
+    PingPool(size_t inCapacity = 256, size_t inSegments = 16,
+        float inLifetime = 1.0f, float inRadius = 80.0f);
+    ~PingPool();
+
+    void spawn(float inX, float inY, float inRed, float inGreen,
+        float inBlue, float inTime);
+    void draw(const mat4f& inMatrix, float inTime);
+
+    inline size_t capacity() const { return mCapacity; }
+    inline float lifetime() const { return mLifetime; }
+
+private:
+    enum { FloatsPerVertex = 8 };
+
+    QGLShaderProgram mProgram;
+    QGLBuffer mBuffer;
+    std::vector<GLfloat> mRing;
+    std::vector<GLfloat> mSlot;
+    size_t mCapacity;
+    size_t mSegments;
+    size_t mNextSlot;
+    size_t mUsedSlots;
+    float mLifetime;
+    float mRadius;
+    float mLastSpawnTime;
+
+    int mMatrixUniform;
+    int mTimeUniform;
+    int mLifetimeUniform;
+    int mRadiusUniform;
+    int mCornerAttribute;
+    int mCenterAttribute;
+    int mColorAttribute;
+    int mSpawnTimeAttribute;
+};
+
+#endif
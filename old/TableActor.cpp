@@ -1,6 +1,7 @@
 #include "TableActor.hpp"
 
-TableActor::TableActor(TableModel& inModel) : mTableModel(inModel)
+TableActor::TableActor(TableModel& inModel, Actor& inParent)
+    : Actor(inParent), mTableModel(inModel)
 {
 }
 
@@ -7,7 +7,7 @@
 class TableActor : public Actor
 {
 public:
-    TableActor(TableModel& inModel);
+    TableActor(TableModel& inModel, Actor& inParent);
     virtual ~TableActor();
 
     virtual void draw();
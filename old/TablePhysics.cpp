@@ -0,0 +1,364 @@
+#include "TablePhysics.hpp"
+#include "CardActor.hpp"
+#include "CardPile.hpp"
+#include <cfloat>
+#include <cmath>
+
+/// A pile slower than this (in table units per second) for longer than the
+/// rest delay is put to sleep.
+static const float SleepSpeed = 1.0f;
+static const float RestDelay = 0.25f;
+
+TablePhysics::TablePhysics(float inFriction, float inRestitution)
+    : mFriction(inFriction), mRestitution(inRestitution), mMaxWidth(0.0f)
+{
+}
+
+TablePhysics::~TablePhysics()
+{
+}
+
+void TablePhysics::add(CardPile& inPile)
+{
+    if (mBodiesByPile.contains(&inPile) || inPile.isEmpty()) return;
+
+    size_t index;
+
+    if (mFreeBodies.empty())
+    {
+        index = mBodies.size();
+        mBodies.push_back(Body());
+    }
+    else
+    {
+        index = mFreeBodies.back();
+        mFreeBodies.pop_back();
+    }
+
+    Body& body = mBodies[index];
+    body.pile = &inPile;
+    body.state = Asleep;
+    body.velocityX = 0.0f;
+    body.velocityY = 0.0f;
+    body.restTime = 0.0f;
+    measure(index);
+
+    body.order = mOrder.size();
+    mOrder.push_back(index);
+    sort(index);
+
+    mBodiesByPile.insert(&inPile, index);
+}
+
+void TablePhysics::remove(CardPile& inPile)
+{
+    QHash<CardPile*, size_t>::Iterator i = mBodiesByPile.find(&inPile);
+
+    if (i == mBodiesByPile.end()) return;
+
+    size_t index = i.value();
+    Body& body = mBodies[index];
+
+    mOrder.erase(mOrder.begin() + body.order);
+
+    for (size_t j = body.order; j < mOrder.size(); ++j)
+        mBodies[mOrder[j]].order = j;
+
+    if (body.state == Awake)
+    {
+        for (size_t j = 0; j < mAwake.size(); ++j)
+        {
+            if (mAwake[j] == index)
+            {
+                mAwake[j] = mAwake.back();
+                mAwake.pop_back();
+                break;
+            }
+        }
+    }
+
+    body.pile = 0;
+    mFreeBodies.push_back(index);
+    mBodiesByPile.erase(i);
+}
+
+void TablePhysics::clear()
+{
+    mBodies.clear();
+    mFreeBodies.clear();
+    mOrder.clear();
+    mAwake.clear();
+    mBodiesByPile.clear();
+    mMaxWidth = 0.0f;
+}
+
+void TablePhysics::refresh(CardPile& inPile)
+{
+    QHash<CardPile*, size_t>::ConstIterator i =
+        mBodiesByPile.constFind(&inPile);
+
+    if (i != mBodiesByPile.constEnd())
+    {
+        measure(i.value());
+        sort(i.value());
+    }
+}
+
+void TablePhysics::hold(CardPile& inPile)
+{
+    add(inPile);
+
+    QHash<CardPile*, size_t>::ConstIterator i =
+        mBodiesByPile.constFind(&inPile);
+
+    if (i == mBodiesByPile.constEnd()) return;
+
+    size_t index = i.value();
+    Body& body = mBodies[index];
+
+    if (body.state == Awake)
+    {
+        for (size_t j = 0; j < mAwake.size(); ++j)
+        {
+            if (mAwake[j] == index)
+            {
+                mAwake[j] = mAwake.back();
+                mAwake.pop_back();
+                break;
+            }
+        }
+    }
+
+    body.state = Held;
+    body.velocityX = 0.0f;
+    body.velocityY = 0.0f;
+}
+
+void TablePhysics::toss(CardPile& inPile, float inVelocityX,
+    float inVelocityY)
+{
+    add(inPile);
+
+    QHash<CardPile*, size_t>::ConstIterator i =
+        mBodiesByPile.constFind(&inPile);
+
+    if (i == mBodiesByPile.constEnd()) return;
+
+    size_t index = i.value();
+    Body& body = mBodies[index];
+
+    if (body.state == Held) body.state = Asleep;
+
+    measure(index);
+    sort(index);
+    wake(index);
+    body.velocityX = inVelocityX;
+    body.velocityY = inVelocityY;
+}
+
+/// Piles that get woken by a collision are appended to mAwake while it is
+/// being walked, so they are resolved in the same step.
+void TablePhysics::step(float inSeconds, QVector<CardPile*>& inMoved)
+{
+    if (mAwake.empty() || inSeconds <= 0.0f) return;
+
+    for (size_t i = 0; i < mAwake.size(); ++i)
+    {
+        Body& body = mBodies[mAwake[i]];
+        float speed = sqrt(body.velocityX * body.velocityX
+            + body.velocityY * body.velocityY);
+
+        if (speed > 0.0f)
+        {
+            float slowed = speed - mFriction * inSeconds;
+            float scale = slowed > 0.0f ? slowed / speed : 0.0f;
+            body.velocityX *= scale;
+            body.velocityY *= scale;
+        }
+
+        translate(mAwake[i], body.velocityX * inSeconds,
+            body.velocityY * inSeconds);
+    }
+
+    for (size_t i = 0; i < mAwake.size(); ++i)
+        collide(mAwake[i]);
+
+    for (size_t i = 0; i < mAwake.size(); ++i)
+        inMoved.append(mBodies[mAwake[i]].pile);
+
+    for (size_t i = 0; i < mAwake.size(); )
+    {
+        Body& body = mBodies[mAwake[i]];
+        float speedSquared = body.velocityX * body.velocityX
+            + body.velocityY * body.velocityY;
+
+        body.restTime = speedSquared < SleepSpeed * SleepSpeed
+            ? body.restTime + inSeconds : 0.0f;
+
+        if (body.restTime >= RestDelay)
+        {
+            body.state = Asleep;
+            body.velocityX = 0.0f;
+            body.velocityY = 0.0f;
+            mAwake[i] = mAwake.back();
+            mAwake.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void TablePhysics::measure(size_t inBody)
+{
+    Body& body = mBodies[inBody];
+    CardPile& pile = *body.pile;
+
+    body.minX = FLT_MAX;
+    body.minY = FLT_MAX;
+    body.maxX = -FLT_MAX;
+    body.maxY = -FLT_MAX;
+
+    for (size_t i = 0; i < pile.size(); ++i)
+    {
+        const CardActor& cardActor = *pile.at(i);
+        body.minX = qMin(body.minX, cardActor.x() - cardActor.radiusX());
+        body.minY = qMin(body.minY, cardActor.y() - cardActor.radiusY());
+        body.maxX = qMax(body.maxX, cardActor.x() + cardActor.radiusX());
+        body.maxY = qMax(body.maxY, cardActor.y() + cardActor.radiusY());
+    }
+
+    mMaxWidth = qMax(mMaxWidth, body.maxX - body.minX);
+}
+
+void TablePhysics::wake(size_t inBody)
+{
+    Body& body = mBodies[inBody];
+
+    if (body.state == Asleep)
+    {
+        body.state = Awake;
+        body.restTime = 0.0f;
+        mAwake.push_back(inBody);
+    }
+}
+
+void TablePhysics::translate(size_t inBody, float inDeltaX, float inDeltaY)
+{
+    if (inDeltaX == 0.0f && inDeltaY == 0.0f) return;
+
+    Body& body = mBodies[inBody];
+    body.pile->move(inDeltaX, inDeltaY);
+    body.minX += inDeltaX;
+    body.maxX += inDeltaX;
+    body.minY += inDeltaY;
+    body.maxY += inDeltaY;
+    sort(inBody);
+}
+
+/// An insertion sort step for one body; it only travels as far as it moved.
+void TablePhysics::sort(size_t inBody)
+{
+    size_t i = mBodies[inBody].order;
+    float minX = mBodies[inBody].minX;
+
+    while (i > 0 && mBodies[mOrder[i - 1]].minX > minX)
+    {
+        mOrder[i] = mOrder[i - 1];
+        mBodies[mOrder[i]].order = i;
+        --i;
+    }
+
+    while (i + 1 < mOrder.size() && mBodies[mOrder[i + 1]].minX < minX)
+    {
+        mOrder[i] = mOrder[i + 1];
+        mBodies[mOrder[i]].order = i;
+        ++i;
+    }
+
+    mOrder[i] = inBody;
+    mBodies[inBody].order = i;
+}
+
+/// Resolving a contact moves bodies (and therefore reorders mOrder), so the
+/// overlapping neighbors are gathered before any of them are resolved.
+void TablePhysics::collide(size_t inBody)
+{
+    const Body& body = mBodies[inBody];
+    mCandidates.clear();
+
+    for (size_t i = body.order; i-- > 0; )
+    {
+        const Body& other = mBodies[mOrder[i]];
+
+        if (other.minX < body.minX - mMaxWidth) break;
+
+        if (other.maxX > body.minX) mCandidates.push_back(mOrder[i]);
+    }
+
+    for (size_t i = body.order + 1; i < mOrder.size(); ++i)
+    {
+        const Body& other = mBodies[mOrder[i]];
+
+        if (other.minX >= body.maxX) break;
+
+        mCandidates.push_back(mOrder[i]);
+    }
+
+    for (size_t i = 0; i < mCandidates.size(); ++i)
+    {
+        const Body& other = mBodies[mCandidates[i]];
+
+        if (other.state != Held && other.maxY > body.minY
+            && other.minY < body.maxY)
+            resolve(inBody, mCandidates[i]);
+    }
+}
+
+/// Both piles are treated as having equal mass. They are pushed apart along
+/// the axis of least penetration, and any velocity carrying them into each
+/// other is exchanged (scaled by the restitution).
+void TablePhysics::resolve(size_t inA, size_t inB)
+{
+    Body& a = mBodies[inA];
+    Body& b = mBodies[inB];
+
+    float overlapX = qMin(a.maxX - b.minX, b.maxX - a.minX);
+    float overlapY = qMin(a.maxY - b.minY, b.maxY - a.minY);
+
+    if (overlapX <= 0.0f || overlapY <= 0.0f) return;
+
+    wake(inB);
+
+    float normalX = 0.0f;
+    float normalY = 0.0f;
+    float depth;
+
+    if (overlapX < overlapY)
+    {
+        normalX = a.minX + a.maxX < b.minX + b.maxX ? 1.0f : -1.0f;
+        depth = overlapX;
+    }
+    else
+    {
+        normalY = a.minY + a.maxY < b.minY + b.maxY ? 1.0f : -1.0f;
+        depth = overlapY;
+    }
+
+    float approach = (a.velocityX - b.velocityX) * normalX
+        + (a.velocityY - b.velocityY) * normalY;
+
+    if (approach > 0.0f)
+    {
+        float impulse = approach * (1.0f + mRestitution) * 0.5f;
+        a.velocityX -= impulse * normalX;
+        a.velocityY -= impulse * normalY;
+        b.velocityX += impulse * normalX;
+        b.velocityY += impulse * normalY;
+    }
+
+    float half = depth * 0.5f;
+    translate(inA, -normalX * half, -normalY * half);
+    translate(inB, normalX * half, normalY * half);
+}
@@ -0,0 +1,79 @@
+#ifndef TABLEPHYSICS_HPP
+#define TABLEPHYSICS_HPP
+
+#include <QHash>
+#include <QVector>
+#include <vector>
+
+class CardPile;
+
+/// A lightweight 2.5D simulation of piles sliding across the table. Piles are
+/// treated as axis-aligned boxes that slow down under constant friction, push
+/// each other apart when they collide, and go to sleep once they have been
+/// nearly still for a moment.
+///
+/// Sleeping piles are not simulated at all. Broadphase is sweep and prune:
+/// every pile is kept sorted by the left edge of its box, so an awake pile only
+/// has to look at the neighbors whose left edges lie within one pile width of
+/// its own. Since piles only move a little per step, keeping the order sorted
+/// is a matter of nudging each awake pile a few places along.
+class TablePhysics
+{
+public:
+    TablePhysics(float inFriction = 60.0f, float inRestitution = 0.3f);
+    ~TablePhysics();
+
+    void add(CardPile& inPile);
+    void remove(CardPile& inPile);
+    void clear();
+
+    /// Recomputes the box of a pile whose cards changed.
+    void refresh(CardPile& inPile);
+
+    /// Takes a pile out of the simulation while the user is holding it.
+    void hold(CardPile& inPile);
+
+    /// Lets go of a pile with the given velocity (in table units per second).
+    void toss(CardPile& inPile, float inVelocityX, float inVelocityY);
+
+    /// Advances the simulation and lists every pile that moved.
+    void step(float inSeconds, QVector<CardPile*>& inMoved);
+
+    inline size_t awakeCount() const { return mAwake.size(); }
+
+private:
+    enum State { Asleep, Awake, Held };
+
+    struct Body
+    {
+        CardPile* pile;
+        State state;
+        float velocityX;
+        float velocityY;
+        float restTime;
+        float minX;
+        float minY;
+        float maxX;
+        float maxY;
+        size_t order;
+    };
+
+    void measure(size_t inBody);
+    void wake(size_t inBody);
+    void translate(size_t inBody, float inDeltaX, float inDeltaY);
+    void sort(size_t inBody);
+    void collide(size_t inBody);
+    void resolve(size_t inA, size_t inB);
+
+    float mFriction;
+    float mRestitution;
+    float mMaxWidth;
+    std::vector<Body> mBodies;
+    std::vector<size_t> mFreeBodies;
+    std::vector<size_t> mOrder;
+    std::vector<size_t> mAwake;
+    std::vector<size_t> mCandidates;
+    QHash<CardPile*, size_t> mBodiesByPile;
+};
+
+#endif
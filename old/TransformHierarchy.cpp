@@ -0,0 +1,298 @@
+#include "TransformHierarchy.hpp"
+#include <algorithm>
+
+const TransformHierarchy::Node TransformHierarchy::NoNode = size_t(-1);
+
+template<typename T>
+static void rotateRange(std::vector<T>& inVector, size_t inFirst,
+    size_t inMiddle, size_t inLast)
+{
+    std::rotate(inVector.begin() + inFirst, inVector.begin() + inMiddle,
+        inVector.begin() + inLast);
+}
+
+template<typename T>
+static void insertAt(std::vector<T>& inVector, size_t inIndex,
+    const T& inValue)
+{
+    inVector.insert(inVector.begin() + inIndex, inValue);
+}
+
+template<typename T>
+static void eraseAt(std::vector<T>& inVector, size_t inIndex)
+{
+    inVector.erase(inVector.begin() + inIndex);
+}
+
+TransformHierarchy::TransformHierarchy()
+    : mDirtyCount(0), mUpdateStamp(0), mHasUpdated(false)
+{
+}
+
+TransformHierarchy::~TransformHierarchy()
+{
+}
+
+TransformHierarchy::Node TransformHierarchy::createNode(Node inParent)
+{
+    size_t parentIndex = inParent == NoNode ? NoNode : mSlots[inParent];
+    size_t index = parentIndex == NoNode ? mHandles.size()
+        : parentIndex + mSubtreeSizes[parentIndex];
+
+    Node outNode;
+
+    if (mFreeHandles.empty())
+    {
+        outNode = mSlots.size();
+        mSlots.push_back(index);
+    }
+    else
+    {
+        outNode = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    }
+
+    insertAt(mLocalMatrices, index, mat4f());
+    insertAt(mModelMatrices, index, mat4f());
+    insertAt(mModelViewMatrices, index, mat4f());
+    insertAt(mParents, index, parentIndex);
+    insertAt(mSubtreeSizes, index, size_t(1));
+    insertAt(mUpdateStamps, index, 0u);
+    insertAt(mDirty, index, static_cast<unsigned char>(1));
+    insertAt(mHandles, index, outNode);
+
+    /// Everything at or after the insertion point moved down by one.
+    for (size_t i = index + 1; i < mParents.size(); ++i)
+    {
+        if (mParents[i] != NoNode && mParents[i] >= index)
+            ++mParents[i];
+    }
+
+    adjustAncestors(index, 1);
+    refreshSlots(index, mHandles.size());
+    ++mDirtyCount;
+
+    return outNode;
+}
+
+/// Like SceneGraphNode, destroying a node orphans its children rather than
+/// destroying them. Each child subtree becomes a root of its own.
+void TransformHierarchy::destroyNode(Node inNode)
+{
+    size_t index = mSlots[inNode];
+
+    while (mSubtreeSizes[index] > 1)
+    {
+        setParent(mHandles[index + 1], NoNode);
+        index = mSlots[inNode];
+    }
+
+    adjustAncestors(index, -1);
+
+    if (mDirty[index]) --mDirtyCount;
+
+    eraseAt(mLocalMatrices, index);
+    eraseAt(mModelMatrices, index);
+    eraseAt(mModelViewMatrices, index);
+    eraseAt(mParents, index);
+    eraseAt(mSubtreeSizes, index);
+    eraseAt(mUpdateStamps, index);
+    eraseAt(mDirty, index);
+    eraseAt(mHandles, index);
+
+    for (size_t i = index; i < mParents.size(); ++i)
+    {
+        if (mParents[i] != NoNode && mParents[i] > index)
+            --mParents[i];
+    }
+
+    refreshSlots(index, mHandles.size());
+    mSlots[inNode] = NoNode;
+    mFreeHandles.push_back(inNode);
+}
+
+TransformHierarchy::Node TransformHierarchy::parent(Node inNode) const
+{
+    size_t parentIndex = mParents[mSlots[inNode]];
+    return parentIndex == NoNode ? NoNode : mHandles[parentIndex];
+}
+
+/// Reparenting moves the node's contiguous subtree to the end of the new
+/// parent's subtree. Only the range between the old and new positions is
+/// shuffled; the rest of the hierarchy keeps its order. A node cannot become
+/// a child of its own descendant.
+bool TransformHierarchy::setParent(Node inNode, Node inParent)
+{
+    size_t index = mSlots[inNode];
+    size_t size = mSubtreeSizes[index];
+    size_t parentIndex = inParent == NoNode ? NoNode : mSlots[inParent];
+
+    if (parentIndex != NoNode && parentIndex >= index
+        && parentIndex < index + size)
+        return false;
+
+    if (mParents[index] == parentIndex) return true;
+
+    size_t destination = parentIndex == NoNode ? mHandles.size()
+        : parentIndex + mSubtreeSizes[parentIndex];
+
+    adjustAncestors(index, -long(size));
+    index = moveSubtree(index, destination);
+
+    mParents[index] = inParent == NoNode ? NoNode : mSlots[inParent];
+    adjustAncestors(index, long(size));
+
+    if (!mDirty[index])
+    {
+        mDirty[index] = 1;
+        ++mDirtyCount;
+    }
+
+    return true;
+}
+
+mat4f& TransformHierarchy::changeLocalMatrix(Node inNode)
+{
+    size_t index = mSlots[inNode];
+
+    if (!mDirty[index])
+    {
+        mDirty[index] = 1;
+        ++mDirtyCount;
+    }
+
+    return mLocalMatrices[index];
+}
+
+void TransformHierarchy::setLocalMatrix(Node inNode, const mat4f& inMatrix)
+{
+    changeLocalMatrix(inNode) = inMatrix;
+}
+
+bool TransformHierarchy::wasUpdated(Node inNode) const
+{
+    return mUpdateStamps[mSlots[inNode]] == mUpdateStamp;
+}
+
+/// One forward sweep. Because parents precede their children, a parent's
+/// model matrix (and whether it changed during this sweep) is always known by
+/// the time its children are reached. A change of view matrix only costs one
+/// multiply per node; model matrices are left alone unless dirty.
+void TransformHierarchy::update(const mat4f& inViewMatrix)
+{
+    bool viewChanged = !mHasUpdated || mViewMatrix != inViewMatrix;
+    ++mUpdateStamp;
+
+    if (!viewChanged && !mDirtyCount) return;
+
+    mViewMatrix = inViewMatrix;
+
+    size_t count = mHandles.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t p = mParents[i];
+        bool changed = mDirty[i]
+            || (p != NoNode && mUpdateStamps[p] == mUpdateStamp);
+
+        if (changed)
+        {
+            if (p == NoNode)
+                mModelMatrices[i] = mLocalMatrices[i];
+            else
+                mModelMatrices[i].multiply(mModelMatrices[p],
+                    mLocalMatrices[i]);
+
+            mUpdateStamps[i] = mUpdateStamp;
+            mDirty[i] = 0;
+        }
+
+        if (changed || viewChanged)
+            mModelViewMatrices[i].multiply(mViewMatrix, mModelMatrices[i]);
+    }
+
+    mDirtyCount = 0;
+    mHasUpdated = true;
+}
+
+/// Moves the subtree starting at inIndex so that it begins just before
+/// inDestination (expressed in the current ordering). Returns the new index of
+/// the subtree's root.
+size_t TransformHierarchy::moveSubtree(size_t inIndex, size_t inDestination)
+{
+    size_t size = mSubtreeSizes[inIndex];
+
+    if (inDestination >= inIndex && inDestination <= inIndex + size)
+        return inIndex;
+
+    size_t first;
+    size_t middle;
+    size_t last;
+    size_t outIndex;
+
+    if (inDestination > inIndex)
+    {
+        first = inIndex;
+        middle = inIndex + size;
+        last = inDestination;
+        outIndex = inDestination - size;
+    }
+    else
+    {
+        first = inDestination;
+        middle = inIndex;
+        last = inIndex + size;
+        outIndex = inDestination;
+    }
+
+    rotateRange(mLocalMatrices, first, middle, last);
+    rotateRange(mModelMatrices, first, middle, last);
+    rotateRange(mModelViewMatrices, first, middle, last);
+    rotateRange(mParents, first, middle, last);
+    rotateRange(mSubtreeSizes, first, middle, last);
+    rotateRange(mUpdateStamps, first, middle, last);
+    rotateRange(mDirty, first, middle, last);
+    rotateRange(mHandles, first, middle, last);
+
+    remapParents(first, inIndex, size, outIndex);
+    refreshSlots(first, last);
+
+    return outIndex;
+}
+
+void TransformHierarchy::adjustAncestors(size_t inIndex, long inDelta)
+{
+    for (size_t i = mParents[inIndex]; i != NoNode; i = mParents[i])
+        mSubtreeSizes[i] = size_t(long(mSubtreeSizes[i]) + inDelta);
+}
+
+/// After a block of inBlockSize nodes moved from inBlockFirst to
+/// inNewBlockFirst, every stored parent index at or after inFirst is
+/// translated to the new ordering. Nodes before inFirst cannot reference
+/// anything that moved since their parents precede them.
+void TransformHierarchy::remapParents(size_t inFirst, size_t inBlockFirst,
+    size_t inBlockSize, size_t inNewBlockFirst)
+{
+    size_t blockLast = inBlockFirst + inBlockSize;
+
+    for (size_t i = inFirst; i < mParents.size(); ++i)
+    {
+        size_t p = mParents[i];
+
+        if (p == NoNode || p < inFirst) continue;
+
+        if (p >= inBlockFirst && p < blockLast)
+            mParents[i] = p - inBlockFirst + inNewBlockFirst;
+        else if (inNewBlockFirst > inBlockFirst && p >= blockLast
+            && p < inNewBlockFirst + inBlockSize)
+            mParents[i] = p - inBlockSize;
+        else if (inNewBlockFirst < inBlockFirst && p >= inNewBlockFirst
+            && p < inBlockFirst)
+            mParents[i] = p + inBlockSize;
+    }
+}
+
+void TransformHierarchy::refreshSlots(size_t inFirst, size_t inLast)
+{
+    for (size_t i = inFirst; i < inLast; ++i)
+        mSlots[mHandles[i]] = i;
+}
@@ -0,0 +1,86 @@
+#ifndef TRANSFORMHIERARCHY_HPP
+#define TRANSFORMHIERARCHY_HPP
+
+#include "Matrix4x4.hpp"
+#include <vector>
+
+/// This is the flattened counterpart of SceneGraphNode. Rather than each node
+/// owning a list of child pointers, every node lives in a set of parallel
+/// arrays kept in depth-first order: a parent always comes before its
+/// children, and every subtree occupies one contiguous range. Updating the
+/// hierarchy is then a single forward sweep over the arrays with no recursion
+/// and no virtual calls, and only nodes that are dirty (or whose parent
+/// changed this sweep) pay for a model matrix multiply.
+///
+/// Nodes are referred to by handles. A handle stays valid while its node is
+/// moved around inside the arrays (by reparenting or by other nodes being
+/// created or destroyed) and is only recycled once the node is destroyed.
+class TransformHierarchy
+{
+public:
+    typedef size_t Node;
+    static const Node NoNode;
+
+    TransformHierarchy();
+    ~TransformHierarchy();
+
+    inline size_t size() const { return mHandles.size(); }
+
+    Node createNode(Node inParent = NoNode);
+    void destroyNode(Node inNode);
+
+    Node parent(Node inNode) const;
+    bool setParent(Node inNode, Node inParent);
+
+    inline const mat4f& localMatrix(Node inNode) const
+    {
+        return mLocalMatrices[mSlots[inNode]];
+    }
+
+    inline const mat4f& modelMatrix(Node inNode) const
+    {
+        return mModelMatrices[mSlots[inNode]];
+    }
+
+    inline const mat4f& modelViewMatrix(Node inNode) const
+    {
+        return mModelViewMatrices[mSlots[inNode]];
+    }
+
+    /// Granting write access to the local matrix marks the node dirty.
+    mat4f& changeLocalMatrix(Node inNode);
+    void setLocalMatrix(Node inNode, const mat4f& inMatrix);
+
+    /// True if the node's model matrix was recomputed by the latest update.
+    bool wasUpdated(Node inNode) const;
+
+    void update(const mat4f& inViewMatrix);
+
+private:
+    size_t moveSubtree(size_t inIndex, size_t inDestination);
+    void adjustAncestors(size_t inIndex, long inDelta);
+    void remapParents(size_t inFirst, size_t inBlockFirst, size_t inBlockSize,
+        size_t inNewBlockFirst);
+    void refreshSlots(size_t inFirst, size_t inLast);
+
+    /// dense arrays in depth-first order
+    std::vector<mat4f> mLocalMatrices;
+    std::vector<mat4f> mModelMatrices;
+    std::vector<mat4f> mModelViewMatrices;
+    std::vector<size_t> mParents;
+    std::vector<size_t> mSubtreeSizes;
+    std::vector<unsigned int> mUpdateStamps;
+    std::vector<unsigned char> mDirty;
+    std::vector<Node> mHandles;
+
+    /// handle to dense index
+    std::vector<size_t> mSlots;
+    std::vector<Node> mFreeHandles;
+
+    mat4f mViewMatrix;
+    size_t mDirtyCount;
+    unsigned int mUpdateStamp;
+    bool mHasUpdated;
+};
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef VECTORKERNELS_HPP
+#define VECTORKERNELS_HPP
+
+#include "Vectors.hpp"
+#include "Matrix4x4.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define CGE_USE_SSE
+#   include <emmintrin.h>
+#endif
+
+/// These kernels operate on contiguous arrays of vectors rather than on one
+/// vector at a time. Picking, culling and the card facing test all need the
+/// same operation applied to every card, and running them as one batch lets
+/// the compiler (or the SSE paths below) process several vectors per
+/// instruction.
+///
+/// Vectors are read with a caller-specified stride (in elements), so the same
+/// kernel works on tightly packed vec3f arrays and on vec4f arrays. The SSE
+/// paths are only taken for float data with a stride of 4; everything else
+/// falls back to the scalar loop.
+
+namespace CGE
+{
+    /// Transforms inCount homogeneous points (4 elements each) by inMatrix.
+    /// Like Matrix4x4::transform, each result is divided by its W component.
+    template<typename T>
+    void transformPoints(const Matrix4x4<T>& inMatrix, const T* inPoints,
+        T* inResults, size_t inCount)
+    {
+        for (size_t i = 0; i < inCount; ++i)
+            inMatrix.transform(inPoints + i * 4, inResults + i * 4);
+    }
+
+    /// Normalizes the XYZ portion of inCount vectors in place.
+    template<typename T>
+    void normalizeVectors3(T* inVectors, size_t inCount, size_t inStride = 3)
+    {
+        for (size_t i = 0; i < inCount; ++i)
+            normalize3(inVectors + i * inStride);
+    }
+
+    /// Computes the XYZ dot product of inCount pairs of vectors.
+    template<typename T>
+    void dotProducts3(const T* inLVectors, const T* inRVectors, T* inAnswers,
+        size_t inCount, size_t inStride = 3)
+    {
+        for (size_t i = 0; i < inCount; ++i)
+        {
+            size_t offset = i * inStride;
+            inAnswers[i] = dot(inLVectors + offset, inRVectors + offset);
+        }
+    }
+
+#ifdef CGE_USE_SSE
+    /// The matrix is stored in column-major order, so each column can be
+    /// loaded directly and the product becomes four multiply-adds per point.
+    inline void transformPoints(const Matrix4x4<float>& inMatrix,
+        const float* inPoints, float* inResults, size_t inCount)
+    {
+        const float* m = inMatrix;
+        const __m128 c0 = _mm_loadu_ps(m);
+        const __m128 c1 = _mm_loadu_ps(m + 4);
+        const __m128 c2 = _mm_loadu_ps(m + 8);
+        const __m128 c3 = _mm_loadu_ps(m + 12);
+        const __m128 maskXYZ = _mm_castsi128_ps(
+            _mm_set_epi32(0, -1, -1, -1));
+        const __m128 oneW = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+
+        for (size_t i = 0; i < inCount; ++i)
+        {
+            const float* p = inPoints + i * 4;
+
+            __m128 r = _mm_mul_ps(c0, _mm_set1_ps(p[0]));
+            r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(p[1])));
+            r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(p[2])));
+            r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(p[3])));
+
+            __m128 w = _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3));
+            r = _mm_div_ps(r, w);
+            r = _mm_or_ps(_mm_and_ps(r, maskXYZ), oneW);
+
+            _mm_storeu_ps(inResults + i * 4, r);
+        }
+    }
+
+    /// Four vectors are transposed into X, Y and Z lanes so that four lengths
+    /// are computed at once.
+    inline void normalizeVectors3(float* inVectors, size_t inCount,
+        size_t inStride = 3)
+    {
+        size_t i = 0;
+
+        if (inStride == 4)
+        {
+            const __m128 one = _mm_set1_ps(1.0f);
+
+            for (; i + 4 <= inCount; i += 4)
+            {
+                float* v = inVectors + i * 4;
+                __m128 x = _mm_loadu_ps(v);
+                __m128 y = _mm_loadu_ps(v + 4);
+                __m128 z = _mm_loadu_ps(v + 8);
+                __m128 w = _mm_loadu_ps(v + 12);
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+
+                __m128 lengths = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x),
+                    _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+                __m128 scale = _mm_div_ps(one, _mm_sqrt_ps(lengths));
+
+                x = _mm_mul_ps(x, scale);
+                y = _mm_mul_ps(y, scale);
+                z = _mm_mul_ps(z, scale);
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+
+                _mm_storeu_ps(v, x);
+                _mm_storeu_ps(v + 4, y);
+                _mm_storeu_ps(v + 8, z);
+                _mm_storeu_ps(v + 12, w);
+            }
+        }
+
+        for (; i < inCount; ++i)
+            normalize3(inVectors + i * inStride);
+    }
+
+    inline void dotProducts3(const float* inLVectors, const float* inRVectors,
+        float* inAnswers, size_t inCount, size_t inStride = 3)
+    {
+        size_t i = 0;
+
+        if (inStride == 4)
+        {
+            for (; i + 4 <= inCount; i += 4)
+            {
+                const float* l = inLVectors + i * 4;
+                const float* r = inRVectors + i * 4;
+
+                __m128 lx = _mm_loadu_ps(l);
+                __m128 ly = _mm_loadu_ps(l + 4);
+                __m128 lz = _mm_loadu_ps(l + 8);
+                __m128 lw = _mm_loadu_ps(l + 12);
+                _MM_TRANSPOSE4_PS(lx, ly, lz, lw);
+
+                __m128 rx = _mm_loadu_ps(r);
+                __m128 ry = _mm_loadu_ps(r + 4);
+                __m128 rz = _mm_loadu_ps(r + 8);
+                __m128 rw = _mm_loadu_ps(r + 12);
+                _MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+
+                __m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, rx),
+                    _mm_mul_ps(ly, ry)), _mm_mul_ps(lz, rz));
+
+                _mm_storeu_ps(inAnswers + i, sum);
+            }
+        }
+
+        for (; i < inCount; ++i)
+        {
+            size_t offset = i * inStride;
+            inAnswers[i] = dot(inLVectors + offset, inRVectors + offset);
+        }
+    }
+#endif
+}
+
+#endif
@@ -84,10 +84,204 @@ namespace CGE
             + inLVector[2] * inRVector[2];
     }
 
+    /// /// /// vector expressions /// /// ///
+
+    /// Every vector expression derives from this class and provides its own
+    /// element access. Arithmetic on vectors builds a tree of these lightweight
+    /// nodes instead of temporary vectors, and the whole tree is evaluated in
+    /// a single loop once it is assigned to a real Vector.
+    template<typename T, size_t N, typename E>
+    class VectorExpression
+    {
+        public:
+            inline T operator[](size_t inIndex) const
+            {
+                return static_cast<const E&>(*this)[inIndex];
+            }
+
+            inline const E& expression() const
+            {
+                return static_cast<const E&>(*this);
+            }
+    };
+
+    template<typename T, size_t N, typename L, typename R>
+    class VectorSum : public VectorExpression<T, N, VectorSum<T, N, L, R> >
+    {
+        public:
+            inline VectorSum(const L& inLExpression, const R& inRExpression)
+                : mL(inLExpression), mR(inRExpression)
+            {
+            }
+
+            inline T operator[](size_t inIndex) const
+            {
+                return mL[inIndex] + mR[inIndex];
+            }
+
+        private:
+            const L& mL;
+            const R& mR;
+    };
+
+    template<typename T, size_t N, typename L, typename R>
+    class VectorDifference
+        : public VectorExpression<T, N, VectorDifference<T, N, L, R> >
+    {
+        public:
+            inline VectorDifference(const L& inLExpression,
+                const R& inRExpression)
+                : mL(inLExpression), mR(inRExpression)
+            {
+            }
+
+            inline T operator[](size_t inIndex) const
+            {
+                return mL[inIndex] - mR[inIndex];
+            }
+
+        private:
+            const L& mL;
+            const R& mR;
+    };
+
+    template<typename T, size_t N, typename E>
+    class VectorScale : public VectorExpression<T, N, VectorScale<T, N, E> >
+    {
+        public:
+            inline VectorScale(const E& inExpression, T inScale)
+                : mE(inExpression), mScale(inScale)
+            {
+            }
+
+            inline T operator[](size_t inIndex) const
+            {
+                return mE[inIndex] * mScale;
+            }
+
+        private:
+            const E& mE;
+            T mScale;
+    };
+
+    /// Divides each element rather than multiplying by the reciprocal, which
+    /// would be zero for integral T.
+    template<typename T, size_t N, typename E>
+    class VectorQuotient
+        : public VectorExpression<T, N, VectorQuotient<T, N, E> >
+    {
+        public:
+            inline VectorQuotient(const E& inExpression, T inDivisor)
+                : mE(inExpression), mDivisor(inDivisor)
+            {
+            }
+
+            inline T operator[](size_t inIndex) const
+            {
+                return mE[inIndex] / mDivisor;
+            }
+
+        private:
+            const E& mE;
+            T mDivisor;
+    };
+
+    template<typename T, size_t N, typename E>
+    class VectorNegation
+        : public VectorExpression<T, N, VectorNegation<T, N, E> >
+    {
+        public:
+            inline VectorNegation(const E& inExpression) : mE(inExpression)
+            {
+            }
+
+            inline T operator[](size_t inIndex) const
+            {
+                return -mE[inIndex];
+            }
+
+        private:
+            const E& mE;
+    };
+
+    /// Expression nodes hold references to their operands, so an expression
+    /// must be consumed within the statement that builds it. Assign it to a
+    /// Vector (or pass it to one of the reductions below) to evaluate it.
+    template<typename T, size_t N, typename L, typename R>
+    inline const VectorSum<T, N, L, R> operator+(
+        const VectorExpression<T, N, L>& inL,
+        const VectorExpression<T, N, R>& inR)
+    {
+        return VectorSum<T, N, L, R>(inL.expression(), inR.expression());
+    }
+
+    template<typename T, size_t N, typename L, typename R>
+    inline const VectorDifference<T, N, L, R> operator-(
+        const VectorExpression<T, N, L>& inL,
+        const VectorExpression<T, N, R>& inR)
+    {
+        return VectorDifference<T, N, L, R>(inL.expression(),
+            inR.expression());
+    }
+
+    template<typename T, size_t N, typename E>
+    inline const VectorScale<T, N, E> operator*(
+        const VectorExpression<T, N, E>& inE, T inScale)
+    {
+        return VectorScale<T, N, E>(inE.expression(), inScale);
+    }
+
+    template<typename T, size_t N, typename E>
+    inline const VectorScale<T, N, E> operator*(T inScale,
+        const VectorExpression<T, N, E>& inE)
+    {
+        return VectorScale<T, N, E>(inE.expression(), inScale);
+    }
+
+    template<typename T, size_t N, typename E>
+    inline const VectorQuotient<T, N, E> operator/(
+        const VectorExpression<T, N, E>& inE, T inDivisor)
+    {
+        return VectorQuotient<T, N, E>(inE.expression(), inDivisor);
+    }
+
+    template<typename T, size_t N, typename E>
+    inline const VectorNegation<T, N, E> operator-(
+        const VectorExpression<T, N, E>& inE)
+    {
+        return VectorNegation<T, N, E>(inE.expression());
+    }
+
+    /// Reductions consume an expression directly, so something like
+    /// dotProduct(a - b, c) never materializes the difference.
+    template<typename T, size_t N, typename L, typename R>
+    T dotProduct(const VectorExpression<T, N, L>& inL,
+        const VectorExpression<T, N, R>& inR)
+    {
+        T outResult = inL[0] * inR[0];
+
+        for (size_t i = 1; i < N; ++i)
+            outResult += inL[i] * inR[i];
+
+        return outResult;
+    }
+
+    template<typename T, size_t N, typename E>
+    inline T lengthSquared(const VectorExpression<T, N, E>& inE)
+    {
+        return dotProduct(inE, inE);
+    }
+
+    template<typename T, size_t N, typename E>
+    inline T length(const VectorExpression<T, N, E>& inE)
+    {
+        return sqrt(lengthSquared(inE));
+    }
+
     /// /// /// new vector object /// /// ///
 
     template<typename T, size_t N>
-    class Vector
+    class Vector : public VectorExpression<T, N, Vector<T, N> >
     {
         public:
             inline Vector() { memset(mData, 0, sizeof(T) * N); }
@@ -101,19 +295,82 @@ namespace CGE
                 memcpy(mData, inVector, sizeof(T) * N);
             }
 
+            /// Constructing from an expression is where the fused loop
+            /// actually runs.
+            template<typename E>
+            inline Vector(const VectorExpression<T, N, E>& inExpression)
+            {
+                assign(inExpression.expression());
+            }
+
             inline ~Vector() {}
 
             inline operator T*() { return mData; }
             inline operator const T*() const { return mData; }
 
+            inline T& operator[](size_t inIndex) { return mData[inIndex]; }
+            inline T operator[](size_t inIndex) const
+            {
+                return mData[inIndex];
+            }
+
             inline T* getData() { return mData; }
 
+            inline Vector& operator=(const Vector& inVector)
+            {
+                memcpy(mData, inVector.mData, sizeof(T) * N);
+                return *this;
+            }
+
             inline Vector& operator=(const T* inVector)
             {
                 memcpy(mData, inVector, sizeof(T) * N);
                 return *this;
             }
 
+            /// Every element of an expression depends only on the same element
+            /// of its operands, so it is safe for the destination to appear in
+            /// the expression (v = v * 2.0f + w).
+            template<typename E>
+            inline Vector& operator=(
+                const VectorExpression<T, N, E>& inExpression)
+            {
+                assign(inExpression.expression());
+                return *this;
+            }
+
+            template<typename E>
+            inline Vector& operator+=(
+                const VectorExpression<T, N, E>& inExpression)
+            {
+                const E& e = inExpression.expression();
+
+                for (size_t i = 0; i < N; ++i)
+                    mData[i] += e[i];
+
+                return *this;
+            }
+
+            template<typename E>
+            inline Vector& operator-=(
+                const VectorExpression<T, N, E>& inExpression)
+            {
+                const E& e = inExpression.expression();
+
+                for (size_t i = 0; i < N; ++i)
+                    mData[i] -= e[i];
+
+                return *this;
+            }
+
+            inline Vector& operator*=(T inScale)
+            {
+                for (size_t i = 0; i < N; ++i)
+                    mData[i] *= inScale;
+
+                return *this;
+            }
+
             Vector& operator+=(const T* inVector)
             {
                 Vector v(*this);
@@ -122,6 +379,13 @@ namespace CGE
             }
 
         private:
+            template<typename E>
+            inline void assign(const E& inExpression)
+            {
+                for (size_t i = 0; i < N; ++i)
+                    mData[i] = inExpression[i];
+            }
+
             T mData[N];
     };
 }
@@ -0,0 +1,380 @@
+#include "AllocationTracker.hpp"
+#include <QAtomicInt>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(DEJARIX_TRACK_ALLOCATIONS) && defined(__GLIBC__)
+#include <execinfo.h>
+#define DEJARIX_SAMPLE_STACKS
+#endif
+
+#ifdef _MSC_VER
+#define DEJARIX_THREAD_LOCAL __declspec(thread)
+#else
+#define DEJARIX_THREAD_LOCAL __thread
+#endif
+
+// Everything here lives in zero-initialized static storage, since the first
+// allocations happen long before any constructor runs.
+
+static const int FrameDepth = 8;
+static const int SkippedFrames = 3;
+static const int SiteCapacity = 256;
+static const int SampleInterval = 16;
+
+struct Site
+{
+    unsigned int hash;
+    int count;
+    int bytes;
+    int depth;
+    void* frames[FrameDepth];
+};
+
+class SiteCountGreater
+{
+public:
+    explicit SiteCountGreater(const Site* sites) : _sites(sites)
+    {
+    }
+
+    inline bool operator()(int a, int b) const
+    {
+        return _sites[a].count > _sites[b].count;
+    }
+
+private:
+    const Site* _sites;
+};
+
+static QBasicAtomicInt allocations[AllocationTracker::MaxScopes];
+static QBasicAtomicInt bytes[AllocationTracker::MaxScopes];
+static QBasicAtomicInt paused;
+static QBasicAtomicInt siteLock;
+
+static const char* scopeNames[AllocationTracker::MaxScopes];
+static int scopeTotal;
+static AllocationTracker::Statistics lastTotal;
+static AllocationTracker::Statistics lastScopes[AllocationTracker::MaxScopes];
+static Site sites[SiteCapacity];
+
+static DEJARIX_THREAD_LOCAL int currentScope;
+static DEJARIX_THREAD_LOCAL int isFrameThread;
+
+#ifdef DEJARIX_SAMPLE_STACKS
+static QBasicAtomicInt samples;
+
+// backtrace() allocates the first time it runs, which lands right back here.
+static DEJARIX_THREAD_LOCAL int sampling;
+
+static void sample(size_t size)
+{
+    if (sampling) return;
+
+    ++sampling;
+
+    void* frames[FrameDepth + SkippedFrames];
+    int depth = backtrace(frames, FrameDepth + SkippedFrames) - SkippedFrames;
+
+    if (depth > 0)
+    {
+        unsigned int hash = 2166136261u;
+
+        for (int i = 0; i < depth; ++i)
+        {
+            hash ^= unsigned(reinterpret_cast<size_t>(frames[i
+                + SkippedFrames]));
+            hash *= 16777619u;
+        }
+
+        while (!siteLock.testAndSetAcquire(0, 1))
+        {
+        }
+
+        for (int i = 0; i < SiteCapacity; ++i)
+        {
+            Site& site = sites[(hash + unsigned(i)) % SiteCapacity];
+
+            if (site.count == 0)
+            {
+                site.hash = hash;
+                site.depth = depth;
+                memcpy(site.frames, frames + SkippedFrames,
+                    depth * sizeof(void*));
+            }
+            else if (site.hash != hash || site.depth != depth
+                || memcmp(site.frames, frames + SkippedFrames,
+                    depth * sizeof(void*)))
+            {
+                continue;
+            }
+
+            ++site.count;
+            site.bytes += int(size);
+            break;
+        }
+
+        siteLock.storeRelease(0);
+    }
+
+    --sampling;
+}
+#endif
+
+bool AllocationTracker::isEnabled()
+{
+#ifdef DEJARIX_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocationTracker::beginFrame()
+{
+    isFrameThread = 1;
+
+    for (int i = 0; i < MaxScopes; ++i)
+    {
+        allocations[i].storeRelease(0);
+        bytes[i].storeRelease(0);
+    }
+}
+
+void AllocationTracker::endFrame()
+{
+    lastTotal.allocations = 0;
+    lastTotal.bytes = 0;
+
+    for (int i = 0; i < MaxScopes; ++i)
+    {
+        lastScopes[i].allocations = allocations[i].loadAcquire();
+        lastScopes[i].bytes = bytes[i].loadAcquire();
+        lastTotal.allocations += lastScopes[i].allocations;
+        lastTotal.bytes += lastScopes[i].bytes;
+    }
+}
+
+void AllocationTracker::pause()
+{
+    paused.fetchAndAddOrdered(1);
+}
+
+void AllocationTracker::resume()
+{
+    paused.fetchAndAddOrdered(-1);
+}
+
+const AllocationTracker::Statistics& AllocationTracker::lastFrame()
+{
+    return lastTotal;
+}
+
+int AllocationTracker::scopeCount()
+{
+    return scopeTotal ? scopeTotal : 1;
+}
+
+const char* AllocationTracker::scopeName(int scope)
+{
+    return scope > 0 && scope < scopeTotal ? scopeNames[scope] : "other";
+}
+
+const AllocationTracker::Statistics& AllocationTracker::lastFrame(int scope)
+{
+    return lastScopes[scope >= 0 && scope < MaxScopes ? scope : 0];
+}
+
+QString AllocationTracker::report(int siteCount)
+{
+    pause();
+
+    int order[SiteCapacity];
+    int used = 0;
+
+    while (!siteLock.testAndSetAcquire(0, 1))
+    {
+    }
+
+    Site copies[SiteCapacity];
+    memcpy(copies, sites, sizeof(sites));
+    memset(sites, 0, sizeof(sites));
+    siteLock.storeRelease(0);
+
+    for (int i = 0; i < SiteCapacity; ++i)
+        if (copies[i].count > 0) order[used++] = i;
+
+    siteCount = qMin(siteCount, used);
+    std::partial_sort(order, order + siteCount, order + used,
+        SiteCountGreater(copies));
+
+    QString result;
+
+#ifdef DEJARIX_SAMPLE_STACKS
+    for (int i = 0; i < siteCount; ++i)
+    {
+        const Site& site = copies[order[i]];
+        char** symbols = backtrace_symbols(site.frames, site.depth);
+
+        result += QString("%1 sampled allocations, %2 bytes\n")
+            .arg(site.count).arg(site.bytes);
+
+        for (int j = 0; symbols && j < site.depth; ++j)
+            result += QString("    %1\n").arg(symbols[j]);
+
+        free(symbols);
+    }
+#else
+    Q_UNUSED(siteCount);
+    result = "Stack sampling is not available in this build.\n";
+#endif
+
+    resume();
+    return result;
+}
+
+// Scope names are expected to be string literals, so they are compared by
+// address first.
+int AllocationTracker::enterScope(const char* name)
+{
+    int previous = currentScope;
+
+    if (scopeTotal == 0)
+    {
+        scopeNames[0] = "other";
+        scopeTotal = 1;
+    }
+
+    int scope = 0;
+
+    for (int i = 1; i < scopeTotal && !scope; ++i)
+        if (scopeNames[i] == name || !strcmp(scopeNames[i], name)) scope = i;
+
+    if (!scope && scopeTotal < MaxScopes)
+    {
+        scope = scopeTotal++;
+        scopeNames[scope] = name;
+    }
+
+    currentScope = scope;
+    return previous;
+}
+
+void AllocationTracker::leaveScope(int previous)
+{
+    currentScope = previous;
+}
+
+int AllocationTracker::chargedScope()
+{
+    return isFrameThread ? currentScope : -1;
+}
+
+int AllocationTracker::chargeTo(int scope)
+{
+    int previous = chargedScope();
+    isFrameThread = scope >= 0;
+    currentScope = scope >= 0 ? scope : 0;
+    return previous;
+}
+
+void AllocationTracker::record(size_t size)
+{
+    if (!isFrameThread || paused.loadAcquire() > 0) return;
+
+    int scope = currentScope;
+    allocations[scope].fetchAndAddRelaxed(1);
+    bytes[scope].fetchAndAddRelaxed(int(size));
+
+#ifdef DEJARIX_SAMPLE_STACKS
+    if (samples.fetchAndAddRelaxed(1) % SampleInterval == 0) sample(size);
+#endif
+}
+
+#ifdef DEJARIX_TRACK_ALLOCATIONS
+// Qt containers, QString and QImage allocate with malloc rather than new, so
+// on glibc the C allocator is wrapped too and new simply goes through it.
+#ifdef __GLIBC__
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+
+    void* malloc(size_t size)
+    {
+        AllocationTracker::record(size);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        AllocationTracker::record(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size)
+    {
+        AllocationTracker::record(size);
+        return __libc_realloc(pointer, size);
+    }
+}
+
+static inline void* allocate(size_t size)
+{
+    return malloc(size ? size : 1);
+}
+#else
+static inline void* allocate(size_t size)
+{
+    AllocationTracker::record(size);
+    return malloc(size ? size : 1);
+}
+#endif
+
+void* operator new(size_t size)
+{
+    void* result = allocate(size);
+    if (!result) throw std::bad_alloc();
+    return result;
+}
+
+void* operator new[](size_t size)
+{
+    void* result = allocate(size);
+    if (!result) throw std::bad_alloc();
+    return result;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) Q_DECL_NOTHROW
+{
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) Q_DECL_NOTHROW
+{
+    return allocate(size);
+}
+
+void operator delete(void* pointer) Q_DECL_NOTHROW
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer) Q_DECL_NOTHROW
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) Q_DECL_NOTHROW
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) Q_DECL_NOTHROW
+{
+    free(pointer);
+}
+#endif
@@ -0,0 +1,76 @@
+#ifndef ALLOCATIONTRACKER_HPP
+#define ALLOCATIONTRACKER_HPP
+
+#include <QString>
+#include <cstddef>
+
+// Counts heap allocations per frame and per named scope, and samples the call
+// stacks of allocating sites. Tracking only happens when the project is built
+// with CONFIG += allocation_tracking, which replaces the global operator new
+// and operator delete; otherwise every call here does nothing.
+//
+// Allocations are counted on the thread that begins frames, and on any thread
+// working for it: a job worker takes on the scope of whoever added its job
+// for as long as it runs it, so work the frame waits for is charged to the
+// scope doing the waiting. Each thread keeps its own scope, and threads that
+// do not hold up the frame (streaming, networking) are left out.
+class AllocationTracker
+{
+public:
+    struct Statistics
+    {
+        int allocations;
+        int bytes;
+    };
+
+    static const int MaxScopes = 16;
+
+    static bool isEnabled();
+
+    static void beginFrame();
+    static void endFrame();
+
+    // Allocations made while paused (drawing the overlay, say) are ignored.
+    static void pause();
+    static void resume();
+
+    static const Statistics& lastFrame();
+    static int scopeCount();
+    static const char* scopeName(int scope);
+    static const Statistics& lastFrame(int scope);
+
+    // Describes the sampled sites that allocated the most, most first.
+    static QString report(int siteCount = 5);
+
+    static int enterScope(const char* name);
+    static void leaveScope(int previous);
+
+    // The scope the calling thread's allocations are charged to, or -1 if
+    // they are not counted at all.
+    static int chargedScope();
+
+    // Charges the calling thread's allocations as chargedScope() describes,
+    // returning what it was charged to before.
+    static int chargeTo(int scope);
+
+    static void record(size_t bytes);
+};
+
+class AllocationScope
+{
+public:
+    explicit AllocationScope(const char* name)
+        : _previous(AllocationTracker::enterScope(name))
+    {
+    }
+
+    ~AllocationScope()
+    {
+        AllocationTracker::leaveScope(_previous);
+    }
+
+private:
+    int _previous;
+};
+
+#endif
@@ -1,6 +1,6 @@
 #include "Animation.hpp"
 
-Animation::Animation()
+Animation::Animation() : _nextAnimation(0)
 {
 }
 
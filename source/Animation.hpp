@@ -7,7 +7,12 @@ public:
     Animation();
     virtual ~Animation();
 
-    virtual bool update() = 0;
+    // Advances the animation to the given time (in seconds). Returns false
+    // once there is nothing left to animate.
+    virtual bool update(float time) = 0;
+
+    inline Animation* nextAnimation() const { return _nextAnimation; }
+    inline void nextAnimation(Animation* a) { _nextAnimation = a; }
 
 private:
     Animation* _nextAnimation;
@@ -0,0 +1,266 @@
+#include "BlockCompressor.hpp"
+#include <QtGlobal>
+
+static inline int blockCount(int size)
+{
+    return size > 0 ? (size + 3) / 4 : 1;
+}
+
+static inline unsigned int pack565(int r, int g, int b)
+{
+    return ((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5
+        | ((b * 31 + 127) / 255);
+}
+
+static inline void unpack565(unsigned int color, int* rgb)
+{
+    int r = (color >> 11) & 31;
+    int g = (color >> 5) & 63;
+    int b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+int BlockCompressor::bc1Size(int width, int height)
+{
+    return blockCount(width) * blockCount(height) * 8;
+}
+
+int BlockCompressor::bc3Size(int width, int height)
+{
+    return blockCount(width) * blockCount(height) * 16;
+}
+
+void BlockCompressor::compressBc1(const unsigned char* pixels, int width,
+    int height, unsigned char* blocks)
+{
+    unsigned char block[64];
+
+    for (int y = 0; y < height; y += 4)
+    {
+        for (int x = 0; x < width; x += 4)
+        {
+            fetchBlock(pixels, width, height, x, y, block);
+            encodeColor(block, blocks);
+            blocks += 8;
+        }
+    }
+}
+
+void BlockCompressor::compressBc3(const unsigned char* pixels, int width,
+    int height, unsigned char* blocks)
+{
+    unsigned char block[64];
+
+    for (int y = 0; y < height; y += 4)
+    {
+        for (int x = 0; x < width; x += 4)
+        {
+            fetchBlock(pixels, width, height, x, y, block);
+            encodeAlpha(block, blocks);
+            encodeColor(block, blocks + 8);
+            blocks += 16;
+        }
+    }
+}
+
+// Blocks hanging off the edge of a small mip level repeat the last row and
+// column, which keeps the endpoints honest.
+void BlockCompressor::fetchBlock(const unsigned char* pixels, int width,
+    int height, int x, int y, unsigned char* block)
+{
+    for (int j = 0; j < 4; ++j)
+    {
+        int row = y + j < height ? y + j : height - 1;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            int column = x + i < width ? x + i : width - 1;
+            const unsigned char* pixel = pixels + (row * width + column) * 4;
+            unsigned char* target = block + (j * 4 + i) * 4;
+
+            target[0] = pixel[0];
+            target[1] = pixel[1];
+            target[2] = pixel[2];
+            target[3] = pixel[3];
+        }
+    }
+}
+
+void BlockCompressor::encodeColor(const unsigned char* block,
+    unsigned char* out)
+{
+    int low[3] = { 255, 255, 255 };
+    int high[3] = { 0, 0, 0 };
+
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            int value = block[i * 4 + k];
+
+            if (value < low[k]) low[k] = value;
+            if (value > high[k]) high[k] = value;
+        }
+    }
+
+    // Pulling the endpoints in by a sixteenth of the range trades the
+    // extremes (rarely hit exactly) for a better fit through the middle.
+    for (int k = 0; k < 3; ++k)
+    {
+        int inset = (high[k] - low[k]) >> 4;
+        low[k] += inset;
+        high[k] -= inset;
+    }
+
+    // The box has four diagonals. Channels that fall while the widest one
+    // rises run along another diagonal than low to high, so their ends swap.
+    int widest = 0;
+
+    for (int k = 1; k < 3; ++k)
+    {
+        if (high[k] - low[k] > high[widest] - low[widest]) widest = k;
+    }
+
+    int mean[3] = { 0, 0, 0 };
+
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+            mean[k] += block[i * 4 + k];
+    }
+
+    for (int k = 0; k < 3; ++k)
+    {
+        if (k == widest) continue;
+
+        int covariance = 0;
+
+        for (int i = 0; i < 16; ++i)
+        {
+            covariance += (block[i * 4 + k] * 16 - mean[k])
+                * (block[i * 4 + widest] * 16 - mean[widest]);
+        }
+
+        if (covariance < 0)
+        {
+            int swap = low[k];
+            low[k] = high[k];
+            high[k] = swap;
+        }
+    }
+
+    unsigned int color0 = pack565(high[0], high[1], high[2]);
+    unsigned int color1 = pack565(low[0], low[1], low[2]);
+    unsigned int indices = 0;
+
+    // Only color0 > color1 selects the four color mode, so a flat block
+    // keeps index 0 everywhere.
+    if (color0 < color1)
+    {
+        unsigned int swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        unpack565(color0, palette[0]);
+        unpack565(color1, palette[1]);
+
+        for (int k = 0; k < 3; ++k)
+        {
+            palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+            palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            const unsigned char* pixel = block + i * 4;
+            int best = 0;
+            int bestDistance = 0x7fffffff;
+
+            for (int j = 0; j < 4; ++j)
+            {
+                int r = pixel[0] - palette[j][0];
+                int g = pixel[1] - palette[j][1];
+                int b = pixel[2] - palette[j][2];
+                int distance = r * r + g * g + b * b;
+
+                if (distance < bestDistance)
+                {
+                    best = j;
+                    bestDistance = distance;
+                }
+            }
+
+            indices |= unsigned(best) << (i * 2);
+        }
+    }
+
+    out[0] = color0 & 0xff;
+    out[1] = color0 >> 8;
+    out[2] = color1 & 0xff;
+    out[3] = color1 >> 8;
+    out[4] = indices & 0xff;
+    out[5] = (indices >> 8) & 0xff;
+    out[6] = (indices >> 16) & 0xff;
+    out[7] = indices >> 24;
+}
+
+// Uses the eight alpha mode (alpha0 > alpha1) unless the block is flat.
+void BlockCompressor::encodeAlpha(const unsigned char* block,
+    unsigned char* out)
+{
+    int low = 255;
+    int high = 0;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        int alpha = block[i * 4 + 3];
+
+        if (alpha < low) low = alpha;
+        if (alpha > high) high = alpha;
+    }
+
+    out[0] = high;
+    out[1] = low;
+
+    quint64 indices = 0;
+
+    if (high > low)
+    {
+        int palette[8];
+        palette[0] = high;
+        palette[1] = low;
+
+        for (int j = 1; j < 7; ++j)
+            palette[j + 1] = ((7 - j) * high + j * low) / 7;
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int alpha = block[i * 4 + 3];
+            int best = 0;
+            int bestDistance = 256;
+
+            for (int j = 0; j < 8; ++j)
+            {
+                int distance = alpha > palette[j] ? alpha - palette[j]
+                    : palette[j] - alpha;
+
+                if (distance < bestDistance)
+                {
+                    best = j;
+                    bestDistance = distance;
+                }
+            }
+
+            indices |= quint64(best) << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; ++i)
+        out[i + 2] = (indices >> (i * 8)) & 0xff;
+}
@@ -0,0 +1,30 @@
+#ifndef BLOCKCOMPRESSOR_HPP
+#define BLOCKCOMPRESSOR_HPP
+
+// Encodes RGBA8 pixels as S3TC blocks (BC1 for opaque images, BC3 when
+// there is alpha). Endpoints come from the bounding box of each block's
+// colors, pulled in slightly, and every pixel takes the nearest of the
+// resulting palette entries. That is a long way from the best an offline
+// encoder can do, but it is fast enough to run while the game loads and is
+// good enough for card art viewed at table distance.
+class BlockCompressor
+{
+public:
+    // Sizes are in bytes for a whole image. Images smaller than a block
+    // still take one block.
+    static int bc1Size(int width, int height);
+    static int bc3Size(int width, int height);
+
+    static void compressBc1(const unsigned char* pixels, int width,
+        int height, unsigned char* blocks);
+    static void compressBc3(const unsigned char* pixels, int width,
+        int height, unsigned char* blocks);
+
+private:
+    static void fetchBlock(const unsigned char* pixels, int width,
+        int height, int x, int y, unsigned char* block);
+    static void encodeColor(const unsigned char* block, unsigned char* out);
+    static void encodeAlpha(const unsigned char* block, unsigned char* out);
+};
+
+#endif
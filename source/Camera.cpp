@@ -1,7 +1,7 @@
 #include "Camera.hpp"
 #include <cmath>
 
-Camera::Camera() : _distance(0.0f)
+Camera::Camera() : _distance(0.0f), _previousDistance(0.0f)
 {
 }
 
@@ -9,13 +9,30 @@ Camera::~Camera()
 {
 }
 
-void Camera::update()
+void Camera::snapshot()
 {
+    _previousPosition = _position;
+    _previousDistance = _distance;
+    _previousRotation = _rotation;
+    _previousAngle = _angle;
+}
+
+void Camera::update(float alpha)
+{
+    QVector3D position = _previousPosition
+        + (_position - _previousPosition) * alpha;
+    float distance = _previousDistance
+        + (_distance - _previousDistance) * alpha;
+    Rotation rotation = _previousRotation + Rotation::fromRadians(
+        (_rotation - _previousRotation).toRadians() * alpha);
+    Rotation angle = _previousAngle + Rotation::fromRadians(
+        (_angle - _previousAngle).toRadians() * alpha);
+
     _matrix.setToIdentity();
-    _matrix.translate(0.0f, 0.0f, -_distance);
-    _matrix.rotate(_angle.toDegrees(), 1.0f, 0.0f, 0.0f);
-    _matrix.rotate(_rotation.toDegrees(), 0.0f, 0.0f, 1.0f);
-    _matrix.translate(-_position);
+    _matrix.translate(0.0f, 0.0f, -distance);
+    _matrix.rotate(angle.toDegrees(), 1.0f, 0.0f, 0.0f);
+    _matrix.rotate(rotation.toDegrees(), 0.0f, 0.0f, 1.0f);
+    _matrix.translate(-position);
 }
 
 void Camera::panRelative(float x, float y)
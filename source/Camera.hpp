@@ -11,7 +11,8 @@ public:
     Camera();
     ~Camera();
 
-    void update();
+    void snapshot();
+    void update(float alpha = 1.0f);
     inline const QMatrix4x4& matrix() const { return _matrix; }
 
     inline const QVector3D& position() const { return _position; }
@@ -36,6 +37,11 @@ private:
     float _distance;
     Rotation _rotation;
     Rotation _angle;
+
+    QVector3D _previousPosition;
+    float _previousDistance;
+    Rotation _previousRotation;
+    Rotation _previousAngle;
 };
 
 #endif
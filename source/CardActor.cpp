@@ -9,7 +9,9 @@ CardActor::CardActor(const CardActor &other)
     : _topTexture(other._topTexture), _bottomTexture(other._bottomTexture),
     _isTopVisible(other._isTopVisible), _highlight(other._highlight),
     _position(other._position), _rotation(other._rotation),
-    _flip(other._flip), _localMatrix(other._localMatrix),
+    _flip(other._flip), _previousPosition(other._previousPosition),
+    _previousRotation(other._previousRotation),
+    _previousFlip(other._previousFlip), _localMatrix(other._localMatrix),
     _modelViewMatrix(other._modelViewMatrix)
 {
 }
@@ -27,18 +29,35 @@ CardActor& CardActor::operator=(const CardActor& other)
     _position = other._position;
     _rotation = other._rotation;
     _flip = other._flip;
+    _previousPosition = other._previousPosition;
+    _previousRotation = other._previousRotation;
+    _previousFlip = other._previousFlip;
     _localMatrix = other._localMatrix;
     _modelViewMatrix = other._modelViewMatrix;
 
     return *this;
 }
 
-void CardActor::update(const QMatrix4x4& modelViewMatrix)
+void CardActor::snapshot()
 {
+    _previousPosition = _position;
+    _previousRotation = _rotation;
+    _previousFlip = _flip;
+}
+
+void CardActor::update(const QMatrix4x4& modelViewMatrix, float alpha)
+{
+    QVector3D position = _previousPosition
+        + (_position - _previousPosition) * alpha;
+    Rotation rotation = _previousRotation + Rotation::fromRadians(
+        (_rotation - _previousRotation).toRadians() * alpha);
+    Rotation flip = _previousFlip + Rotation::fromRadians(
+        (_flip - _previousFlip).toRadians() * alpha);
+
     _localMatrix.setToIdentity();
-    _localMatrix.translate(_position);
-    _localMatrix.rotate(_rotation.toDegrees(), 0.0f, 0.0f, 1.0f);
-    _localMatrix.rotate(_flip.toDegrees(), 0.0f, 1.0f, 0.0f);
+    _localMatrix.translate(position);
+    _localMatrix.rotate(rotation.toDegrees(), 0.0f, 0.0f, 1.0f);
+    _localMatrix.rotate(flip.toDegrees(), 0.0f, 1.0f, 0.0f);
 
     _modelViewMatrix = modelViewMatrix * _localMatrix;
 
@@ -15,7 +15,10 @@ public:
 
     CardActor& operator=(const CardActor& other);
 
-    void update(const QMatrix4x4& modelViewMatrix);
+    // Remembers the current state so the next simulation step can be
+    // blended with it when rendering.
+    void snapshot();
+    void update(const QMatrix4x4& modelViewMatrix, float alpha = 1.0f);
     inline const QMatrix4x4& modelViewMatrix() const
     {
         return _modelViewMatrix;
@@ -54,6 +57,10 @@ private:
     Rotation _rotation;
     Rotation _flip;
 
+    QVector3D _previousPosition;
+    Rotation _previousRotation;
+    Rotation _previousFlip;
+
     QMatrix4x4 _localMatrix;
     QMatrix4x4 _modelViewMatrix;
 };
@@ -0,0 +1,213 @@
+#include "CardCompositor.hpp"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QPainter>
+
+// Faces are laid out in tenths of a millimeter on a standard 63 x 88 mm card
+// and stretched to fill the square texture, which the card squeezes back.
+static const qreal CardWidth = 630.0;
+static const qreal CardHeight = 880.0;
+
+// How many decoded frames are kept around.
+static const int FrameCapacity = 16;
+
+CardCompositor::FaceSource::FaceSource(CardCompositor& compositor,
+    const CardFace& face, const QByteArray& key)
+    : _compositor(compositor), _face(face), _key(key)
+{
+}
+
+QByteArray CardCompositor::FaceSource::cacheKey() const
+{
+    return _key;
+}
+
+// Runs on a streamer thread, so rendering only touches what never changes
+// after construction, plus the frame cache under its lock.
+QImage CardCompositor::FaceSource::load() const
+{
+    return _compositor.render(_face);
+}
+
+CardCompositor::CardCompositor(TextureManager& textures, int textureSize,
+    const CardPack* pack)
+    : _textures(textures), _textureSize(textureSize), _pack(pack),
+      _frameUses(0)
+{
+}
+
+CardCompositor::~CardCompositor()
+{
+}
+
+QByteArray CardCompositor::key(const CardFace& face)
+{
+    return face.key(contentHash(face.frame), contentHash(face.art),
+        _textureSize);
+}
+
+TextureManager::Handle CardCompositor::face(const CardFace& face,
+    const QByteArray& key)
+{
+    return _textures.load(key, new FaceSource(*this, face, key));
+}
+
+QImage CardCompositor::render(const CardFace& face)
+{
+    QImage result(_textureSize, _textureSize, QImage::Format_ARGB32);
+    result.fill(Qt::black);
+
+    QPainter painter(&result);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    painter.scale(qreal(_textureSize) / CardWidth,
+        qreal(_textureSize) / CardHeight);
+
+    QRectF card(0.0, 0.0, CardWidth, CardHeight);
+    QRectF titleBox(40.0, 40.0, 550.0, 80.0);
+    QRectF artBox(40.0, 140.0, 550.0, 400.0);
+    QRectF textBox(40.0, 570.0, 550.0, 270.0);
+
+    QImage frameImage = frame(face.frame);
+
+    if (frameImage.isNull())
+    {
+        painter.fillRect(card, QColor(40, 40, 48));
+        painter.setPen(QPen(QColor(180, 160, 90), 16.0));
+        painter.drawRoundedRect(card.adjusted(8.0, 8.0, -8.0, -8.0), 30.0,
+            30.0);
+        painter.fillRect(titleBox, QColor(20, 20, 24));
+        painter.fillRect(textBox, QColor(230, 225, 210));
+    }
+    else
+    {
+        painter.drawImage(card, frameImage);
+    }
+
+    QImage art = decode(face.art);
+
+    if (!art.isNull())
+    {
+        QRectF crop(face.artCrop.x() * art.width(),
+            face.artCrop.y() * art.height(),
+            face.artCrop.width() * art.width(),
+            face.artCrop.height() * art.height());
+        painter.drawImage(artBox, art, crop);
+    }
+
+    QFont font;
+    font.setBold(true);
+    font.setPixelSize(45);
+    painter.setFont(font);
+    painter.setPen(Qt::white);
+    painter.drawText(titleBox.adjusted(15.0, 0.0, -15.0, 0.0),
+        Qt::AlignLeft | Qt::AlignVCenter, face.title);
+
+    font.setBold(false);
+    font.setPixelSize(32);
+    painter.setFont(font);
+    painter.setPen(Qt::black);
+    painter.drawText(textBox.adjusted(15.0, 15.0, -15.0, -15.0),
+        Qt::AlignLeft | Qt::AlignTop | Qt::TextWordWrap, face.text);
+
+    return result;
+}
+
+// Decoding happens outside the lock, so one slow frame does not hold up
+// every other thread; a placeholder entry marks it as under way, and threads
+// wanting the same frame meanwhile wait for it. QImage is implicitly shared,
+// so the copy handed back is cheap and safe to use outside the lock.
+QImage CardCompositor::frame(const QString& path)
+{
+    if (path.isEmpty()) return QImage();
+
+    QMutexLocker locker(&_frameMutex);
+    QHash<QString, Frame>::Iterator i;
+
+    while ((i = _frames.find(path)) != _frames.end() && i->isDecoding)
+        _frameDecoded.wait(&_frameMutex);
+
+    if (i != _frames.end())
+    {
+        i->lastUse = ++_frameUses;
+        return i->image;
+    }
+
+    // The least recently used frame makes room, unless it is still being
+    // decoded (in which case the cache runs over for a moment).
+    if (_frames.size() >= FrameCapacity)
+    {
+        QHash<QString, Frame>::Iterator oldest = _frames.end();
+
+        for (i = _frames.begin(); i != _frames.end(); ++i)
+        {
+            if (!i->isDecoding && (oldest == _frames.end()
+                || i->lastUse < oldest->lastUse))
+                oldest = i;
+        }
+
+        if (oldest != _frames.end()) _frames.erase(oldest);
+    }
+
+    _frames.insert(path, Frame());
+    locker.unlock();
+
+    QImage result = decode(path);
+
+    locker.relock();
+    Frame& decoded = _frames[path];
+    decoded.image = result;
+    decoded.isDecoding = false;
+    decoded.lastUse = ++_frameUses;
+    _frameDecoded.wakeAll();
+    return result;
+}
+
+QImage CardCompositor::decode(const QString& path) const
+{
+    if (path.isEmpty()) return QImage();
+
+    if (_pack)
+    {
+        QImage result =
+            _pack->image(QFileInfo(path).completeBaseName().toUtf8());
+
+        if (!result.isNull()) return result;
+    }
+
+    return QImage(path);
+}
+
+// Found the same way decode() finds the image. A missing image hashes to
+// nothing, just as it composes to nothing.
+QByteArray CardCompositor::contentHash(const QString& path)
+{
+    if (path.isEmpty()) return QByteArray();
+
+    QHash<QString, QByteArray>::ConstIterator i = _hashes.constFind(path);
+
+    if (i != _hashes.constEnd()) return i.value();
+
+    QByteArray result;
+    CardPack::Entry entry;
+
+    if (_pack
+        && _pack->find(QFileInfo(path).completeBaseName().toUtf8(), entry))
+    {
+        result = entry.hash;
+    }
+    else
+    {
+        QFile file(path);
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+
+        if (file.open(QIODevice::ReadOnly) && hash.addData(&file))
+            result = hash.result();
+    }
+
+    _hashes.insert(path, result);
+    return result;
+}
@@ -0,0 +1,80 @@
+#ifndef CARDCOMPOSITOR_HPP
+#define CARDCOMPOSITOR_HPP
+
+#include "CardFace.hpp"
+#include "CardPack.hpp"
+#include "TextureManager.hpp"
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QWaitCondition>
+
+// Composes card fronts from their parts (frame, art, title, rules text).
+// Each face becomes a texture manager entry keyed by the face, so it is only
+// composed once something draws it, on the streamer's threads, and it can be
+// evicted and brought back like any other texture. The face key doubles as
+// the disk cache key, so a face is painted only once, ever. Frames and art
+// named by path are looked for in the card pack (if given) first, by file
+// name without its directory or extension.
+//
+// Frames are shared by many faces, so the most recently used few are kept
+// decoded; art is nearly always one card's own, so it is decoded afresh.
+class CardCompositor
+{
+public:
+    CardCompositor(TextureManager& textures, int textureSize = 512,
+        const CardPack* pack = 0);
+    ~CardCompositor();
+
+    // The key is taken separately so callers can reuse a key they already
+    // have. It covers the contents of the frame and art images rather than
+    // their paths, and the texture size; the hashes of loose files are
+    // worked out once per path and remembered. Unlike rendering, this is
+    // only for the thread that asks for faces.
+    QByteArray key(const CardFace& face);
+    TextureManager::Handle face(const CardFace& face, const QByteArray& key);
+
+private:
+    class FaceSource : public TextureManager::Source
+    {
+    public:
+        FaceSource(CardCompositor& compositor, const CardFace& face,
+            const QByteArray& key);
+
+        virtual QByteArray cacheKey() const;
+        virtual QImage load() const;
+
+    private:
+        CardCompositor& _compositor;
+        CardFace _face;
+        QByteArray _key;
+    };
+
+    class Frame
+    {
+    public:
+        Frame() : isDecoding(true), lastUse(0)
+        {
+        }
+
+        QImage image;
+        bool isDecoding;
+        quint64 lastUse;
+    };
+
+    QImage render(const CardFace& face);
+    QImage frame(const QString& path);
+    QImage decode(const QString& path) const;
+    QByteArray contentHash(const QString& path);
+
+    TextureManager& _textures;
+    int _textureSize;
+    const CardPack* _pack;
+    QMutex _frameMutex;
+    QWaitCondition _frameDecoded;
+    QHash<QString, Frame> _frames;
+    quint64 _frameUses;
+    QHash<QString, QByteArray> _hashes;
+};
+
+#endif
@@ -0,0 +1,722 @@
+#include "CardDatabase.hpp"
+#include "PostingList.hpp"
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QSaveFile>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const char Magic[8] = { 'D', 'J', 'X', 'C', 'A', 'R', 'D', '2' };
+static const quint32 Endianness = 0x04030201;
+static const int BlockSize = 16;
+
+// How much a word counts for in each field it appears in.
+static const quint32 FieldWeights[CardDatabase::FieldCount] =
+{
+    0, 4, 0, 0, 0, 0, 1, 1
+};
+
+// BM25's term frequency saturation.
+static const float K1 = 1.2f;
+
+class CardDatabase::Header
+{
+public:
+    char magic[8];
+    quint32 endianness;
+    quint32 count;
+    quint32 fieldCount;
+    quint32 blockSize;
+    quint32 stringsOffset;
+    quint32 stringsSize;
+    quint32 nameBlocksOffset;
+    quint32 nameBlockCount;
+    quint32 namesOffset;
+    quint32 namesSize;
+    quint32 termBlocksOffset;
+    quint32 termBlockCount;
+    quint32 termsOffset;
+    quint32 termsSize;
+    quint32 postingsOffset;
+    quint32 postingsSize;
+    quint32 reserved;
+};
+
+// A card's fields sit one after another in the string pool, so each one
+// ends where the next starts.
+class CardDatabase::Record
+{
+public:
+    quint32 starts[FieldCount + 1];
+};
+
+// Reads a front coded table forward from the block that may hold the first
+// entry not less than the key. Every block starts with a whole entry, so
+// reading can start at any block and carry on into the next ones.
+class CardDatabase::Cursor
+{
+public:
+    Cursor(const Table& table, const QByteArray& key);
+
+    bool next(int valueCount);
+    int match(const QByteArray& key, bool isPrefix) const;
+
+    QByteArray entry;
+    quint32 values[2];
+
+private:
+    const uchar* _data;
+    const uchar* _end;
+};
+
+// The cards matching one word of a query (or any of several), and what
+// each one scores for it.
+class CardDatabase::Clause
+{
+public:
+    QVector<quint32> cards;
+    QVector<float> scores;
+};
+
+static const char* const FieldNames[CardDatabase::FieldCount] =
+{
+    "id", "name", "set", "type", "side", "rarity", "lore", "text"
+};
+
+static inline quint32 aligned(quint32 offset)
+{
+    return (offset + 3) & ~3u;
+}
+
+static int compare(const char* a, int aSize, const char* b, int bSize)
+{
+    int result = memcmp(a, b, qMin(aSize, bSize));
+    return result ? result : aSize - bSize;
+}
+
+static inline QByteArray fold(const QString& name)
+{
+    return name.toCaseFolded().toUtf8();
+}
+
+// Words are runs of letters and digits, case folded.
+static QVector<QByteArray> words(const QString& text)
+{
+    QVector<QByteArray> result;
+    QString folded = text.toCaseFolded();
+    int start = -1;
+
+    for (int i = 0; i <= folded.size(); ++i)
+    {
+        bool isWord = i < folded.size() && folded[i].isLetterOrNumber();
+
+        if (isWord && start < 0)
+        {
+            start = i;
+        }
+        else if (!isWord && start >= 0)
+        {
+            result.append(folded.mid(start, i - start).toUtf8());
+            start = -1;
+        }
+    }
+
+    return result;
+}
+
+static inline bool isLess(const CardDatabase::Match& a,
+    const CardDatabase::Match& b)
+{
+    return a.score > b.score || (a.score == b.score && a.card < b.card);
+}
+
+static void appendEntry(QByteArray& table, QVector<quint32>& blocks,
+    int index, const QByteArray& entry, const QByteArray& previous)
+{
+    int shared = 0;
+
+    if (index % BlockSize == 0)
+    {
+        blocks.append(table.size());
+    }
+    else
+    {
+        int most = qMin(entry.size(), previous.size());
+
+        while (shared < most && entry[shared] == previous[shared])
+            ++shared;
+    }
+
+    PostingList::appendVarint(table, shared);
+    PostingList::appendVarint(table, entry.size() - shared);
+    table.append(entry.constData() + shared, entry.size() - shared);
+}
+
+static bool isValidTable(const uchar* data, qint64 size,
+    quint32 blocksOffset, quint32 blockCount, quint32 offset,
+    quint32 tableSize)
+{
+    if (blocksOffset % 4 || qint64(blocksOffset) + qint64(blockCount) * 4
+        > size || qint64(offset) + tableSize > size)
+        return false;
+
+    const quint32* blocks =
+        reinterpret_cast<const quint32*>(data + blocksOffset);
+
+    for (quint32 i = 0; i < blockCount; ++i)
+    {
+        if (blocks[i] >= tableSize || (i > 0 && blocks[i - 1] >= blocks[i]))
+            return false;
+    }
+
+    return true;
+}
+
+CardDatabase::Cursor::Cursor(const Table& table, const QByteArray& key)
+    : _data(table.end), _end(table.end)
+{
+    int low = 0;
+    int high = table.blockCount;
+
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        const uchar* p = table.data + table.blocks[middle];
+        quint32 shared;
+        quint32 size;
+        int order = 1;
+
+        if (PostingList::readVarint(p, _end, shared)
+            && PostingList::readVarint(p, _end, size)
+            && size <= quint32(_end - p))
+        {
+            order = compare(reinterpret_cast<const char*>(p), size,
+                key.constData(), key.size());
+        }
+
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    // The first match may be near the end of the block before.
+    if (low > 0) --low;
+
+    if (low < table.blockCount) _data = table.data + table.blocks[low];
+}
+
+bool CardDatabase::Cursor::next(int valueCount)
+{
+    quint32 shared;
+    quint32 size;
+
+    if (!PostingList::readVarint(_data, _end, shared)
+        || shared > quint32(entry.size())
+        || !PostingList::readVarint(_data, _end, size)
+        || size > quint32(_end - _data))
+    {
+        _data = _end;
+        return false;
+    }
+
+    entry.truncate(shared);
+    entry.append(reinterpret_cast<const char*>(_data), size);
+    _data += size;
+
+    for (int i = 0; i < valueCount; ++i)
+    {
+        if (!PostingList::readVarint(_data, _end, values[i]))
+        {
+            _data = _end;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Zero for a match, less for an entry before the matches and more for one
+// after them.
+int CardDatabase::Cursor::match(const QByteArray& key, bool isPrefix) const
+{
+    if (isPrefix ? entry.startsWith(key) : entry == key) return 0;
+
+    return compare(entry.constData(), entry.size(), key.constData(),
+        key.size());
+}
+
+CardDatabase::CardDatabase()
+    : _data(0), _count(0), _strings(0), _postings(0), _postingsEnd(0)
+{
+    memset(&_names, 0, sizeof(_names));
+    memset(&_terms, 0, sizeof(_terms));
+}
+
+CardDatabase::~CardDatabase()
+{
+}
+
+// Only the records and block offsets are checked here; the tables and
+// postings are checked as they are read.
+bool CardDatabase::open(const QString& path)
+{
+    close();
+    _file.setFileName(path);
+
+    if (!_file.open(QIODevice::ReadOnly)) return false;
+
+    qint64 size = _file.size();
+    const uchar* data = size >= qint64(sizeof(Header))
+        ? _file.map(0, size) : 0;
+
+    if (!data)
+    {
+        _file.close();
+        return false;
+    }
+
+    Header h;
+    memcpy(&h, data, sizeof(h));
+
+    bool isValid = memcmp(h.magic, Magic, 8) == 0
+        && h.endianness == Endianness && h.fieldCount == FieldCount
+        && h.blockSize == BlockSize
+        && qint64(h.stringsOffset) == qint64(sizeof(Header))
+            + qint64(h.count) * qint64(sizeof(Record))
+        && qint64(h.stringsOffset) + h.stringsSize <= size
+        && qint64(h.postingsOffset) + h.postingsSize <= size
+        && isValidTable(data, size, h.nameBlocksOffset, h.nameBlockCount,
+            h.namesOffset, h.namesSize)
+        && isValidTable(data, size, h.termBlocksOffset, h.termBlockCount,
+            h.termsOffset, h.termsSize);
+
+    const Record* records =
+        reinterpret_cast<const Record*>(data + sizeof(Header));
+
+    for (quint32 i = 0; isValid && i < h.count; ++i)
+    {
+        const Record& r = records[i];
+
+        for (int j = 0; isValid && j < FieldCount; ++j)
+            isValid = r.starts[j] <= r.starts[j + 1];
+
+        isValid = isValid && r.starts[FieldCount] <= h.stringsSize;
+    }
+
+    if (!isValid)
+    {
+        _file.close();
+        return false;
+    }
+
+    _data = data;
+    _count = h.count;
+    _strings = reinterpret_cast<const char*>(data + h.stringsOffset);
+
+    _names.blocks = reinterpret_cast<const quint32*>(data + h.nameBlocksOffset);
+    _names.blockCount = h.nameBlockCount;
+    _names.data = data + h.namesOffset;
+    _names.end = _names.data + h.namesSize;
+
+    _terms.blocks = reinterpret_cast<const quint32*>(data + h.termBlocksOffset);
+    _terms.blockCount = h.termBlockCount;
+    _terms.data = data + h.termsOffset;
+    _terms.end = _terms.data + h.termsSize;
+
+    _postings = data + h.postingsOffset;
+    _postingsEnd = _postings + h.postingsSize;
+    return true;
+}
+
+void CardDatabase::close()
+{
+    _file.close();
+    _data = 0;
+    _count = 0;
+    _strings = 0;
+    memset(&_names, 0, sizeof(_names));
+    memset(&_terms, 0, sizeof(_terms));
+    _postings = 0;
+    _postingsEnd = 0;
+}
+
+inline const CardDatabase::Record& CardDatabase::record(int index) const
+{
+    return reinterpret_cast<const Record*>(_data + sizeof(Header))[index];
+}
+
+QString CardDatabase::text(int card, Field field) const
+{
+    const Record& r = record(card);
+    return QString::fromUtf8(_strings + r.starts[field],
+        r.starts[field + 1] - r.starts[field]);
+}
+
+QByteArray CardDatabase::utf8(int card, Field field) const
+{
+    const Record& r = record(card);
+    return QByteArray(_strings + r.starts[field],
+        r.starts[field + 1] - r.starts[field]);
+}
+
+int CardDatabase::find(const QByteArray& id) const
+{
+    int low = 0;
+    int high = _count;
+
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        const Record& r = record(middle);
+        int order = compare(_strings + r.starts[Id],
+            r.starts[Id + 1] - r.starts[Id], id.constData(), id.size());
+
+        if (order == 0) return middle;
+
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return -1;
+}
+
+QVector<int> CardDatabase::findByName(const QString& name) const
+{
+    return scan(fold(name), false, 0);
+}
+
+QVector<int> CardDatabase::findByPrefix(const QString& prefix,
+    int limit) const
+{
+    return scan(fold(prefix), true, limit);
+}
+
+// The shortest lists are intersected first, so the running result only
+// ever shrinks, and scoring walks what is left of it against each list.
+QVector<CardDatabase::Match> CardDatabase::search(const QString& query,
+    int limit) const
+{
+    QVector<Match> result;
+    QVector<Clause> clauses;
+    QStringList items = query.simplified().split(' ');
+    bool isAlternative = false;
+
+    for (int i = 0; i < items.size(); ++i)
+    {
+        if (items[i] == "OR" && !clauses.isEmpty())
+        {
+            isAlternative = true;
+            continue;
+        }
+
+        bool isPrefix = items[i].endsWith('*');
+        QVector<QByteArray> terms = words(items[i]);
+
+        for (int j = 0; j < terms.size(); ++j)
+        {
+            Clause clause;
+            addTerm(terms[j], isPrefix && j == terms.size() - 1, clause);
+
+            if (isAlternative)
+            {
+                Clause& last = clauses.last();
+                Clause both;
+                PostingList::unite(last.cards, last.scores, clause.cards,
+                    clause.scores, both.cards, both.scores);
+                last = both;
+            }
+            else
+            {
+                clauses.append(clause);
+            }
+        }
+
+        isAlternative = false;
+    }
+
+    if (clauses.isEmpty()) return result;
+
+    QVector<QPair<int, int> > order(clauses.size());
+
+    for (int i = 0; i < clauses.size(); ++i)
+        order[i] = qMakePair(clauses[i].cards.size(), i);
+
+    std::sort(order.begin(), order.end());
+
+    QVector<quint32> cards = clauses[order[0].second].cards;
+    QVector<quint32> remaining;
+
+    for (int i = 1; i < order.size() && !cards.isEmpty(); ++i)
+    {
+        PostingList::intersect(cards, clauses[order[i].second].cards,
+            remaining);
+        cards.swap(remaining);
+    }
+
+    QVector<float> scores(cards.size(), 0.0f);
+
+    for (int i = 0; i < clauses.size(); ++i)
+    {
+        const Clause& clause = clauses[i];
+        int k = 0;
+
+        for (int j = 0; j < cards.size(); ++j)
+        {
+            while (clause.cards[k] < cards[j]) ++k;
+
+            scores[j] += clause.scores[k];
+        }
+    }
+
+    result.resize(cards.size());
+
+    for (int i = 0; i < cards.size(); ++i)
+    {
+        result[i].card = cards[i];
+        result[i].score = scores[i];
+    }
+
+    if (limit > 0 && limit < result.size())
+    {
+        std::partial_sort(result.begin(), result.begin() + limit,
+            result.end(), isLess);
+        result.resize(limit);
+    }
+    else
+    {
+        std::sort(result.begin(), result.end(), isLess);
+    }
+
+    return result;
+}
+
+const char* CardDatabase::fieldName(Field field)
+{
+    return FieldNames[field];
+}
+
+bool CardDatabase::write(const QString& path, const QList<Card>& cards)
+{
+    QMap<QByteArray, int> cardsById;
+
+    for (int i = 0; i < cards.size(); ++i)
+    {
+        QByteArray id = cards[i].fields[Id].toUtf8();
+
+        if (cardsById.contains(id)) return false;
+
+        cardsById.insert(id, i);
+    }
+
+    // Cards are numbered in ID order, so each word's cards are added to its
+    // postings in ascending order.
+    QVector<Record> records(cards.size());
+    QVector<QPair<QByteArray, int> > names(cards.size());
+    QMap<QByteArray, QPair<QVector<quint32>, QVector<quint32> > > postings;
+    QByteArray strings;
+    int i = 0;
+
+    for (QMap<QByteArray, int>::ConstIterator j = cardsById.constBegin();
+        j != cardsById.constEnd(); ++j, ++i)
+    {
+        const Card& card = cards[j.value()];
+        Record& r = records[i];
+        QHash<QByteArray, quint32> weights;
+
+        for (int k = 0; k < FieldCount; ++k)
+        {
+            r.starts[k] = strings.size();
+            strings.append(card.fields[k].toUtf8());
+
+            if (!FieldWeights[k]) continue;
+
+            QVector<QByteArray> terms = words(card.fields[k]);
+
+            for (int m = 0; m < terms.size(); ++m)
+                weights[terms[m]] += FieldWeights[k];
+        }
+
+        r.starts[FieldCount] = strings.size();
+        names[i] = qMakePair(fold(card.fields[Name]), i);
+
+        for (QHash<QByteArray, quint32>::ConstIterator k =
+            weights.constBegin(); k != weights.constEnd(); ++k)
+        {
+            QPair<QVector<quint32>, QVector<quint32> >& p = postings[k.key()];
+            p.first.append(i);
+            p.second.append(k.value());
+        }
+    }
+
+    std::sort(names.begin(), names.end());
+
+    QVector<quint32> nameBlocks;
+    QByteArray nameTable;
+
+    for (i = 0; i < names.size(); ++i)
+    {
+        appendEntry(nameTable, nameBlocks, i, names[i].first,
+            i > 0 ? names[i - 1].first : QByteArray());
+        PostingList::appendVarint(nameTable, names[i].second);
+    }
+
+    QVector<quint32> termBlocks;
+    QByteArray termTable;
+    QByteArray postingData;
+    QByteArray previous;
+    i = 0;
+
+    for (QMap<QByteArray, QPair<QVector<quint32>, QVector<quint32> > >
+        ::ConstIterator j = postings.constBegin(); j != postings.constEnd();
+        ++j, ++i)
+    {
+        appendEntry(termTable, termBlocks, i, j.key(), previous);
+        PostingList::appendVarint(termTable, postingData.size());
+        PostingList::appendVarint(termTable, j.value().first.size());
+        PostingList::encode(j.value().first, j.value().second, postingData);
+        previous = j.key();
+    }
+
+    Header h;
+    memcpy(h.magic, Magic, 8);
+    h.endianness = Endianness;
+    h.count = records.size();
+    h.fieldCount = FieldCount;
+    h.blockSize = BlockSize;
+    h.stringsOffset = sizeof(Header) + records.size() * sizeof(Record);
+    h.stringsSize = strings.size();
+    h.nameBlocksOffset = aligned(h.stringsOffset + h.stringsSize);
+    h.nameBlockCount = nameBlocks.size();
+    h.namesOffset = h.nameBlocksOffset + nameBlocks.size() * 4;
+    h.namesSize = nameTable.size();
+    h.termBlocksOffset = aligned(h.namesOffset + h.namesSize);
+    h.termBlockCount = termBlocks.size();
+    h.termsOffset = h.termBlocksOffset + termBlocks.size() * 4;
+    h.termsSize = termTable.size();
+    h.postingsOffset = h.termsOffset + h.termsSize;
+    h.postingsSize = postingData.size();
+    h.reserved = 0;
+
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    file.write(reinterpret_cast<const char*>(records.constData()),
+        records.size() * sizeof(Record));
+    file.write(strings);
+    file.write(QByteArray(h.nameBlocksOffset - file.pos(), '\0'));
+    file.write(reinterpret_cast<const char*>(nameBlocks.constData()),
+        nameBlocks.size() * 4);
+    file.write(nameTable);
+    file.write(QByteArray(h.termBlocksOffset - file.pos(), '\0'));
+    file.write(reinterpret_cast<const char*>(termBlocks.constData()),
+        termBlocks.size() * 4);
+    file.write(termTable);
+    file.write(postingData);
+    return file.commit();
+}
+
+QVector<int> CardDatabase::scan(const QByteArray& key, bool isPrefix,
+    int limit) const
+{
+    QVector<int> result;
+    Cursor cursor(_names, key);
+
+    while (cursor.next(1))
+    {
+        int order = cursor.match(key, isPrefix);
+
+        if (order > 0) break;
+        if (order < 0) continue;
+
+        if (cursor.values[0] < quint32(_count))
+            result.append(cursor.values[0]);
+
+        if (limit > 0 && result.size() == limit) break;
+    }
+
+    return result;
+}
+
+// A prefix gathers the postings of every word it starts, scoring each card
+// for all of them together. A short prefix can start thousands of words, so
+// once there is more than one, scores are added up by card number rather
+// than merged list by list.
+void CardDatabase::addTerm(const QByteArray& term, bool isPrefix,
+    Clause& clause) const
+{
+    Cursor cursor(_terms, term);
+    QVector<quint32> weights;
+    QVector<float> totals;
+    Clause found;
+    int termCount = 0;
+
+    while (cursor.next(2))
+    {
+        int order = cursor.match(term, isPrefix);
+
+        if (order > 0) break;
+        if (order < 0) continue;
+
+        quint32 offset = cursor.values[0];
+        quint32 count = cursor.values[1];
+
+        if (offset > quint32(_postingsEnd - _postings)
+            || count > quint32(_count)
+            || !PostingList::decode(_postings + offset, _postingsEnd,
+                count, found.cards, weights)
+            || (count > 0 && found.cards.last() >= quint32(_count)))
+            break;
+
+        float idf = std::log(1.0f + (_count - int(count) + 0.5f)
+            / (count + 0.5f));
+        found.scores.resize(count);
+
+        for (quint32 i = 0; i < count; ++i)
+        {
+            found.scores[i] = idf * weights[i] * (K1 + 1.0f)
+                / (weights[i] + K1);
+        }
+
+        if (++termCount == 1)
+        {
+            clause = found;
+        }
+        else
+        {
+            if (termCount == 2)
+            {
+                totals.fill(0.0f, _count);
+
+                for (int i = 0; i < clause.cards.size(); ++i)
+                    totals[clause.cards[i]] = clause.scores[i];
+            }
+
+            for (int i = 0; i < found.cards.size(); ++i)
+                totals[found.cards[i]] += found.scores[i];
+        }
+
+        if (!isPrefix) break;
+    }
+
+    if (termCount < 2) return;
+
+    clause.cards.clear();
+    clause.scores.clear();
+
+    for (int i = 0; i < totals.size(); ++i)
+    {
+        if (totals[i] > 0.0f)
+        {
+            clause.cards.append(i);
+            clause.scores.append(totals[i]);
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef CARDDATABASE_HPP
+#define CARDDATABASE_HPP
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+// Every card's details in one compiled file, mapped into memory whole, so
+// opening it reads nothing but the header. The records are fixed size and
+// sorted by card ID; their text lives in a string pool after them. Names
+// are also kept case folded in a sorted table for lookups by name or name
+// prefix. That table is front coded: in each block of 16 names, every name
+// after the first stores only what it does not share with the one before,
+// and a search binary searches the blocks by their first names, then reads
+// one or two blocks forward.
+//
+// Names, lore and game text are also indexed word by word for search. Each
+// word, case folded, is kept in a second front coded table with the list of
+// cards it appears in and how much weight it has in each, a name counting
+// four times as much as lore or game text.
+//
+// Card numbers are record indices, which follow ID order. Reading is thread
+// safe.
+class CardDatabase
+{
+public:
+    enum Field
+    {
+        Id,
+        Name,
+        Set,
+        Type,
+        Side,
+        Rarity,
+        Lore,
+        Text,
+        FieldCount
+    };
+
+    class Card
+    {
+    public:
+        QString fields[FieldCount];
+    };
+
+    class Match
+    {
+    public:
+        int card;
+        float score;
+    };
+
+    CardDatabase();
+    ~CardDatabase();
+
+    bool open(const QString& path);
+    void close();
+
+    inline bool isOpen() const { return _data != 0; }
+    inline int count() const { return _count; }
+
+    QString text(int card, Field field) const;
+    QByteArray utf8(int card, Field field) const;
+
+    // Returns -1 if there is no such card.
+    int find(const QByteArray& id) const;
+
+    // Names are matched regardless of case. Results are in name order, and
+    // a limit of 0 means all of them.
+    QVector<int> findByName(const QString& name) const;
+    QVector<int> findByPrefix(const QString& prefix, int limit = 0) const;
+
+    // Every word of the query must match, except that words joined by OR
+    // need only one of them to; a word ending in * matches every word it
+    // starts. Results come best match first, scored by BM25 with no length
+    // normalization, and a limit of 0 means all of them.
+    QVector<Match> search(const QString& query, int limit = 0) const;
+
+    static const char* fieldName(Field field);
+
+    // Fails if two cards have the same ID.
+    static bool write(const QString& path, const QList<Card>& cards);
+
+private:
+    class Header;
+    class Record;
+    class Cursor;
+    class Clause;
+
+    // A front coded table and the offsets of its blocks.
+    class Table
+    {
+    public:
+        const quint32* blocks;
+        int blockCount;
+        const uchar* data;
+        const uchar* end;
+    };
+
+    inline const Record& record(int index) const;
+    QVector<int> scan(const QByteArray& key, bool isPrefix, int limit) const;
+    void addTerm(const QByteArray& term, bool isPrefix, Clause& clause) const;
+
+    QFile _file;
+    const uchar* _data;
+    int _count;
+    const char* _strings;
+    Table _names;
+    Table _terms;
+    const uchar* _postings;
+    const uchar* _postingsEnd;
+};
+
+#endif
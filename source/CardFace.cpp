@@ -0,0 +1,17 @@
+#include "CardFace.hpp"
+#include <QCryptographicHash>
+#include <QDataStream>
+
+// Bump this whenever the layout changes so stale cached faces are ignored.
+static const int LayoutVersion = 2;
+
+// The paths themselves are left out: what matters is what is in the files.
+QByteArray CardFace::key(const QByteArray& frameHash,
+    const QByteArray& artHash, int textureSize) const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << LayoutVersion << textureSize << frameHash << artHash << artCrop
+        << title << text;
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+}
@@ -0,0 +1,30 @@
+#ifndef CARDFACE_HPP
+#define CARDFACE_HPP
+
+#include <QByteArray>
+#include <QRectF>
+#include <QString>
+
+// Everything needed to compose the front of a card. Images are file paths;
+// artCrop is the part of the art to show, in fractions of its size.
+class CardFace
+{
+public:
+    CardFace() : artCrop(0.0, 0.0, 1.0, 1.0)
+    {
+    }
+
+    QString frame;
+    QString art;
+    QRectF artCrop;
+    QString title;
+    QString text;
+
+    // Identifies the composed result, both in memory and in the disk cache,
+    // given the SHA-1 of the frame and art images it is composed from and
+    // the size it is composed at (see CardCompositor::key).
+    QByteArray key(const QByteArray& frameHash, const QByteArray& artHash,
+        int textureSize) const;
+};
+
+#endif
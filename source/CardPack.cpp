@@ -0,0 +1,254 @@
+#include "CardPack.hpp"
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QVector>
+#include <cstring>
+
+static const char Magic[8] = { 'D', 'J', 'X', 'P', 'A', 'C', 'K', '1' };
+static const quint32 Endianness = 0x04030201;
+static const qint64 PageSize = 4096;
+
+class CardPack::Header
+{
+public:
+    char magic[8];
+    quint32 endianness;
+    quint32 count;
+    quint32 namesOffset;
+    quint32 namesSize;
+    quint32 pageSize;
+    quint32 reserved;
+};
+
+// Names live in a table of their own after the records, so the records stay
+// fixed size and a binary search only reads the names it compares.
+class CardPack::Record
+{
+public:
+    quint64 offset;
+    quint32 size;
+    quint32 format;
+    quint32 nameOffset;
+    quint32 nameSize;
+    uchar hash[20];
+    quint32 reserved;
+};
+
+static inline qint64 pageAligned(qint64 offset)
+{
+    return (offset + PageSize - 1) & ~(PageSize - 1);
+}
+
+static int compare(const char* a, int aSize, const char* b, int bSize)
+{
+    int result = memcmp(a, b, qMin(aSize, bSize));
+    return result ? result : aSize - bSize;
+}
+
+CardPack::CardPack() : _data(0), _count(0), _names(0)
+{
+}
+
+CardPack::~CardPack()
+{
+}
+
+// Everything the index says is checked here, once, so lookups can trust it.
+bool CardPack::open(const QString& path)
+{
+    close();
+    _file.setFileName(path);
+
+    if (!_file.open(QIODevice::ReadOnly)) return false;
+
+    qint64 size = _file.size();
+    const uchar* data = size >= qint64(sizeof(Header))
+        ? _file.map(0, size) : 0;
+
+    if (!data)
+    {
+        _file.close();
+        return false;
+    }
+
+    Header header;
+    memcpy(&header, data, sizeof(header));
+
+    bool isValid = memcmp(header.magic, Magic, 8) == 0
+        && header.endianness == Endianness
+        && qint64(header.namesOffset) == qint64(sizeof(Header))
+            + qint64(header.count) * qint64(sizeof(Record))
+        && qint64(header.namesOffset) + header.namesSize <= size;
+
+    const Record* records =
+        reinterpret_cast<const Record*>(data + sizeof(Header));
+    const char* names =
+        reinterpret_cast<const char*>(data + header.namesOffset);
+
+    for (quint32 i = 0; isValid && i < header.count; ++i)
+    {
+        const Record& r = records[i];
+
+        isValid = r.nameOffset <= header.namesSize
+            && r.nameSize <= header.namesSize - r.nameOffset
+            && r.offset <= quint64(size) && r.size <= size - r.offset
+            && r.format <= Gif;
+
+        if (isValid && i > 0)
+        {
+            const Record& p = records[i - 1];
+            isValid = compare(names + p.nameOffset, p.nameSize,
+                names + r.nameOffset, r.nameSize) < 0;
+        }
+    }
+
+    if (!isValid)
+    {
+        _file.close();
+        return false;
+    }
+
+    _data = data;
+    _count = header.count;
+    _names = names;
+    return true;
+}
+
+void CardPack::close()
+{
+    _file.close();
+    _data = 0;
+    _count = 0;
+    _names = 0;
+}
+
+inline const CardPack::Record& CardPack::record(int index) const
+{
+    return reinterpret_cast<const Record*>(_data + sizeof(Header))[index];
+}
+
+QByteArray CardPack::id(int index) const
+{
+    const Record& r = record(index);
+    return QByteArray(_names + r.nameOffset, r.nameSize);
+}
+
+bool CardPack::find(const QByteArray& id, Entry& entry) const
+{
+    int low = 0;
+    int high = _count;
+
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        const Record& r = record(middle);
+        int order = compare(_names + r.nameOffset, r.nameSize,
+            id.constData(), id.size());
+
+        if (order == 0)
+        {
+            fill(middle, entry);
+            return true;
+        }
+
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return false;
+}
+
+QImage CardPack::image(const QByteArray& id) const
+{
+    static const char* const FormatNames[] = { 0, "PNG", "JPG", "GIF" };
+    Entry e;
+
+    if (!find(id, e)) return QImage();
+
+    return QImage::fromData(e.data, e.size, FormatNames[e.format]);
+}
+
+CardPack::Format CardPack::detect(const QByteArray& data)
+{
+    if (data.startsWith("\x89PNG")) return Png;
+    if (data.startsWith("\xFF\xD8\xFF")) return Jpeg;
+    if (data.startsWith("GIF8")) return Gif;
+
+    return Other;
+}
+
+bool CardPack::write(const QString& path,
+    const QMap<QByteArray, QByteArray>& images)
+{
+    QVector<Record> records(images.size());
+    QByteArray names;
+    int i = 0;
+
+    for (QMap<QByteArray, QByteArray>::ConstIterator j = images.constBegin();
+        j != images.constEnd(); ++j, ++i)
+    {
+        Record& r = records[i];
+        memset(&r, 0, sizeof(r));
+        r.nameOffset = names.size();
+        r.nameSize = j.key().size();
+        names.append(j.key());
+    }
+
+    Header header;
+    memcpy(header.magic, Magic, 8);
+    header.endianness = Endianness;
+    header.count = records.size();
+    header.namesOffset = sizeof(Header) + records.size() * sizeof(Record);
+    header.namesSize = names.size();
+    header.pageSize = PageSize;
+    header.reserved = 0;
+
+    qint64 offset = pageAligned(header.namesOffset + header.namesSize);
+    i = 0;
+
+    for (QMap<QByteArray, QByteArray>::ConstIterator j = images.constBegin();
+        j != images.constEnd(); ++j, ++i)
+    {
+        Record& r = records[i];
+        QByteArray hash =
+            QCryptographicHash::hash(j.value(), QCryptographicHash::Sha1);
+
+        r.offset = offset;
+        r.size = j.value().size();
+        r.format = detect(j.value());
+        memcpy(r.hash, hash.constData(), sizeof(r.hash));
+        offset = pageAligned(offset + r.size);
+    }
+
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.constData()),
+        records.size() * sizeof(Record));
+    file.write(names);
+
+    i = 0;
+
+    for (QMap<QByteArray, QByteArray>::ConstIterator j = images.constBegin();
+        j != images.constEnd(); ++j, ++i)
+    {
+        file.write(QByteArray(records[i].offset - file.pos(), '\0'));
+        file.write(j.value());
+    }
+
+    return file.commit();
+}
+
+void CardPack::fill(int index, Entry& entry) const
+{
+    const Record& r = record(index);
+    entry.data = _data + r.offset;
+    entry.size = r.size;
+    entry.format = Format(r.format);
+    entry.hash = QByteArray(reinterpret_cast<const char*>(r.hash),
+        sizeof(r.hash));
+}
@@ -0,0 +1,71 @@
+#ifndef CARDPACK_HPP
+#define CARDPACK_HPP
+
+#include <QByteArray>
+#include <QFile>
+#include <QImage>
+#include <QMap>
+#include <QString>
+
+// Every card image in one file, mapped into memory whole. The index at the
+// front is sorted by card ID and gives each image's offset, size, format and
+// SHA-1; the images themselves start on page boundaries. Once the pack is
+// open, finding and reading an image touches nothing but mapped pages, so
+// streamer threads can decode straight out of it without opening or
+// statting anything.
+//
+// Entries point into the mapping, so they are only good while the pack stays
+// open. Reading is thread safe.
+class CardPack
+{
+public:
+    enum Format
+    {
+        Other,
+        Png,
+        Jpeg,
+        Gif
+    };
+
+    class Entry
+    {
+    public:
+        const uchar* data;
+        int size;
+        Format format;
+        QByteArray hash;
+    };
+
+    CardPack();
+    ~CardPack();
+
+    bool open(const QString& path);
+    void close();
+
+    inline bool isOpen() const { return _data != 0; }
+    inline int count() const { return _count; }
+
+    QByteArray id(int index) const;
+    bool find(const QByteArray& id, Entry& entry) const;
+    QImage image(const QByteArray& id) const;
+
+    static Format detect(const QByteArray& data);
+
+    // Writes a pack of the given images (file contents, keyed by card ID).
+    static bool write(const QString& path,
+        const QMap<QByteArray, QByteArray>& images);
+
+private:
+    class Header;
+    class Record;
+
+    inline const Record& record(int index) const;
+    void fill(int index, Entry& entry) const;
+
+    QFile _file;
+    const uchar* _data;
+    int _count;
+    const char* _names;
+};
+
+#endif
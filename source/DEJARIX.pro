@@ -11,6 +11,12 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = DEJARIX
 TEMPLATE = app
 
+# qmake CONFIG+=allocation_tracking counts heap allocations per frame.
+allocation_tracking {
+    DEFINES += DEJARIX_TRACK_ALLOCATIONS
+    unix: QMAKE_LFLAGS += -rdynamic
+}
+
 
 SOURCES += main.cpp\
         MainWindow.cpp \
@@ -23,7 +29,28 @@ SOURCES += main.cpp\
     Rotation.cpp \
     Camera.cpp \
     Animation.cpp \
-    TableBuffer.cpp
+    TableBuffer.cpp \
+    Picker.cpp \
+    Tweener.cpp \
+    SimulationClock.cpp \
+    JobSystem.cpp \
+    AllocationTracker.cpp \
+    TableHistory.cpp \
+    GlyphAtlas.cpp \
+    TextProgram.cpp \
+    TextBuffer.cpp \
+    CardFace.cpp \
+    CardCompositor.cpp \
+    TableResources.cpp \
+    TextureStreamer.cpp \
+    TextureManager.cpp \
+    TextureFile.cpp \
+    BlockCompressor.cpp \
+    ImageResampler.cpp \
+    CardPack.cpp \
+    PackUpdater.cpp \
+    CardDatabase.cpp \
+    PostingList.cpp
 
 HEADERS  += MainWindow.hpp \
     MainWidget.hpp \
@@ -35,4 +62,25 @@ HEADERS  += MainWindow.hpp \
     Rotation.hpp \
     Camera.hpp \
     Animation.hpp \
-    TableBuffer.hpp
+    TableBuffer.hpp \
+    Picker.hpp \
+    Tweener.hpp \
+    SimulationClock.hpp \
+    JobSystem.hpp \
+    AllocationTracker.hpp \
+    TableHistory.hpp \
+    GlyphAtlas.hpp \
+    TextProgram.hpp \
+    TextBuffer.hpp \
+    CardFace.hpp \
+    CardCompositor.hpp \
+    TableResources.hpp \
+    TextureStreamer.hpp \
+    TextureManager.hpp \
+    TextureFile.hpp \
+    BlockCompressor.hpp \
+    ImageResampler.hpp \
+    CardPack.hpp \
+    PackUpdater.hpp \
+    CardDatabase.hpp \
+    PostingList.hpp
@@ -0,0 +1,224 @@
+#include "GlyphAtlas.hpp"
+#include <QFontMetricsF>
+#include <QImage>
+#include <QPainter>
+#include <QVector>
+#include <cmath>
+
+// The 8SSEDT distance transform: each pixel remembers the offset to the
+// nearest seed pixel, and two sweeps propagate offsets from the neighbors.
+class DistanceField
+{
+public:
+    DistanceField(int width, int height)
+        : _width(width), _height(height), _offsets(width * height * 2)
+    {
+    }
+
+    void seed(int x, int y, bool isSeed)
+    {
+        int* o = _offsets.data() + (y * _width + x) * 2;
+        o[0] = isSeed ? 0 : Far;
+        o[1] = isSeed ? 0 : Far;
+    }
+
+    void transform()
+    {
+        for (int y = 0; y < _height; ++y)
+        {
+            for (int x = 0; x < _width; ++x)
+            {
+                compare(x, y, -1, 0);
+                compare(x, y, 0, -1);
+                compare(x, y, -1, -1);
+                compare(x, y, 1, -1);
+            }
+
+            for (int x = _width - 1; x >= 0; --x)
+                compare(x, y, 1, 0);
+        }
+
+        for (int y = _height - 1; y >= 0; --y)
+        {
+            for (int x = _width - 1; x >= 0; --x)
+            {
+                compare(x, y, 1, 0);
+                compare(x, y, 0, 1);
+                compare(x, y, -1, 1);
+                compare(x, y, 1, 1);
+            }
+
+            for (int x = 0; x < _width; ++x)
+                compare(x, y, -1, 0);
+        }
+    }
+
+    float distance(int x, int y) const
+    {
+        const int* o = _offsets.constData() + (y * _width + x) * 2;
+        return sqrtf(float(o[0] * o[0] + o[1] * o[1]));
+    }
+
+private:
+    static const int Far = 9999;
+
+    void compare(int x, int y, int dx, int dy)
+    {
+        int nx = x + dx;
+        int ny = y + dy;
+
+        if (nx < 0 || ny < 0 || nx >= _width || ny >= _height) return;
+
+        int* o = _offsets.data() + (y * _width + x) * 2;
+        const int* n = _offsets.constData() + (ny * _width + nx) * 2;
+        int ox = n[0] + dx;
+        int oy = n[1] + dy;
+
+        if (ox * ox + oy * oy < o[0] * o[0] + o[1] * o[1])
+        {
+            o[0] = ox;
+            o[1] = oy;
+        }
+    }
+
+    int _width;
+    int _height;
+    QVector<int> _offsets;
+};
+
+GlyphAtlas::GlyphAtlas(const QFont& font, int cellSize, int spread)
+    : _texture(0), _cellSize(cellSize), _spread(spread)
+{
+    initializeOpenGLFunctions();
+
+    const int cell = _cellSize * Scale;
+    const int margin = _spread * Scale;
+    const int rows = (Count + Columns - 1) / Columns;
+
+    int width = Columns * _cellSize;
+    int height = 1;
+    while (height < rows * _cellSize) height *= 2;
+
+    // Fit the line (ascent plus descent) between the margins of a cell.
+    QFont large(font);
+    large.setPixelSize(cell - margin * 2);
+    QFontMetricsF metrics(large);
+    float scale = float(cell - margin * 2) / float(metrics.height());
+    large.setPixelSize(qMax(1, int(float(cell - margin * 2) * scale)));
+    metrics = QFontMetricsF(large);
+
+    float line = float(metrics.ascent() + metrics.descent());
+    float baseline = float(margin) + float(metrics.ascent());
+    _middle = float(metrics.ascent() - metrics.descent()) / (2.0f * line);
+    _badgeRadius = float(cell / 2 - margin) / float(cell);
+    _texelsPerLine = line / float(Scale);
+
+    QImage image(cell, cell, QImage::Format_ARGB32_Premultiplied);
+    QVector<unsigned char> atlas(width * height, 0);
+    DistanceField inside(cell, cell);
+    DistanceField outside(cell, cell);
+
+    for (int i = 0; i < Count; ++i)
+    {
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(Qt::white);
+        painter.setBrush(Qt::white);
+        painter.setFont(large);
+
+        if (First + i == Badge)
+        {
+            painter.drawEllipse(QPointF(cell / 2.0, cell / 2.0),
+                cell / 2.0 - margin, cell / 2.0 - margin);
+        }
+        else
+        {
+            painter.drawText(QPointF(margin, baseline),
+                QString(QChar(First + i)));
+        }
+
+        painter.end();
+
+        for (int y = 0; y < cell; ++y)
+        {
+            const QRgb* pixels = reinterpret_cast<const QRgb*>(
+                image.constScanLine(y));
+
+            for (int x = 0; x < cell; ++x)
+            {
+                bool isInside = qAlpha(pixels[x]) > 127;
+                inside.seed(x, y, !isInside);
+                outside.seed(x, y, isInside);
+            }
+        }
+
+        inside.transform();
+        outside.transform();
+
+        int column = i % Columns;
+        int row = i / Columns;
+
+        // Each atlas texel takes the signed distance at the middle of the
+        // block of large pixels it covers: 0.5 on the edge, rising inward.
+        for (int y = 0; y < _cellSize; ++y)
+        {
+            for (int x = 0; x < _cellSize; ++x)
+            {
+                int sx = x * Scale + Scale / 2;
+                int sy = y * Scale + Scale / 2;
+                float d = inside.distance(sx, sy) - outside.distance(sx, sy);
+                float value = 0.5f + d / float(2 * margin);
+                value = qBound(0.0f, value, 1.0f);
+
+                atlas[(row * _cellSize + y) * width + column * _cellSize + x]
+                    = (unsigned char)(value * 255.0f + 0.5f);
+            }
+        }
+
+        // Rows were uploaded top down, so the top of a cell has the smaller
+        // texture coordinate.
+        Glyph& glyph = _glyphs[i];
+        glyph.s0 = float(column * _cellSize) / float(width);
+        glyph.s1 = float((column + 1) * _cellSize) / float(width);
+        glyph.t0 = float((row + 1) * _cellSize) / float(height);
+        glyph.t1 = float(row * _cellSize) / float(height);
+        glyph.left = -float(margin) / line;
+        glyph.right = float(cell - margin) / line;
+        glyph.top = baseline / line;
+        glyph.bottom = (baseline - float(cell)) / line;
+        glyph.advance = float(metrics.width(QChar(First + i))) / line;
+    }
+
+    glGenTextures(1, &_texture);
+    glBindTexture(GL_TEXTURE_2D, _texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0,
+        GL_LUMINANCE, GL_UNSIGNED_BYTE, atlas.constData());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+    glDeleteTextures(1, &_texture);
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::glyph(char c) const
+{
+    int i = int((unsigned char)c) - First;
+    return i >= 0 && i < Count ? _glyphs[i] : _glyphs['?' - First];
+}
+
+float GlyphAtlas::width(const char* text) const
+{
+    float result = 0.0f;
+
+    for (; *text; ++text)
+        result += glyph(*text).advance;
+
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef GLYPHATLAS_HPP
+#define GLYPHATLAS_HPP
+
+#include <QOpenGLFunctions>
+#include <QFont>
+
+// A texture of signed distance fields for the printable ASCII characters (plus
+// a filled disc for badges), generated at startup. Glyphs are rendered large,
+// run through a Euclidean distance transform, and sampled down, so they stay
+// sharp whether they end up a few pixels tall or fill the screen.
+//
+// Metrics are in lines: a glyph laid out at size 1 has a line height
+// (ascent plus descent) of 1.
+class GlyphAtlas : protected QOpenGLFunctions
+{
+public:
+    class Glyph
+    {
+    public:
+        float s0;
+        float t0;
+        float s1;
+        float t1;
+        float left;
+        float bottom;
+        float right;
+        float top;
+        float advance;
+    };
+
+    static const int Badge = 127;
+
+    explicit GlyphAtlas(const QFont& font = QFont(), int cellSize = 32,
+        int spread = 4);
+    virtual ~GlyphAtlas();
+
+    inline GLuint texture() const { return _texture; }
+    inline int cellSize() const { return _cellSize; }
+    inline int spread() const { return _spread; }
+
+    // Distance from the baseline to the middle of the line.
+    inline float middle() const { return _middle; }
+
+    // Radius of the badge disc relative to the size of its quad.
+    inline float badgeRadius() const { return _badgeRadius; }
+
+    // How many atlas texels a line of text is tall.
+    inline float texelsPerLine() const { return _texelsPerLine; }
+
+    const Glyph& glyph(char c) const;
+    float width(const char* text) const;
+
+private:
+    static const int First = 32;
+    static const int Count = 96;
+    static const int Columns = 16;
+    static const int Scale = 4;
+
+    Glyph _glyphs[Count];
+    GLuint _texture;
+    int _cellSize;
+    int _spread;
+    float _middle;
+    float _badgeRadius;
+    float _texelsPerLine;
+};
+
+#endif
@@ -0,0 +1,311 @@
+#include "ImageResampler.hpp"
+#include <QVector>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define DEJARIX_USE_SSE
+#   include <emmintrin.h>
+#endif
+
+// The taps for one axis. Each target pixel reads a run of source pixels
+// starting at first; taps hanging off either edge fold onto the edge pixel.
+class ImageResampler::Filter
+{
+public:
+    Filter(int sourceSize, int size)
+    {
+        float scale = float(sourceSize) / float(size);
+        float radius = qMax(scale, 1.0f);
+        stride = int(std::ceil(radius)) * 2 + 1;
+        first.resize(size);
+        counts.resize(size);
+        weights.fill(0.0f, size * stride);
+
+        for (int i = 0; i < size; ++i)
+        {
+            float center = (float(i) + 0.5f) * scale - 0.5f;
+            int low = int(std::floor(center - radius)) + 1;
+            int high = int(std::floor(center + radius));
+            first[i] = qBound(0, low, sourceSize - 1);
+            counts[i] = qBound(0, high, sourceSize - 1) - first[i] + 1;
+
+            float* w = weights.data() + i * stride;
+            float total = 0.0f;
+
+            for (int j = low; j <= high; ++j)
+            {
+                float weight = 1.0f - qAbs(float(j) - center) / radius;
+
+                if (weight <= 0.0f) continue;
+
+                w[qBound(0, j, sourceSize - 1) - first[i]] += weight;
+                total += weight;
+            }
+
+            for (int k = 0; k < counts[i]; ++k)
+                w[k] /= total;
+        }
+    }
+
+    int stride;
+    QVector<int> first;
+    QVector<int> counts;
+    QVector<float> weights;
+};
+
+static void copyRow(const uchar* source, int count, bool swapRedBlue,
+    uchar* target)
+{
+    if (!swapRedBlue)
+    {
+        memcpy(target, source, count * 4);
+        return;
+    }
+
+    int x = 0;
+
+#ifdef DEJARIX_USE_SSE
+    const __m128i greenAlpha = _mm_set1_epi32(0xff00ff00);
+    const __m128i redBlue = _mm_set1_epi32(0x00ff00ff);
+
+    for (; x + 4 <= count; x += 4)
+    {
+        __m128i p = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(source + x * 4));
+        __m128i rb = _mm_and_si128(p, redBlue);
+        rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+        p = _mm_or_si128(_mm_and_si128(p, greenAlpha), rb);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x * 4), p);
+    }
+#endif
+
+    for (; x < count; ++x)
+    {
+        target[x * 4] = source[x * 4 + 2];
+        target[x * 4 + 1] = source[x * 4 + 1];
+        target[x * 4 + 2] = source[x * 4];
+        target[x * 4 + 3] = source[x * 4 + 3];
+    }
+}
+
+// Adds a weighted source row to a row of float channels.
+static void accumulateRow(const uchar* source, int count, float weight,
+    float* row)
+{
+    int x = 0;
+
+#ifdef DEJARIX_USE_SSE
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 w = _mm_set1_ps(weight);
+
+    for (; x + 4 <= count; x += 4)
+    {
+        __m128i p = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(source + x * 4));
+        __m128i low = _mm_unpacklo_epi8(p, zero);
+        __m128i high = _mm_unpackhi_epi8(p, zero);
+        __m128 pixels[4] = {
+            _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)),
+            _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)),
+            _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)),
+            _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)) };
+        float* r = row + x * 4;
+
+        for (int k = 0; k < 4; ++k)
+        {
+            _mm_storeu_ps(r + k * 4, _mm_add_ps(_mm_loadu_ps(r + k * 4),
+                _mm_mul_ps(pixels[k], w)));
+        }
+    }
+#endif
+
+    for (int i = x * 4; i < count * 4; ++i)
+        row[i] += float(source[i]) * weight;
+}
+
+void ImageResampler::filterRow(const float* row, const Filter& filter,
+    int count, bool swapRedBlue, uchar* target)
+{
+    const float* weights = filter.weights.constData();
+
+    for (int x = 0; x < count; ++x)
+    {
+        const float* p = row + filter.first[x] * 4;
+        const float* w = weights + x * filter.stride;
+        int taps = filter.counts[x];
+
+#ifdef DEJARIX_USE_SSE
+        __m128 sum = _mm_setzero_ps();
+
+        for (int k = 0; k < taps; ++k)
+        {
+            sum = _mm_add_ps(sum,
+                _mm_mul_ps(_mm_loadu_ps(p + k * 4), _mm_set1_ps(w[k])));
+        }
+
+        if (swapRedBlue)
+            sum = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 0, 1, 2));
+
+        __m128i v = _mm_cvtps_epi32(sum);
+        v = _mm_packs_epi32(v, v);
+        v = _mm_packus_epi16(v, v);
+        int pixel = _mm_cvtsi128_si32(v);
+        memcpy(target + x * 4, &pixel, 4);
+#else
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        for (int k = 0; k < taps; ++k)
+        {
+            for (int c = 0; c < 4; ++c)
+                sum[c] += p[k * 4 + c] * w[k];
+        }
+
+        for (int c = 0; c < 4; ++c)
+        {
+            int channel = swapRedBlue && c != 1 && c != 3 ? 2 - c : c;
+            target[x * 4 + c] = uchar(qBound(0, int(sum[channel] + 0.5f),
+                255));
+        }
+#endif
+    }
+}
+
+QImage ImageResampler::pixels(const QImage& image, bool& isBgra)
+{
+    switch (image.format())
+    {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+        if (Q_BYTE_ORDER == Q_LITTLE_ENDIAN)
+        {
+            isBgra = true;
+            return image;
+        }
+
+        break;
+
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+        isBgra = false;
+        return image;
+
+    default:
+        break;
+    }
+
+    isBgra = false;
+    return image.convertToFormat(QImage::Format_RGBA8888);
+}
+
+bool ImageResampler::isOpaque(const QImage& image)
+{
+    if (!image.hasAlphaChannel()) return true;
+
+    // The alpha byte sits at the same offset in both orders pixels() hands
+    // out, so the whole image can be folded together with one AND.
+    uchar alpha = 255;
+
+    for (int y = 0; y < image.height() && alpha == 255; ++y)
+    {
+        const uchar* line = image.constScanLine(y);
+
+        for (int x = 0; x < image.width(); ++x)
+            alpha &= line[x * 4 + 3];
+    }
+
+    return alpha == 255;
+}
+
+void ImageResampler::resample(const QImage& image, int width, int height,
+    uchar* target, bool swapRedBlue, bool flip)
+{
+    int sourceWidth = image.width();
+    int sourceHeight = image.height();
+
+    if (width == sourceWidth && height == sourceHeight)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            copyRow(image.constScanLine(y), width, swapRedBlue,
+                target + (flip ? height - 1 - y : y) * width * 4);
+        }
+
+        return;
+    }
+
+    // Rows are filtered first, into one row of floats at the source width,
+    // and that row is then filtered across into the target.
+    Filter columns(sourceWidth, width);
+    Filter rows(sourceHeight, height);
+    QVector<float> row(sourceWidth * 4);
+
+    for (int y = 0; y < height; ++y)
+    {
+        row.fill(0.0f);
+        const float* w = rows.weights.constData() + y * rows.stride;
+
+        for (int k = 0; k < rows.counts[y]; ++k)
+        {
+            accumulateRow(image.constScanLine(rows.first[y] + k),
+                sourceWidth, w[k], row.data());
+        }
+
+        filterRow(row.constData(), columns, width, swapRedBlue,
+            target + (flip ? height - 1 - y : y) * width * 4);
+    }
+}
+
+void ImageResampler::halve(const uchar* pixels, int width, int height,
+    uchar* target)
+{
+    int targetWidth = qMax(width / 2, 1);
+    int targetHeight = qMax(height / 2, 1);
+    int stepX = width > 1 ? 4 : 0;
+
+    for (int y = 0; y < targetHeight; ++y)
+    {
+        const uchar* top = pixels + qMin(y * 2, height - 1) * width * 4;
+        const uchar* bottom = pixels + qMin(y * 2 + 1, height - 1) * width * 4;
+        uchar* line = target + y * targetWidth * 4;
+        int x = 0;
+
+#ifdef DEJARIX_USE_SSE
+        // Two target pixels from four source pixels in each row, summed in
+        // 16 bits so the rounding matches the scalar loop exactly.
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+
+        for (; stepX && x + 2 <= targetWidth; x += 2)
+        {
+            __m128i a = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(top + x * 8));
+            __m128i b = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(bottom + x * 8));
+            __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                _mm_unpacklo_epi8(b, zero));
+            __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                _mm_unpackhi_epi8(b, zero));
+            low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+            high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+            __m128i sum = _mm_unpacklo_epi64(low, high);
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(line + x * 4),
+                _mm_packus_epi16(sum, sum));
+        }
+#endif
+
+        for (; x < targetWidth; ++x)
+        {
+            const uchar* a = top + x * 8;
+            const uchar* b = bottom + x * 8;
+
+            for (int k = 0; k < 4; ++k)
+            {
+                line[x * 4 + k] =
+                    (a[k] + a[k + stepX] + b[k] + b[k + stepX] + 2) / 4;
+            }
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef IMAGERESAMPLER_HPP
+#define IMAGERESAMPLER_HPP
+
+#include <QImage>
+
+// Scales and mipmaps 32 bit images on the CPU, four channels at a time with
+// SSE2 where the compiler targets it. Channels are treated alike whatever
+// their order, and red and blue can be swapped and rows flipped bottom up on
+// the way through, so getting an image ready for GL takes a single pass.
+class ImageResampler
+{
+public:
+    // The image with 32 bit pixels, converted only if it did not have them
+    // already. isBgra tells whether the bytes run blue, green, red, alpha
+    // (which is how QImage keeps ARGB32 on little endian machines) rather
+    // than red, green, blue, alpha.
+    static QImage pixels(const QImage& image, bool& isBgra);
+
+    // Takes an image from pixels().
+    static bool isOpaque(const QImage& image);
+
+    // Takes an image from pixels() and writes width by height pixels,
+    // tightly packed, to target. The filter is a triangle, widened when
+    // shrinking so that every source pixel contributes.
+    static void resample(const QImage& image, int width, int height,
+        uchar* target, bool swapRedBlue, bool flip);
+
+    // Averages each 2 x 2 square of pixels (or pair, once a side is down to
+    // one) into the next mip level.
+    static void halve(const uchar* pixels, int width, int height,
+        uchar* target);
+
+private:
+    class Filter;
+
+    static void filterRow(const float* row, const Filter& filter, int count,
+        bool swapRedBlue, uchar* target);
+};
+
+#endif
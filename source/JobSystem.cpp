@@ -0,0 +1,284 @@
+#include "JobSystem.hpp"
+
+JobSystem::Worker::Worker(JobSystem& system, int index)
+    : _system(system), _index(index)
+{
+}
+
+void JobSystem::Worker::run()
+{
+    _system.work(_index);
+}
+
+JobSystem::JobSystem(int threadCount, int capacity)
+    : _capacity(capacity), _isQuitting(false)
+{
+    if (threadCount < 1) threadCount = QThread::idealThreadCount();
+    if (threadCount < 1) threadCount = 1;
+
+    _jobs = new JobData[_capacity];
+
+    for (int i = 0; i < _capacity; ++i)
+        _jobs[i].unfinished = 0;
+
+    for (int i = 0; i < threadCount; ++i)
+    {
+        Queue* queue = new Queue;
+        queue->jobs.resize(_capacity);
+        queue->head = 0;
+        queue->count = 0;
+        _queues.append(queue);
+    }
+
+    // Worker 0 is whichever thread calls wait().
+    for (int i = 1; i < threadCount; ++i)
+    {
+        Worker* worker = new Worker(*this, i);
+        _workers.append(worker);
+        worker->start();
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    _sleepMutex.lock();
+    _isQuitting = true;
+    _sleep.wakeAll();
+    _sleepMutex.unlock();
+
+    for (int i = 0; i < _workers.size(); ++i)
+    {
+        _workers[i]->wait();
+        delete _workers[i];
+    }
+
+    for (int i = 0; i < _queues.size(); ++i)
+        delete _queues[i];
+
+    delete [] _jobs;
+}
+
+JobSystem::Job JobSystem::add(Function function, void* data, int begin,
+    int end, int grain, Job dependency)
+{
+    Job job = allocate();
+    JobData& j = _jobs[job];
+    j.function = function;
+    j.data = data;
+    j.begin = begin;
+    j.end = end;
+    j.grain = grain > 0 ? grain : 1;
+    j.parent = NoJob;
+    j.continuation = NoJob;
+    j.nextContinuation = NoJob;
+    j.allocationScope = AllocationTracker::chargedScope();
+    j.unfinished.storeRelease(1);
+
+    if (dependency != NoJob)
+    {
+        QMutexLocker locker(&_continuationMutex);
+        JobData& d = _jobs[dependency];
+
+        if (d.unfinished.loadAcquire() > 0)
+        {
+            j.nextContinuation = d.continuation;
+            d.continuation = job;
+            return job;
+        }
+    }
+
+    push(0, job);
+    return job;
+}
+
+bool JobSystem::isFinished(Job job) const
+{
+    return _jobs[job].unfinished.loadAcquire() == 0;
+}
+
+// Like the workers, the waiter registers itself before checking, and finish()
+// releases the job before checking for waiters.
+void JobSystem::wait(Job job)
+{
+    while (!isFinished(job))
+    {
+        Job next = take(0);
+
+        if (next != NoJob)
+        {
+            execute(0, next);
+            continue;
+        }
+
+        QMutexLocker locker(&_waitMutex);
+        _waiting.fetchAndAddOrdered(1);
+
+        if (!isFinished(job) && _queued.loadAcquire() == 0)
+            _finished.wait(&_waitMutex);
+
+        _waiting.fetchAndAddOrdered(-1);
+    }
+}
+
+// Slots are claimed in turn, skipping any still in use; a full lap without a
+// free one means the table is too small for the work given to it.
+JobSystem::Job JobSystem::allocate()
+{
+    for (int i = 0; i < _capacity; ++i)
+    {
+        unsigned int n = unsigned(_nextJob.fetchAndAddOrdered(1));
+        Job result = Job(n % unsigned(_capacity));
+
+        if (_jobs[result].unfinished.testAndSetOrdered(0, 1))
+            return result;
+    }
+
+    qFatal("JobSystem: more than %d jobs unfinished at once", _capacity);
+    return NoJob;
+}
+
+// Sleeping workers register themselves before checking the queued count, and
+// pushers bump the count before checking for sleepers, so at least one side
+// always sees the other.
+void JobSystem::push(int worker, Job job)
+{
+    Queue& queue = *_queues[worker];
+    queue.mutex.lock();
+    queue.jobs[(queue.head + queue.count) % _capacity] = job;
+    ++queue.count;
+    queue.mutex.unlock();
+
+    _queued.fetchAndAddOrdered(1);
+
+    if (_sleeping.loadAcquire() > 0)
+    {
+        QMutexLocker locker(&_sleepMutex);
+        _sleep.wakeOne();
+    }
+}
+
+JobSystem::Job JobSystem::take(int worker)
+{
+    Job result = NoJob;
+    Queue& own = *_queues[worker];
+
+    own.mutex.lock();
+
+    if (own.count > 0)
+    {
+        --own.count;
+        result = own.jobs[(own.head + own.count) % _capacity];
+    }
+
+    own.mutex.unlock();
+
+    for (int i = 1; result == NoJob && i < _queues.size(); ++i)
+    {
+        Queue& other = *_queues[(worker + i) % _queues.size()];
+
+        other.mutex.lock();
+
+        if (other.count > 0)
+        {
+            result = other.jobs[other.head];
+            other.head = (other.head + 1) % _capacity;
+            --other.count;
+        }
+
+        other.mutex.unlock();
+    }
+
+    if (result != NoJob) _queued.fetchAndAddOrdered(-1);
+
+    return result;
+}
+
+void JobSystem::execute(int worker, Job job)
+{
+    JobData& j = _jobs[job];
+
+    while (j.end - j.begin > j.grain)
+    {
+        int middle = j.begin + (j.end - j.begin) / 2;
+        Job child = allocate();
+        JobData& c = _jobs[child];
+        c.function = j.function;
+        c.data = j.data;
+        c.begin = middle;
+        c.end = j.end;
+        c.grain = j.grain;
+        c.parent = job;
+        c.continuation = NoJob;
+        c.nextContinuation = NoJob;
+        c.allocationScope = j.allocationScope;
+        c.unfinished.storeRelease(1);
+
+        j.unfinished.fetchAndAddOrdered(1);
+        j.end = middle;
+        push(worker, child);
+    }
+
+    int charged = AllocationTracker::chargeTo(j.allocationScope);
+    j.function(j.data, j.begin, j.end);
+    AllocationTracker::chargeTo(charged);
+    finish(worker, job);
+}
+
+// A job is done once it and every piece split off of it are done. Its parent
+// (if any) is then one piece closer, and its continuations are released.
+void JobSystem::finish(int worker, Job job)
+{
+    while (job != NoJob)
+    {
+        JobData& j = _jobs[job];
+        Job parent = j.parent;
+        Job continuation;
+
+        if (j.unfinished.fetchAndAddOrdered(-1) != 1) return;
+
+        _continuationMutex.lock();
+        continuation = j.continuation;
+        j.continuation = NoJob;
+        _continuationMutex.unlock();
+
+        while (continuation != NoJob)
+        {
+            Job next = _jobs[continuation].nextContinuation;
+            push(worker, continuation);
+            continuation = next;
+        }
+
+        if (parent == NoJob && _waiting.loadAcquire() > 0)
+        {
+            QMutexLocker locker(&_waitMutex);
+            _finished.wakeAll();
+        }
+
+        job = parent;
+    }
+}
+
+void JobSystem::work(int worker)
+{
+    for (;;)
+    {
+        Job job = take(worker);
+
+        if (job != NoJob)
+        {
+            execute(worker, job);
+            continue;
+        }
+
+        QMutexLocker locker(&_sleepMutex);
+
+        if (_isQuitting) return;
+
+        _sleeping.fetchAndAddOrdered(1);
+
+        if (_queued.loadAcquire() == 0)
+            _sleep.wait(&_sleepMutex);
+
+        _sleeping.fetchAndAddOrdered(-1);
+    }
+}
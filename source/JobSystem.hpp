@@ -0,0 +1,119 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include "AllocationTracker.hpp"
+#include <QAtomicInt>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+// A work-stealing scheduler. Each thread owns a deque of jobs: it pushes and
+// pops at the back, while idle threads steal from the front of the others.
+// Range jobs split themselves in half until they reach their grain size, and
+// the right halves are pushed where other threads can steal them.
+//
+// The thread that creates the system takes part as worker 0 whenever it
+// waits, and sleeps only once there is nothing left for it to take. The Qt
+// event loop is never involved. Jobs come from a fixed table allocated up
+// front; running out of it (more than capacity jobs, counting the pieces a
+// range is split into, unfinished at once) is fatal.
+class JobSystem
+{
+public:
+    typedef void (*Function)(void* data, int begin, int end);
+    typedef int Job;
+
+    static const Job NoJob = -1;
+
+    // A thread count of zero means one thread per core.
+    explicit JobSystem(int threadCount = 0, int capacity = 4096);
+    ~JobSystem();
+
+    inline int threadCount() const { return _queues.size(); }
+
+    // Runs function over [begin, end) in pieces of at most grain items. The
+    // job does not start until dependency (if any) has finished.
+    Job add(Function function, void* data, int begin, int end, int grain = 1,
+        Job dependency = NoJob);
+    bool isFinished(Job job) const;
+
+    // Works on pending jobs until the given job is finished, then sleeps
+    // until the pieces other threads took are done as well.
+    void wait(Job job);
+
+    // The functor is called as functor(begin, end) for each piece.
+    template<class Functor>
+    void parallelFor(int begin, int end, int grain, Functor& functor)
+    {
+        wait(add(&invoke<Functor>, &functor, begin, end, grain));
+    }
+
+private:
+    class JobData
+    {
+    public:
+        Function function;
+        void* data;
+        int begin;
+        int end;
+        int grain;
+        Job parent;
+        Job continuation;
+        Job nextContinuation;
+        int allocationScope;
+        QAtomicInt unfinished;
+    };
+
+    class Queue
+    {
+    public:
+        QMutex mutex;
+        QVector<Job> jobs;
+        int head;
+        int count;
+    };
+
+    class Worker : public QThread
+    {
+    public:
+        Worker(JobSystem& system, int index);
+
+    protected:
+        virtual void run();
+
+    private:
+        JobSystem& _system;
+        int _index;
+    };
+
+    template<class Functor>
+    static void invoke(void* data, int begin, int end)
+    {
+        (*static_cast<Functor*>(data))(begin, end);
+    }
+
+    Job allocate();
+    void push(int worker, Job job);
+    Job take(int worker);
+    void execute(int worker, Job job);
+    void finish(int worker, Job job);
+    void work(int worker);
+
+    JobData* _jobs;
+    int _capacity;
+    QAtomicInt _nextJob;
+    QAtomicInt _queued;
+    QAtomicInt _sleeping;
+    QVector<Queue*> _queues;
+    QVector<Worker*> _workers;
+    QMutex _continuationMutex;
+    QMutex _sleepMutex;
+    QWaitCondition _sleep;
+    QAtomicInt _waiting;
+    QMutex _waitMutex;
+    QWaitCondition _finished;
+    bool _isQuitting;
+};
+
+#endif
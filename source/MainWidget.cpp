@@ -1,28 +1,71 @@
 #include "MainWidget.hpp"
+#include "AllocationTracker.hpp"
+#include <QCoreApplication>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QMouseEvent>
 #include <QTimer>
-#include <QPainter>
 #include <QVector2D>
 
-MainWidget::MainWidget(QWidget* parent) : QGLWidget(parent)
+// Each card's transform depends only on the card and the camera, so any
+// split of the cards across threads gives the same result.
+class CardActorUpdater
 {
+public:
+    CardActorUpdater(CardActor* cardActors, const QMatrix4x4& matrix,
+        float alpha)
+        : _cardActors(cardActors), _matrix(matrix), _alpha(alpha)
+    {
+    }
+
+    void operator()(int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+            _cardActors[i].update(_matrix, _alpha);
+    }
+
+private:
+    CardActor* _cardActors;
+    const QMatrix4x4& _matrix;
+    float _alpha;
+};
+
+MainWidget::MainWidget(QWidget* parent, MainWidget* shareWidget)
+    : QGLWidget(parent, shareWidget)
+{
+    if (shareWidget && isSharing())
+        _resources = shareWidget->_resources;
+    else
+        _resources = QSharedPointer<TableResources>(new TableResources);
+
     _program = 0;
     _cardBuffer = 0;
     _tableBuffer = 0;
+    _textProgram = 0;
+    _textures = 0;
+    _textBuffer = 0;
+    _pixelScale = 1.0f;
     _isCameraMoving = false;
+    _frameCount = 0;
+    _resourceFrame = -1;
+    _hasReportedAllocations = false;
     _camera.distance(12.0f);
 }
 
+// The shared resources may be destroyed along with this view, so its context
+// has to be current.
 MainWidget::~MainWidget()
 {
-    _program->release();
+    makeCurrent();
+
+    if (_program) _program->release();
+
+    delete _textBuffer;
 
-    deleteTexture(_frontTexture);
-    deleteTexture(_backTexture);
-    delete _tableBuffer;
-    delete _cardBuffer;
-    delete _program;
+    for (int i = 0; i < ActorCount; ++i)
+        _faceTextures[i] = TextureManager::Handle();
+
+    _resources.clear();
 }
 
 void MainWidget::initializeGL()
@@ -31,29 +74,61 @@ void MainWidget::initializeGL()
 
     QTimer* timer = new QTimer(this);
     connect(timer, SIGNAL(timeout()), this, SLOT(onTimer()));
-    timer->start(25);
+    // Simulation runs at a fixed rate no matter how often this fires, so the
+    // interval only caps the frame rate.
+    timer->start(4);
+
+    _resources->initialize(ActorCount);
+    _program = &_resources->program();
+    _cardBuffer = &_resources->cardBuffer();
+    _tableBuffer = &_resources->tableBuffer();
+    _textProgram = &_resources->textProgram();
+    _textures = &_resources->textures();
+    _textBuffer = new TextBuffer(_resources->glyphAtlas());
 
-    _program = new MainProgram;
+    for (int i = 0; i < ActorCount; ++i)
+    {
+        CardFace face;
+        face.art = "../localuprising.gif";
+        face.title = QString("Card %1").arg(i + 1);
+        face.text = "When this card enters play, draw a card. "
+            "Discard a card at the end of your turn.";
+        CardCompositor& compositor = _resources->compositor();
+        _faceTextures[i] = compositor.face(face, compositor.key(face));
+
+        _cardActors[i].topTexture(_resources->frontTexture());
+        _cardActors[i].bottomTexture(_resources->backTexture());
+        _cardActors[i].position(QVector3D(0.0f, -10.0f, i * 0.05f));
+        _cardActors[i].flip(Rotation::fromDegrees(180.0f));
+        //_cardActors[i].highlight(QVector4D(0.0f, 0.3f, 0.2f, 0.0f));
+    }
 
-    _tableTexture = loadImage(QImage("../wood.jpg"));
-    _frontTexture = loadImage(QImage("../localuprising.gif"));
-    _backTexture = loadImage(QImage("../liberation.gif"));
+    // Deal the deck out from a face down pile.
+    QVector<CardState> dealt(ActorCount);
 
     for (int i = 0; i < ActorCount; ++i)
     {
-        _cardActors[i].topTexture(_frontTexture);
-        _cardActors[i].bottomTexture(_backTexture);
-        _cardActors[i].position(QVector3D(0.0f, i, i + 3));
-        _cardActors[i].rotation(Rotation::fromDegrees(45.0f));
-        _cardActors[i].flip(Rotation::fromDegrees(45.0f));
-        //_cardActors[i].highlight(QVector4D(0.0f, 0.3f, 0.2f, 0.0f));
+        dealt[i].position = QVector3D(0.0f, i, i + 3);
+        dealt[i].rotation = Rotation::fromDegrees(45.0f);
+        dealt[i].flip = Rotation::fromDegrees(45.0f);
+
+        float delay = float(ActorCount - 1 - i) * 0.02f;
+        int moved = _tweener.moveCard(_cardActors[i], dealt[i].position,
+            0.5f, Tweener::EaseOut, delay);
+        _tweener.flipCard(_cardActors[i], dealt[i].flip, 0.3f,
+            Tweener::EaseInOut, 0.0f, moved);
+        _tweener.rotateCard(_cardActors[i], dealt[i].rotation, 0.3f,
+            Tweener::EaseInOut, 0.0f, moved);
     }
 
-    CardSpecifications specifications;
-    //specifications.depth(1.0f);
-    CardBuilder builder(specifications);
-    _cardBuffer = new CardBuffer(builder);
-    _tableBuffer = new TableBuffer;
+    _history.reset(dealt);
+
+    _camera.snapshot();
+
+    for (int i = 0; i < ActorCount; ++i)
+        _cardActors[i].snapshot();
+
+    _clock.start();
 
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
@@ -71,6 +146,8 @@ void MainWidget::resizeGL(int w, int h)
     _projectionMatrix.perspective(60.0f, ratio, 1.0f, 1000.0f);
     glViewport(0, 0, w, h);
     glGetIntegerv(GL_VIEWPORT, _viewport);
+    _pixelScale = float(h) * 0.5f * _projectionMatrix(1, 1);
+    updateInverseMatrix();
 }
 
 void MainWidget::paintGL()
@@ -80,10 +157,14 @@ void MainWidget::paintGL()
     _cardBuffer->bind(_program->positionAttribute(),
         _program->textureAttribute());
 
+    GLuint frontTexture = _resources->frontTexture();
+    GLuint backTexture = _resources->backTexture();
+
     for (int i = 0; i < ActorCount; ++i)
     {
-        _program->setMatrix(_projectionMatrix
-           * _cardActors[i].modelViewMatrix());
+        QMatrix4x4 matrix = _projectionMatrix
+            * _cardActors[i].modelViewMatrix();
+        _program->setMatrix(matrix);
         _program->setHighlight(_cardActors[i].highlight());
         _program->enableTexture(false);
         _cardBuffer->drawMiddle();
@@ -91,11 +172,14 @@ void MainWidget::paintGL()
 
         if (_cardActors[i].isTopVisible())
         {
+            _cardActors[i].topTexture(_textures->texture(_faceTextures[i],
+                facePriority(matrix), frontTexture, faceSize(matrix)));
             glBindTexture(GL_TEXTURE_2D, _cardActors[i].topTexture());
             _cardBuffer->drawTop();
         }
         else
         {
+            _cardActors[i].bottomTexture(backTexture);
             glBindTexture(GL_TEXTURE_2D, _cardActors[i].bottomTexture());
             _cardBuffer->drawBottom();
         }
@@ -103,10 +187,18 @@ void MainWidget::paintGL()
 
     _program->setMatrix(_projectionMatrix * _camera.matrix());
     _program->setHighlight(QVector4D());
-    glBindTexture(GL_TEXTURE_2D, _tableTexture);
+    glBindTexture(GL_TEXTURE_2D, _resources->tableTexture());
     _tableBuffer->bind(_program->positionAttribute(),
         _program->textureAttribute());
     _tableBuffer->draw();
+
+    drawLabels();
+
+    // Whatever finished loading since the last frame goes up now, within a
+    // quarter of a 60 Hz frame.
+    _resources->update(4, _resourceFrame);
+
+    if (AllocationTracker::isEnabled()) drawAllocationOverlay();
 }
 
 void MainWidget::mousePressEvent(QMouseEvent* event)
@@ -119,8 +211,50 @@ void MainWidget::mousePressEvent(QMouseEvent* event)
     }
     else if (event->button() == Qt::LeftButton)
     {
-        QVector3D result = unproject(event->x(), event->y());
-        qDebug() << result;
+        int card;
+        QVector3D point;
+
+        if (_picker.pick(unproject(event->x(), event->y(), -1.0f),
+            unproject(event->x(), event->y(), 1.0f), card, point))
+        {
+            qDebug() << card << point;
+
+            if (card != Picker::NoCard)
+            {
+                CardState state = _history.state(card);
+                state.flip += Rotation::fromDegrees(180.0f);
+                _history.change(card, state);
+                _history.commit();
+                restore(card);
+            }
+        }
+    }
+}
+
+void MainWidget::reportTextures()
+{
+    qDebug() << qPrintable(_textures->report());
+}
+
+void MainWidget::undo()
+{
+    QVector<int> changedCards;
+
+    if (_history.undo(changedCards))
+    {
+        for (int i = 0; i < changedCards.size(); ++i)
+            restore(changedCards[i]);
+    }
+}
+
+void MainWidget::redo()
+{
+    QVector<int> changedCards;
+
+    if (_history.redo(changedCards))
+    {
+        for (int i = 0; i < changedCards.size(); ++i)
+            restore(changedCards[i]);
     }
 }
 
@@ -153,57 +287,241 @@ void MainWidget::wheelEvent(QWheelEvent* event)
 
 void MainWidget::onTimer()
 {
-    _camera.update();
+    AllocationTracker::beginFrame();
+
+    int steps = _clock.advance();
+
+    {
+        AllocationScope scope("simulation");
+
+        for (int i = 0; i < steps; ++i)
+        {
+            simulate();
+            _clock.tick();
+        }
+    }
+
+    // Render partway between the last two simulation steps.
+    float alpha = _clock.alpha();
+
+    {
+        AllocationScope scope("cards");
+        _camera.update(alpha);
+        updateCardActors(_jobs, alpha);
+        updateInverseMatrix();
+    }
+
+    if (steps > 0)
+    {
+        AllocationScope scope("picker");
+        _picker.build(_cardActors, ActorCount,
+            _cardBuffer->specifications());
+    }
 
-    for (int i = 0; i < ActorCount; ++i)
     {
-        _cardActors[i].update(_camera.matrix());
+        AllocationScope scope("render");
+        updateGL();
     }
 
-    updateGL();
+    AllocationTracker::endFrame();
+    checkAllocations();
 }
 
-GLuint MainWidget::loadImage(const QImage& image)
+void MainWidget::simulate()
 {
-    GLuint result = 0;
+    _camera.snapshot();
 
-    if (image.width() > 0 && image.height() > 0)
-    {
-        int width = 1;
-        int height = 1;
+    for (int i = 0; i < ActorCount; ++i)
+        _cardActors[i].snapshot();
 
-        while (width < image.width()) width *= 2;
-        while (height < image.height()) height *= 2;
+    _tweener.update(_clock.time() + _clock.step());
+}
 
-        QImage square(width, height, image.format());
-        QPainter painter(&square);
-        painter.drawImage(QRect(0, 0, square.width(), square.height()), image);
-        result = bindTexture(square);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
+// Cards on screen come before cards off it, and nearer (larger) cards come
+// before farther ones. The card's center in clip space is the last column of
+// its matrix, and w grows with distance from the camera.
+float MainWidget::facePriority(const QMatrix4x4& matrix) const
+{
+    QVector4D center = matrix.column(3);
+
+    if (center.w() <= 0.0f) return 0.0f;
 
-    return result;
+    float size = qMin(1.0f / center.w(), 1.0f);
+    bool isOnScreen = qAbs(center.x()) <= center.w()
+        && qAbs(center.y()) <= center.w();
+
+    return isOnScreen ? 1.0f + size : size;
 }
 
-QVector3D MainWidget::unproject(int x, int y)
+// How many pixels tall the card appears, near enough: its height over its
+// distance, scaled by the pixels a unit covers at a distance of one.
+float MainWidget::faceSize(const QMatrix4x4& matrix) const
 {
-    y = height() - y;
+    float w = matrix(3, 3);
 
-    GLfloat depthSample;
-    glReadPixels(x, y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depthSample);
+    if (w <= 0.0f) return 0.0f;
+
+    return _cardBuffer->specifications().height() * _pixelScale / w;
+}
+
+// Depth is given in normalized device coordinates (-1 is the near plane and
+// 1 is the far plane), so nothing has to be read back from the GPU.
+QVector3D MainWidget::unproject(int x, int y, float depth) const
+{
+    y = height() - y;
 
     QVector4D v;
     v.setX(float(x - _viewport[0]) * 2.0f / float(_viewport[2]) - 1.0f);
     v.setY(float(y - _viewport[1]) * 2.0f / float(_viewport[3]) - 1.0f);
-    v.setZ(2.0f * depthSample - 1.0f);
+    v.setZ(depth);
     v.setW(1.0f);
 
-    QMatrix4x4 modelViewProjectionMatrix = _projectionMatrix
-        * _camera.matrix();
-    QMatrix4x4 inverse = modelViewProjectionMatrix.inverted();
-    return (inverse * v).toVector3DAffine();
+    return (_inverseMatrix * v).toVector3DAffine();
+}
+
+void MainWidget::updateInverseMatrix()
+{
+    _inverseMatrix = (_projectionMatrix * _camera.matrix()).inverted();
+}
+
+// Once things have settled down, a frame should not allocate at all. The
+// first offender is reported along with the sites that allocated the most,
+// and running with --allocation-free turns it into a hard failure.
+void MainWidget::checkAllocations()
+{
+    const int WarmUpFrames = 120;
+
+    if (!AllocationTracker::isEnabled() || _hasReportedAllocations) return;
+
+    if (_frameCount < WarmUpFrames)
+    {
+        // Startup allocations are not interesting; drop their samples.
+        if (++_frameCount == WarmUpFrames) AllocationTracker::report(0);
+        return;
+    }
+
+    if (AllocationTracker::lastFrame().allocations > 0)
+    {
+        _hasReportedAllocations = true;
+
+        AllocationTracker::pause();
+        qWarning("Steady-state frame made %d allocations (%d bytes)\n%s",
+            AllocationTracker::lastFrame().allocations,
+            AllocationTracker::lastFrame().bytes,
+            qPrintable(AllocationTracker::report()));
+
+        if (QCoreApplication::arguments().contains("--allocation-free"))
+            qFatal("Steady-state frames must not allocate");
+
+        AllocationTracker::resume();
+    }
 }
 
+// Labels are laid out in view space, so they face the camera, and they go
+// out in one draw after everything opaque.
+void MainWidget::drawLabels()
+{
+    const CardSpecifications& specifications = _cardBuffer->specifications();
+    QVector3D corner(specifications.width() * 0.4f,
+        specifications.height() * 0.4f, specifications.depth());
+    QVector4D textColor(1.0f, 1.0f, 1.0f, 1.0f);
+    QVector4D badgeColor(0.6f, 0.1f, 0.1f, 0.9f);
+
+    _textBuffer->clear();
+
+    for (int i = 0; i < ActorCount; ++i)
+    {
+        QVector3D position = _cardActors[i].modelViewMatrix() * corner;
+        position.setZ(position.z() + 0.1f);
+        _textBuffer->addBadge(position, i + 1, 0.8f, textColor, badgeColor);
+    }
+
+    _program->release();
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+
+    _textProgram->bind();
+    _textProgram->setMatrix(_projectionMatrix);
+    _textProgram->setPixelScale(_pixelScale);
+    _textBuffer->draw(*_textProgram);
+    _textProgram->release();
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glEnable(GL_CULL_FACE);
+    _program->bind();
+}
+
+void MainWidget::drawAllocationOverlay()
+{
+    AllocationTracker::pause();
+    _program->release();
+    glDisable(GL_DEPTH_TEST);
+
+    const AllocationTracker::Statistics& total =
+        AllocationTracker::lastFrame();
+    renderText(10, 20, QString("frame: %1 allocations, %2 bytes")
+        .arg(total.allocations).arg(total.bytes));
+
+    for (int i = 0; i < AllocationTracker::scopeCount(); ++i)
+    {
+        const AllocationTracker::Statistics& s =
+            AllocationTracker::lastFrame(i);
+        renderText(10, 36 + i * 16, QString("%1: %2 allocations, %3 bytes")
+            .arg(AllocationTracker::scopeName(i)).arg(s.allocations)
+            .arg(s.bytes));
+    }
+
+    glEnable(GL_DEPTH_TEST);
+    _program->bind();
+    AllocationTracker::resume();
+}
+
+// Cards glide to the state the history has for them rather than jumping.
+void MainWidget::restore(int card)
+{
+    const CardState& state = _history.state(card);
+    _tweener.moveCard(_cardActors[card], state.position, 0.25f);
+    _tweener.rotateCard(_cardActors[card], state.rotation, 0.25f);
+    _tweener.flipCard(_cardActors[card], state.flip, 0.25f);
+}
+
+void MainWidget::reportHistory()
+{
+    qDebug() << "history step" << _history.currentStep() << "of"
+        << _history.stepCount() << "-" << _history.stepBytes(
+        _history.currentStep()) << "bytes in this step,"
+        << _history.totalBytes() << "bytes total";
+}
+
+void MainWidget::updateCardActors(JobSystem& jobs, float alpha)
+{
+    CardActorUpdater updater(_cardActors, _camera.matrix(), alpha);
+    jobs.parallelFor(0, ActorCount, 16, updater);
+}
+
+// Times the card update with every thread count from one up to the number of
+// cores.
 void MainWidget::dump()
 {
+    const int Rounds = 1000;
+    qint64 single = 0;
+
+    for (int i = 1; i <= _jobs.threadCount(); ++i)
+    {
+        JobSystem jobs(i);
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int j = 0; j < Rounds; ++j)
+            updateCardActors(jobs, 1.0f);
+
+        qint64 elapsed = timer.nsecsElapsed();
+        if (i == 1) single = elapsed;
+
+        qDebug() << i << "threads:" << elapsed / Rounds << "ns per update,"
+            << double(single) / double(elapsed) << "x";
+    }
 }
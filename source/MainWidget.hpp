@@ -3,25 +3,36 @@
 
 #include "Camera.hpp"
 #include "CardActor.hpp"
-#include "CardBuffer.hpp"
-#include "TableBuffer.hpp"
-#include "MainProgram.hpp"
+#include "TableResources.hpp"
+#include "TextBuffer.hpp"
+#include "Picker.hpp"
+#include "Tweener.hpp"
+#include "SimulationClock.hpp"
+#include "JobSystem.hpp"
+#include "TableHistory.hpp"
 #include <QWidget>
 #include <QGLWidget>
 #include <QOpenGLFunctions>
-#include <QImage>
+#include <QSharedPointer>
 
 const int ActorCount = 150;
 
+// A view of a table. Pass another view as shareWidget to have the two share
+// one set of GL resources; each view keeps its own camera, table state and
+// label buffer.
 class MainWidget : public QGLWidget, protected QOpenGLFunctions
 {
     Q_OBJECT
 
 public:
-    explicit MainWidget(QWidget* parent = 0);
+    explicit MainWidget(QWidget* parent = 0, MainWidget* shareWidget = 0);
     virtual ~MainWidget();
 
     void dump();
+    void undo();
+    void redo();
+    void reportTextures();
+    void reportHistory();
 
 protected slots:
     void onTimer();
@@ -37,23 +48,43 @@ protected:
     virtual void wheelEvent(QWheelEvent* event);
 
 private:
-    GLuint loadImage(const QImage& image);
-    QVector3D unproject(int x, int y);
+    QVector3D unproject(int x, int y, float depth) const;
+    float facePriority(const QMatrix4x4& matrix) const;
+    float faceSize(const QMatrix4x4& matrix) const;
+    void updateInverseMatrix();
+    void simulate();
+    void updateCardActors(JobSystem& jobs, float alpha);
+    void checkAllocations();
+    void drawLabels();
+    void restore(int card);
+    void drawAllocationOverlay();
 
+    QSharedPointer<TableResources> _resources;
     MainProgram* _program;
     CardBuffer* _cardBuffer;
     TableBuffer* _tableBuffer;
+    TextProgram* _textProgram;
+    TextureManager* _textures;
+    TextBuffer* _textBuffer;
+    float _pixelScale;
 
     CardActor _cardActors[ActorCount];
+    TextureManager::Handle _faceTextures[ActorCount];
     GLint _viewport[4];
     QMatrix4x4 _projectionMatrix;
-    GLuint _tableTexture;
-    GLuint _frontTexture;
-    GLuint _backTexture;
+    QMatrix4x4 _inverseMatrix;
+    Picker _picker;
+    Tweener _tweener;
+    TableHistory _history;
+    SimulationClock _clock;
+    JobSystem _jobs;
     Camera _camera;
     bool _isCameraMoving;
     int _mouseX;
     int _mouseY;
+    int _frameCount;
+    int _resourceFrame;
+    bool _hasReportedAllocations;
 };
 
 #endif
@@ -34,10 +34,37 @@ void MainWindow::keyPressEvent(QKeyEvent* event)
         close();
         break;
 
+    case Qt::Key_F2:
+        openView();
+        break;
+
     case Qt::Key_Space:
         _mainWidget->dump();
         break;
 
+    case Qt::Key_T:
+        _mainWidget->reportTextures();
+        break;
+
+    case Qt::Key_H:
+        _mainWidget->reportHistory();
+        break;
+
+    case Qt::Key_Z:
+        if (event->modifiers() & Qt::ControlModifier)
+        {
+            if (event->modifiers() & Qt::ShiftModifier)
+                _mainWidget->redo();
+            else
+                _mainWidget->undo();
+        }
+        break;
+
+    case Qt::Key_Y:
+        if (event->modifiers() & Qt::ControlModifier)
+            _mainWidget->redo();
+        break;
+
     default:
         break;
     }
@@ -59,3 +86,13 @@ void MainWindow::toggleFullscreen()
         showNormal();
     }
 }
+
+// Another view of a table, sharing every GL resource with the main one.
+void MainWindow::openView()
+{
+    MainWidget* view = new MainWidget(0, _mainWidget);
+    view->setAttribute(Qt::WA_DeleteOnClose);
+    view->setWindowTitle("DEJARIX View");
+    view->resize(640, 480);
+    view->show();
+}
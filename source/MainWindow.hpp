@@ -17,6 +17,7 @@ protected:
 
 private:
     void toggleFullscreen();
+    void openView();
 
     MainWidget* _mainWidget;
     bool _isFullscreen;
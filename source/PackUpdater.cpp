@@ -0,0 +1,398 @@
+#include "PackUpdater.hpp"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QSaveFile>
+#include <cstring>
+
+static const char Magic[8] = { 'D', 'J', 'X', 'M', 'A', 'N', 'I', '1' };
+static const quint32 Endianness = 0x04030201;
+static const int HashSize = 20;
+
+// Cuts come on average every 8 KiB past the minimum, and never further
+// apart than the maximum, so runs of padding still get cut.
+static const qint64 MinChunk = 2 * 1024;
+static const qint64 MaxChunk = 64 * 1024;
+static const quint64 Mask = Q_UINT64_C(0x1fff) << 51;
+
+// The gear hash adds a random word per byte and shifts one bit per byte, so
+// its top bits cover the last 64 bytes. The words only have to be the same
+// on every machine, not secret, so they come from a fixed seed.
+static quint64 Gear[256];
+
+class GearTable
+{
+public:
+    GearTable()
+    {
+        quint64 state = Q_UINT64_C(0x9e3779b97f4a7c15);
+
+        for (int i = 0; i < 256; ++i)
+        {
+            state += Q_UINT64_C(0x9e3779b97f4a7c15);
+            quint64 z = state;
+            z = (z ^ (z >> 30)) * Q_UINT64_C(0xbf58476d1ce4e5b9);
+            z = (z ^ (z >> 27)) * Q_UINT64_C(0x94d049bb133111eb);
+            Gear[i] = z ^ (z >> 31);
+        }
+    }
+};
+
+static GearTable gearTable;
+
+// Fed a slice at a time, since the pack may not fit in an int.
+static QByteArray sha1(const uchar* data, qint64 size)
+{
+    static const qint64 Slice = 1 << 20;
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    for (qint64 i = 0; i < size; i += Slice)
+    {
+        hash.addData(reinterpret_cast<const char*>(data) + i,
+            int(qMin(Slice, size - i)));
+    }
+
+    return hash.result();
+}
+
+template<typename T>
+static void appendValue(QByteArray& data, T value)
+{
+    data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+static bool readValue(const QByteArray& data, int& offset, T& value)
+{
+    if (offset + int(sizeof(value)) > data.size()) return false;
+
+    memcpy(&value, data.constData() + offset, sizeof(value));
+    offset += sizeof(value);
+    return true;
+}
+
+static QByteArray readFile(const QString& path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+PackUpdater::Manifest::Manifest() : size(0)
+{
+}
+
+QByteArray PackUpdater::Manifest::toByteArray() const
+{
+    QByteArray result(Magic, 8);
+    appendValue(result, Endianness);
+    appendValue(result, quint32(chunks.size()));
+    appendValue(result, size);
+    result.append(hash);
+
+    for (int i = 0; i < chunks.size(); ++i)
+    {
+        appendValue(result, quint32(chunks[i].size));
+        result.append(chunks[i].hash);
+    }
+
+    return result;
+}
+
+// Offsets are not stored; they follow from the sizes.
+bool PackUpdater::Manifest::parse(const QByteArray& data)
+{
+    chunks.clear();
+
+    int offset = 8;
+    quint32 endianness;
+    quint32 count;
+
+    if (!data.startsWith(QByteArray::fromRawData(Magic, 8))
+        || !readValue(data, offset, endianness) || endianness != Endianness
+        || !readValue(data, offset, count) || !readValue(data, offset, size)
+        || offset + HashSize > data.size())
+        return false;
+
+    hash = data.mid(offset, HashSize);
+    offset += HashSize;
+
+    if (qint64(count) * (4 + HashSize) != data.size() - offset) return false;
+
+    chunks.resize(count);
+    qint64 total = 0;
+
+    for (quint32 i = 0; i < count; ++i)
+    {
+        quint32 chunkSize;
+        readValue(data, offset, chunkSize);
+
+        Chunk& chunk = chunks[i];
+        chunk.offset = total;
+        chunk.size = chunkSize;
+        chunk.hash = data.mid(offset, HashSize);
+        offset += HashSize;
+        total += chunkSize;
+    }
+
+    return total == size;
+}
+
+PackUpdater::DirectorySource::DirectorySource(const QString& directory)
+    : _directory(directory)
+{
+}
+
+QByteArray PackUpdater::DirectorySource::manifest(const QString& version)
+{
+    return readFile(_directory + "/" + version + ".manifest");
+}
+
+QByteArray PackUpdater::DirectorySource::chunk(const QByteArray& hash)
+{
+    return readFile(_directory + "/chunks/" + QString::fromLatin1(
+        hash.toHex()));
+}
+
+PackUpdater::PackUpdater(Source& source) : _source(source)
+{
+    _statistics.packBytes = 0;
+    _statistics.fetchedBytes = 0;
+    _statistics.fetchedChunks = 0;
+    _statistics.reusedChunks = 0;
+    _statistics.writtenBytes = 0;
+    _statistics.isInPlace = false;
+    _statistics.milliseconds = 0;
+}
+
+PackUpdater::~PackUpdater()
+{
+}
+
+QString PackUpdater::report() const
+{
+    const Statistics& s = _statistics;
+
+    return QString("update: %1 of %2 KiB fetched in %3 chunks, %4 chunks "
+        "reused, %5 KiB written %6 in %7 ms")
+        .arg(s.fetchedBytes / 1024).arg(s.packBytes / 1024)
+        .arg(s.fetchedChunks).arg(s.reusedChunks)
+        .arg(s.writtenBytes / 1024)
+        .arg(s.isInPlace ? "in place" : "to a new pack")
+        .arg(s.milliseconds);
+}
+
+bool PackUpdater::update(const QString& path, const QString& version)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Statistics& s = _statistics;
+    s.packBytes = 0;
+    s.fetchedBytes = 0;
+    s.fetchedChunks = 0;
+    s.reusedChunks = 0;
+    s.writtenBytes = 0;
+    s.isInPlace = true;
+
+    QByteArray data = _source.manifest(version);
+    Manifest target;
+
+    if (!target.parse(data)) return false;
+
+    s.packBytes = target.size;
+    s.fetchedBytes += data.size();
+
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadWrite)) return false;
+
+    qint64 size = file.size();
+    uchar* old = size > 0 ? file.map(0, size) : 0;
+
+    if (size > 0 && !old) return false;
+
+    Manifest current = cut(old, size);
+    QHash<QByteArray, qint64> offsetsByHash;
+    QHash<qint64, int> chunksByOffset;
+
+    for (int i = 0; i < current.chunks.size(); ++i)
+    {
+        const Chunk& c = current.chunks[i];
+        offsetsByHash.insert(c.hash, c.offset);
+        chunksByOffset.insert(c.offset, i);
+    }
+
+    // Everything missing is fetched and checked before anything is written.
+    QVector<QByteArray> chunks(target.chunks.size());
+
+    for (int i = 0; i < target.chunks.size(); ++i)
+    {
+        const Chunk& c = target.chunks[i];
+
+        if (offsetsByHash.contains(c.hash))
+        {
+            QHash<qint64, int>::ConstIterator j =
+                chunksByOffset.constFind(c.offset);
+
+            if (j == chunksByOffset.constEnd()
+                || current.chunks[j.value()].hash != c.hash)
+                s.isInPlace = false;
+
+            ++s.reusedChunks;
+            continue;
+        }
+
+        chunks[i] = _source.chunk(c.hash);
+
+        if (chunks[i].size() != c.size
+            || sha1(reinterpret_cast<const uchar*>(chunks[i].constData()),
+            c.size) != c.hash)
+        {
+            qWarning("Chunk %s of pack version %s is missing or damaged",
+                c.hash.toHex().constData(), qPrintable(version));
+            return false;
+        }
+
+        s.fetchedBytes += c.size;
+        ++s.fetchedChunks;
+    }
+
+    bool isValid;
+
+    if (s.isInPlace)
+    {
+        if (old) file.unmap(old);
+
+        if (target.size != size && !file.resize(target.size)) return false;
+
+        uchar* pack = target.size > 0 ? file.map(0, target.size) : 0;
+
+        if (target.size > 0 && !pack) return false;
+
+        isValid = patch(pack, target, chunks);
+
+        if (pack) file.unmap(pack);
+    }
+    else
+    {
+        // Moved chunks could be overwritten before they were copied, so the
+        // new version is put together in a file of its own.
+        QSaveFile save(path);
+
+        if (!save.open(QIODevice::WriteOnly)) return false;
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+
+        for (int i = 0; i < target.chunks.size(); ++i)
+        {
+            const Chunk& c = target.chunks[i];
+            const char* bytes = chunks[i].isEmpty()
+                ? reinterpret_cast<const char*>(old)
+                    + offsetsByHash.value(c.hash)
+                : chunks[i].constData();
+
+            hash.addData(bytes, c.size);
+            save.write(bytes, c.size);
+            s.writtenBytes += c.size;
+        }
+
+        file.close();
+        isValid = hash.result() == target.hash && save.commit();
+    }
+
+    s.milliseconds = timer.elapsed();
+    return isValid;
+}
+
+PackUpdater::Manifest PackUpdater::cut(const uchar* data, qint64 size)
+{
+    Manifest result;
+    result.size = size;
+    result.hash = sha1(data, size);
+
+    qint64 start = 0;
+
+    while (start < size)
+    {
+        qint64 end = qMin(start + MaxChunk, size);
+        quint64 rolling = 0;
+
+        for (qint64 i = qMin(start + MinChunk, end); i < end; ++i)
+        {
+            rolling = (rolling << 1) + Gear[data[i]];
+
+            if (!(rolling & Mask))
+            {
+                end = i + 1;
+                break;
+            }
+        }
+
+        Chunk chunk;
+        chunk.offset = start;
+        chunk.size = int(end - start);
+        chunk.hash = sha1(data + start, chunk.size);
+        result.chunks.append(chunk);
+        start = end;
+    }
+
+    return result;
+}
+
+bool PackUpdater::publish(const QString& path, const QString& directory,
+    const QString& version)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    qint64 size = file.size();
+    const uchar* data = size > 0 ? file.map(0, size) : 0;
+
+    if (size > 0 && !data) return false;
+
+    Manifest manifest = cut(data, size);
+    QDir().mkpath(directory + "/chunks");
+
+    for (int i = 0; i < manifest.chunks.size(); ++i)
+    {
+        const Chunk& c = manifest.chunks[i];
+        QString name = directory + "/chunks/"
+            + QString::fromLatin1(c.hash.toHex());
+
+        if (QFile::exists(name)) continue;
+
+        QSaveFile chunk(name);
+
+        if (!chunk.open(QIODevice::WriteOnly)) return false;
+
+        chunk.write(reinterpret_cast<const char*>(data) + c.offset, c.size);
+
+        if (!chunk.commit()) return false;
+    }
+
+    QSaveFile save(directory + "/" + version + ".manifest");
+
+    if (!save.open(QIODevice::WriteOnly)) return false;
+
+    save.write(manifest.toByteArray());
+    return save.commit();
+}
+
+// Only fetched chunks are written; the rest are already where they belong.
+bool PackUpdater::patch(uchar* data, const Manifest& target,
+    const QVector<QByteArray>& chunks)
+{
+    for (int i = 0; i < target.chunks.size(); ++i)
+    {
+        if (chunks[i].isEmpty()) continue;
+
+        const Chunk& c = target.chunks[i];
+        memcpy(data + c.offset, chunks[i].constData(), c.size);
+        _statistics.writtenBytes += c.size;
+    }
+
+    return sha1(data, target.size) == target.hash;
+}
@@ -0,0 +1,108 @@
+#ifndef PACKUPDATER_HPP
+#define PACKUPDATER_HPP
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Brings a card pack up to a newer version by fetching only what changed.
+// Every version of a pack is cut into chunks wherever a rolling hash of the
+// last 64 bytes hits a pattern, so the cuts follow the content: an edit only
+// changes the chunks it touches, even when it moves everything after it. A
+// version is published as a manifest (the list of its chunks' hashes) plus
+// the chunks themselves.
+//
+// The local pack is cut the same way, and whatever chunks the new version
+// shares with it are not fetched. When none of them has moved, the pack is
+// patched in place through a writable mapping and only the fetched chunks
+// are written. Otherwise a new pack is put together beside the old one from
+// both and swapped in. Either way, every chunk is fetched and checked before
+// the pack is touched, and the result is checked against the manifest; an
+// interrupted patch is repaired by updating again.
+//
+// Update before the pack is opened for reading, since patching in place
+// changes pages that readers may have mapped.
+class PackUpdater
+{
+public:
+    class Chunk
+    {
+    public:
+        qint64 offset;
+        int size;
+        QByteArray hash;
+    };
+
+    class Manifest
+    {
+    public:
+        Manifest();
+
+        QByteArray toByteArray() const;
+        bool parse(const QByteArray& data);
+
+        qint64 size;
+        QByteArray hash;
+        QVector<Chunk> chunks;
+    };
+
+    // Where published versions come from. Both functions return an empty
+    // array if what was asked for is not there.
+    class Source
+    {
+    public:
+        virtual ~Source() {}
+        virtual QByteArray manifest(const QString& version) = 0;
+        virtual QByteArray chunk(const QByteArray& hash) = 0;
+    };
+
+    // Serves versions published to a local directory, as publish() lays them
+    // out: one manifest per version, and chunks by hash, shared by them all.
+    class DirectorySource : public Source
+    {
+    public:
+        DirectorySource(const QString& directory);
+
+        virtual QByteArray manifest(const QString& version);
+        virtual QByteArray chunk(const QByteArray& hash);
+
+    private:
+        QString _directory;
+    };
+
+    class Statistics
+    {
+    public:
+        qint64 packBytes;
+        qint64 fetchedBytes;
+        int fetchedChunks;
+        int reusedChunks;
+        qint64 writtenBytes;
+        bool isInPlace;
+        qint64 milliseconds;
+    };
+
+    PackUpdater(Source& source);
+    ~PackUpdater();
+
+    inline const Statistics& statistics() const { return _statistics; }
+    QString report() const;
+
+    bool update(const QString& path, const QString& version);
+
+    static Manifest cut(const uchar* data, qint64 size);
+
+    // Adds a version of the pack to a directory a DirectorySource can serve.
+    // Chunks already there from earlier versions are left alone.
+    static bool publish(const QString& path, const QString& directory,
+        const QString& version);
+
+private:
+    bool patch(uchar* data, const Manifest& target,
+        const QVector<QByteArray>& chunks);
+
+    Source& _source;
+    Statistics _statistics;
+};
+
+#endif
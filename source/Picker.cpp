@@ -0,0 +1,295 @@
+#include "Picker.hpp"
+#include <algorithm>
+#include <cfloat>
+
+static const int LeafSize = 4;
+static const float TableExtent = 500.0f;
+
+// A huge (rather than infinite) reciprocal keeps the slab test free of NaNs
+// when the ray runs parallel to an axis.
+static inline float reciprocal(float value)
+{
+    return value != 0.0f ? 1.0f / value : 1e30f;
+}
+
+class CenterLess
+{
+public:
+    CenterLess(const float* centers, int axis)
+        : _centers(centers), _axis(axis)
+    {
+    }
+
+    inline bool operator()(int a, int b) const
+    {
+        return _centers[a * 3 + _axis] < _centers[b * 3 + _axis];
+    }
+
+private:
+    const float* _centers;
+    int _axis;
+};
+
+Picker::Picker()
+{
+    _extents[0] = 0.0f;
+    _extents[1] = 0.0f;
+    _extents[2] = 0.0f;
+}
+
+Picker::~Picker()
+{
+}
+
+void Picker::build(const CardActor* cardActors, int count,
+    const CardSpecifications& specifications)
+{
+    _extents[0] = specifications.width() / 2.0f;
+    _extents[1] = specifications.height() / 2.0f;
+    _extents[2] = specifications.depth() / 2.0f;
+
+    _inverses.resize(count);
+    _bounds.resize(count * 6);
+    _centers.resize(count * 3);
+    _order.resize(count);
+    // A reserved QVector keeps its capacity when emptied, so rebuilding every
+    // frame does not reallocate. A median split never needs more than 2n nodes.
+    _nodes.reserve(count * 2);
+    _nodes.resize(0);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const CardActor& actor = cardActors[i];
+
+        QMatrix4x4 local;
+        local.translate(actor.position());
+        local.rotate(actor.rotation().toDegrees(), 0.0f, 0.0f, 1.0f);
+        local.rotate(actor.flip().toDegrees(), 0.0f, 1.0f, 0.0f);
+
+        // The local matrix is rigid, so its inverse is just the reverse
+        // sequence of opposite transformations.
+        QMatrix4x4& inverse = _inverses[i];
+        inverse.setToIdentity();
+        inverse.rotate(-actor.flip().toDegrees(), 0.0f, 1.0f, 0.0f);
+        inverse.rotate(-actor.rotation().toDegrees(), 0.0f, 0.0f, 1.0f);
+        inverse.translate(-actor.position());
+
+        float* bounds = _bounds.data() + i * 6;
+        bounds[0] = bounds[1] = bounds[2] = FLT_MAX;
+        bounds[3] = bounds[4] = bounds[5] = -FLT_MAX;
+
+        for (int j = 0; j < 8; ++j)
+        {
+            QVector3D corner(j & 1 ? _extents[0] : -_extents[0],
+                j & 2 ? _extents[1] : -_extents[1],
+                j & 4 ? _extents[2] : -_extents[2]);
+            QVector3D transformed = local * corner;
+            float p[3] = { transformed.x(), transformed.y(),
+                transformed.z() };
+
+            for (int k = 0; k < 3; ++k)
+            {
+                bounds[k] = qMin(bounds[k], p[k]);
+                bounds[k + 3] = qMax(bounds[k + 3], p[k]);
+            }
+        }
+
+        for (int k = 0; k < 3; ++k)
+            _centers[i * 3 + k] = (bounds[k] + bounds[k + 3]) * 0.5f;
+
+        _order[i] = i;
+    }
+
+    if (count > 0) buildNode(0, count);
+}
+
+bool Picker::pick(const QVector3D& nearPoint, const QVector3D& farPoint,
+    int& card, QVector3D& point) const
+{
+    QVector3D direction = farPoint - nearPoint;
+    float origin[3] = { nearPoint.x(), nearPoint.y(), nearPoint.z() };
+    float inverseDirection[3] = { reciprocal(direction.x()),
+        reciprocal(direction.y()), reciprocal(direction.z()) };
+
+    float nearest = 1.0f;
+    card = NoCard;
+
+    if (!_nodes.isEmpty())
+    {
+        int stack[64];
+        int depth = 0;
+        stack[depth++] = 0;
+
+        while (depth > 0)
+        {
+            const Node& node = _nodes[stack[--depth]];
+
+            if (!hitsBox(node.bounds, origin, inverseDirection, nearest))
+                continue;
+
+            if (node.count > 0)
+            {
+                for (int i = node.first; i < node.first + node.count; ++i)
+                {
+                    float t;
+                    int candidate = _order[i];
+
+                    if (hitsCard(candidate, nearPoint, farPoint, t)
+                        && t < nearest)
+                    {
+                        nearest = t;
+                        card = candidate;
+                    }
+                }
+            }
+            else if (depth + 2 <= 64)
+            {
+                stack[depth++] = node.right;
+                stack[depth++] = int(&node - _nodes.constData()) + 1;
+            }
+        }
+    }
+
+    if (card != NoCard)
+    {
+        point = nearPoint + direction * nearest;
+        return true;
+    }
+
+    // table plane at z = 0
+    if (direction.z() != 0.0f)
+    {
+        float t = -nearPoint.z() / direction.z();
+
+        if (t >= 0.0f && t <= 1.0f)
+        {
+            QVector3D p = nearPoint + direction * t;
+
+            if (qAbs(p.x()) <= TableExtent && qAbs(p.y()) <= TableExtent)
+            {
+                point = p;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Nodes are stored depth-first: a node's left child immediately follows it,
+// and its right child index is recorded explicitly.
+int Picker::buildNode(int first, int last)
+{
+    int index = _nodes.size();
+    _nodes.resize(index + 1);
+
+    float bounds[6] = { FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX,
+        -FLT_MAX };
+
+    for (int i = first; i < last; ++i)
+    {
+        const float* b = _bounds.constData() + _order[i] * 6;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            bounds[k] = qMin(bounds[k], b[k]);
+            bounds[k + 3] = qMax(bounds[k + 3], b[k + 3]);
+        }
+    }
+
+    for (int k = 0; k < 6; ++k)
+        _nodes[index].bounds[k] = bounds[k];
+
+    if (last - first <= LeafSize)
+    {
+        _nodes[index].first = first;
+        _nodes[index].count = last - first;
+        _nodes[index].right = 0;
+        return index;
+    }
+
+    int axis = 0;
+    float x = bounds[3] - bounds[0];
+    float y = bounds[4] - bounds[1];
+    float z = bounds[5] - bounds[2];
+
+    if (y > x && y > z)
+        axis = 1;
+    else if (z > x && z > y)
+        axis = 2;
+
+    int middle = (first + last) / 2;
+    int* order = _order.data();
+    std::nth_element(order + first, order + middle, order + last,
+        CenterLess(_centers.constData(), axis));
+
+    buildNode(first, middle);
+    int right = buildNode(middle, last);
+
+    _nodes[index].first = first;
+    _nodes[index].count = 0;
+    _nodes[index].right = right;
+    return index;
+}
+
+bool Picker::hitsBox(const float* bounds, const float* origin,
+    const float* inverseDirection, float nearest) const
+{
+    float tMin = 0.0f;
+    float tMax = nearest;
+
+    for (int k = 0; k < 3; ++k)
+    {
+        float t0 = (bounds[k] - origin[k]) * inverseDirection[k];
+        float t1 = (bounds[k + 3] - origin[k]) * inverseDirection[k];
+
+        if (t0 > t1) std::swap(t0, t1);
+
+        tMin = qMax(tMin, t0);
+        tMax = qMin(tMax, t1);
+
+        if (tMin > tMax) return false;
+    }
+
+    return true;
+}
+
+// The segment is moved into the card's local space, where the card is an
+// axis-aligned box centered on the origin.
+bool Picker::hitsCard(int card, const QVector3D& nearPoint,
+    const QVector3D& farPoint, float& t) const
+{
+    const QMatrix4x4& matrix = _inverses[card];
+    QVector3D localNear = matrix * nearPoint;
+    QVector3D localDirection = matrix * farPoint - localNear;
+
+    float origin[3] = { localNear.x(), localNear.y(), localNear.z() };
+    float direction[3] = { localDirection.x(), localDirection.y(),
+        localDirection.z() };
+
+    float tMin = 0.0f;
+    float tMax = 1.0f;
+
+    for (int k = 0; k < 3; ++k)
+    {
+        if (direction[k] == 0.0f)
+        {
+            if (qAbs(origin[k]) > _extents[k]) return false;
+            continue;
+        }
+
+        float inverseDirection = 1.0f / direction[k];
+        float t0 = (-_extents[k] - origin[k]) * inverseDirection;
+        float t1 = (_extents[k] - origin[k]) * inverseDirection;
+
+        if (t0 > t1) std::swap(t0, t1);
+
+        tMin = qMax(tMin, t0);
+        tMax = qMin(tMax, t1);
+
+        if (tMin > tMax) return false;
+    }
+
+    t = tMin;
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef PICKER_HPP
+#define PICKER_HPP
+
+#include "CardActor.hpp"
+#include "CardSpecifications.hpp"
+#include <QVector>
+#include <QVector3D>
+#include <QMatrix4x4>
+
+// Finds what lies under the mouse entirely on the CPU. A ray between two
+// unprojected points is tested against a bounding volume hierarchy over the
+// cards, then against each candidate's oriented box (so rotation and flip are
+// honored), and finally against the table plane.
+class Picker
+{
+public:
+    static const int NoCard = -1;
+
+    Picker();
+    ~Picker();
+
+    void build(const CardActor* cardActors, int count,
+        const CardSpecifications& specifications);
+
+    // Returns false if the ray hits nothing at all. Otherwise, card is the
+    // index of the nearest card hit (or NoCard if only the table was hit) and
+    // point is where the hit occurred in table space.
+    bool pick(const QVector3D& nearPoint, const QVector3D& farPoint,
+        int& card, QVector3D& point) const;
+
+private:
+    class Node
+    {
+    public:
+        float bounds[6];
+        int first;
+        int count;
+        int right;
+    };
+
+    int buildNode(int first, int last);
+    bool hitsBox(const float* bounds, const float* origin,
+        const float* inverseDirection, float nearest) const;
+    bool hitsCard(int card, const QVector3D& nearPoint,
+        const QVector3D& farPoint, float& t) const;
+
+    float _extents[3];
+    QVector<QMatrix4x4> _inverses;
+    QVector<float> _bounds;
+    QVector<float> _centers;
+    QVector<int> _order;
+    QVector<Node> _nodes;
+};
+
+#endif
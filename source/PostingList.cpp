@@ -0,0 +1,209 @@
+#include "PostingList.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define DEJARIX_USE_SSE
+#   include <emmintrin.h>
+#endif
+
+// Below this ratio of lengths, stepping through both lists four at a time
+// beats searching the longer one for each card of the shorter.
+static const int GallopRatio = 32;
+
+void PostingList::appendVarint(QByteArray& data, quint32 value)
+{
+    while (value >= 0x80)
+    {
+        data.append(char(value | 0x80));
+        value >>= 7;
+    }
+
+    data.append(char(value));
+}
+
+void PostingList::encode(const QVector<quint32>& cards,
+    const QVector<quint32>& weights, QByteArray& data)
+{
+    quint32 previous = 0;
+
+    for (int i = 0; i < cards.size(); ++i)
+    {
+        appendVarint(data, cards[i] - previous);
+        appendVarint(data, weights[i]);
+        previous = cards[i];
+    }
+}
+
+bool PostingList::decode(const uchar* data, const uchar* end, int count,
+    QVector<quint32>& cards, QVector<quint32>& weights)
+{
+    cards.resize(count);
+    weights.resize(count);
+
+    quint32 card = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        quint32 delta;
+
+        if (!readVarint(data, end, delta) || !readVarint(data, end, weights[i])
+            || (i > 0 && delta == 0))
+            return false;
+
+        card += delta;
+        cards[i] = card;
+    }
+
+    return true;
+}
+
+void PostingList::intersect(const QVector<quint32>& a,
+    const QVector<quint32>& b, QVector<quint32>& result)
+{
+    if (a.size() > b.size())
+    {
+        intersect(b, a, result);
+        return;
+    }
+
+    const quint32* x = a.constData();
+    const quint32* y = b.constData();
+    int xSize = a.size();
+    int ySize = b.size();
+    int i = 0;
+    int j = 0;
+    int count = 0;
+
+    result.resize(xSize);
+    quint32* out = result.data();
+
+    if (xSize * GallopRatio < ySize)
+    {
+        for (; i < xSize && j < ySize; ++i)
+        {
+            j = gallop(y, j, ySize, x[i]);
+
+            if (j < ySize && y[j] == x[i]) out[count++] = x[i];
+        }
+
+        result.resize(count);
+        return;
+    }
+
+#ifdef DEJARIX_USE_SSE
+    // Each card in a block of x is compared against all four rotations of
+    // the block of y. Whichever block ends lower cannot match anything past
+    // the other, so it is the one to move on from (or both, if they end on
+    // the same card).
+    while (i + 4 <= xSize && j + 4 <= ySize)
+    {
+        __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + j));
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(u, v),
+                _mm_cmpeq_epi32(u, _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(
+                _mm_cmpeq_epi32(u, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))),
+                _mm_cmpeq_epi32(u, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 1, 0, 3)))));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(m));
+
+        for (int k = 0; mask; ++k, mask >>= 1)
+        {
+            if (mask & 1) out[count++] = x[i + k];
+        }
+
+        quint32 xLast = x[i + 3];
+        quint32 yLast = y[j + 3];
+
+        if (xLast <= yLast) i += 4;
+        if (yLast <= xLast) j += 4;
+    }
+#endif
+
+    while (i < xSize && j < ySize)
+    {
+        if (x[i] < y[j])
+        {
+            ++i;
+        }
+        else if (y[j] < x[i])
+        {
+            ++j;
+        }
+        else
+        {
+            out[count++] = x[i];
+            ++i;
+            ++j;
+        }
+    }
+
+    result.resize(count);
+}
+
+void PostingList::unite(const QVector<quint32>& aCards,
+    const QVector<float>& aScores, const QVector<quint32>& bCards,
+    const QVector<float>& bScores, QVector<quint32>& cards,
+    QVector<float>& scores)
+{
+    int i = 0;
+    int j = 0;
+    int count = 0;
+
+    cards.resize(aCards.size() + bCards.size());
+    scores.resize(cards.size());
+
+    while (i < aCards.size() || j < bCards.size())
+    {
+        if (j == bCards.size()
+            || (i < aCards.size() && aCards[i] < bCards[j]))
+        {
+            cards[count] = aCards[i];
+            scores[count++] = aScores[i++];
+        }
+        else if (i == aCards.size() || bCards[j] < aCards[i])
+        {
+            cards[count] = bCards[j];
+            scores[count++] = bScores[j++];
+        }
+        else
+        {
+            cards[count] = aCards[i];
+            scores[count++] = aScores[i++] + bScores[j++];
+        }
+    }
+
+    cards.resize(count);
+    scores.resize(count);
+}
+
+// The first index from low on whose value is not less than the one given:
+// steps of doubling length find a range that holds it, and a binary search
+// finds it in the range.
+int PostingList::gallop(const quint32* values, int low, int size,
+    quint32 value)
+{
+    int high = low;
+    int step = 1;
+
+    while (high < size && values[high] < value)
+    {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+
+    if (high > size) high = size;
+
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+
+        if (values[middle] < value)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
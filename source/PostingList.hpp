@@ -0,0 +1,56 @@
+#ifndef POSTINGLIST_HPP
+#define POSTINGLIST_HPP
+
+#include <QByteArray>
+#include <QVector>
+
+// Lists of card numbers in ascending order, as the card database's search
+// index keeps them: on disk, each card is stored as its distance from the
+// one before, followed by its weight, both as varints (seven bits a byte,
+// the high bit set on all but the last). Lists are decoded whole before
+// they are combined, since even the longest takes microseconds.
+class PostingList
+{
+public:
+    static void appendVarint(QByteArray& data, quint32 value);
+
+    // Stops at end, so damaged data cannot be read past.
+    static inline bool readVarint(const uchar*& data, const uchar* end,
+        quint32& value)
+    {
+        value = 0;
+
+        for (int shift = 0; shift < 35 && data < end; shift += 7)
+        {
+            uchar byte = *data++;
+            value |= quint32(byte & 0x7f) << shift;
+
+            if (!(byte & 0x80)) return true;
+        }
+
+        return false;
+    }
+
+    static void encode(const QVector<quint32>& cards,
+        const QVector<quint32>& weights, QByteArray& data);
+    static bool decode(const uchar* data, const uchar* end, int count,
+        QVector<quint32>& cards, QVector<quint32>& weights);
+
+    // Gallops through the longer list when one is much shorter than the
+    // other, and otherwise compares four cards of each against each other
+    // at a time.
+    static void intersect(const QVector<quint32>& a,
+        const QVector<quint32>& b, QVector<quint32>& result);
+
+    // Cards in either list, with the scores of cards in both added up.
+    static void unite(const QVector<quint32>& aCards,
+        const QVector<float>& aScores, const QVector<quint32>& bCards,
+        const QVector<float>& bScores, QVector<quint32>& cards,
+        QVector<float>& scores);
+
+private:
+    static int gallop(const quint32* values, int low, int size,
+        quint32 value);
+};
+
+#endif
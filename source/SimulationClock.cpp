@@ -0,0 +1,44 @@
+#include "SimulationClock.hpp"
+
+SimulationClock::SimulationClock(float step, int maxSteps)
+    : _lastElapsed(0), _steps(0), _step(step), _accumulator(0.0f),
+    _maxSteps(maxSteps)
+{
+}
+
+SimulationClock::~SimulationClock()
+{
+}
+
+void SimulationClock::start()
+{
+    _timer.start();
+    _lastElapsed = 0;
+    _steps = 0;
+    _accumulator = 0.0f;
+}
+
+int SimulationClock::advance()
+{
+    qint64 elapsed = _timer.nsecsElapsed();
+    _accumulator += float(elapsed - _lastElapsed) / 1000000000.0f;
+    _lastElapsed = elapsed;
+
+    int result = int(_accumulator / _step);
+
+    if (result > _maxSteps)
+    {
+        _accumulator -= float(result - _maxSteps) * _step;
+        result = _maxSteps;
+    }
+
+    return result;
+}
+
+void SimulationClock::tick()
+{
+    ++_steps;
+    _accumulator -= _step;
+
+    if (_accumulator < 0.0f) _accumulator = 0.0f;
+}
@@ -0,0 +1,39 @@
+#ifndef SIMULATIONCLOCK_HPP
+#define SIMULATIONCLOCK_HPP
+
+#include <QElapsedTimer>
+
+// Decouples the simulation rate from the rendering rate. Real time is fed
+// into an accumulator that is drained in fixed steps, and whatever is left
+// over becomes the interpolation factor for rendering between the previous
+// and current simulation states.
+class SimulationClock
+{
+public:
+    explicit SimulationClock(float step = 1.0f / 60.0f, int maxSteps = 8);
+    ~SimulationClock();
+
+    void start();
+
+    // Returns how many fixed steps to simulate to catch up with real time.
+    // Falling more than maxSteps behind drops the excess rather than letting
+    // a slow frame snowball into slower ones.
+    int advance();
+
+    // Marks one fixed step as simulated.
+    void tick();
+
+    inline float step() const { return _step; }
+    inline float time() const { return float(_steps) * _step; }
+    inline float alpha() const { return _accumulator / _step; }
+
+private:
+    QElapsedTimer _timer;
+    qint64 _lastElapsed;
+    qint64 _steps;
+    float _step;
+    float _accumulator;
+    int _maxSteps;
+};
+
+#endif
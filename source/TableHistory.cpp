@@ -0,0 +1,140 @@
+#include "TableHistory.hpp"
+
+TableHistory::TableHistory(int maxSteps)
+    : _maxSteps(maxSteps > 1 ? maxSteps : 2), _cardCount(0), _current(0)
+{
+    _working.copiedChunks = 0;
+}
+
+TableHistory::~TableHistory()
+{
+}
+
+void TableHistory::reset(const QVector<CardState>& states)
+{
+    _cardCount = states.size();
+    _steps.clear();
+    _current = 0;
+
+    int chunkCount = (_cardCount + ChunkSize - 1) / ChunkSize;
+    Step step;
+    step.chunks.resize(chunkCount);
+    step.copiedChunks = chunkCount;
+
+    for (int i = 0; i < chunkCount; ++i)
+    {
+        step.chunks[i] = QSharedPointer<Chunk>(new Chunk);
+
+        for (int j = 0; j < ChunkSize && i * ChunkSize + j < _cardCount; ++j)
+            step.chunks[i]->states[j] = states[i * ChunkSize + j];
+    }
+
+    _steps.append(step);
+    _working = step;
+    _working.copiedChunks = 0;
+    _isCopied.fill(false, chunkCount);
+}
+
+const CardState& TableHistory::state(int card) const
+{
+    return _working.chunks[card / ChunkSize]->states[card % ChunkSize];
+}
+
+// The first change to a chunk within an action copies it; the step being
+// built then owns that copy while every other chunk stays shared.
+void TableHistory::change(int card, const CardState& state)
+{
+    if (card < 0 || card >= _cardCount || this->state(card) == state) return;
+
+    int chunk = card / ChunkSize;
+
+    if (!_isCopied[chunk])
+    {
+        _working.chunks[chunk] =
+            QSharedPointer<Chunk>(new Chunk(*_working.chunks[chunk]));
+        _isCopied[chunk] = true;
+        ++_working.copiedChunks;
+    }
+
+    _working.chunks[chunk]->states[card % ChunkSize] = state;
+}
+
+void TableHistory::commit()
+{
+    if (_working.copiedChunks == 0) return;
+
+    // A new action discards whatever could have been redone.
+    while (_steps.size() > _current + 1)
+        _steps.removeLast();
+
+    _steps.append(_working);
+    ++_current;
+
+    if (_steps.size() > _maxSteps)
+    {
+        _steps.removeFirst();
+        --_current;
+    }
+
+    _working.copiedChunks = 0;
+    _isCopied.fill(false);
+}
+
+bool TableHistory::undo(QVector<int>& changedCards)
+{
+    if (!canUndo()) return false;
+
+    moveTo(_current - 1, changedCards);
+    return true;
+}
+
+bool TableHistory::redo(QVector<int>& changedCards)
+{
+    if (!canRedo()) return false;
+
+    moveTo(_current + 1, changedCards);
+    return true;
+}
+
+int TableHistory::stepBytes(int step) const
+{
+    if (step < 0 || step >= _steps.size()) return 0;
+
+    const Step& s = _steps[step];
+    return s.copiedChunks * int(sizeof(Chunk))
+        + s.chunks.size() * int(sizeof(QSharedPointer<Chunk>));
+}
+
+int TableHistory::totalBytes() const
+{
+    int result = 0;
+
+    for (int i = 0; i < _steps.size(); ++i)
+        result += stepBytes(i);
+
+    return result;
+}
+
+// Uncommitted changes are dropped. Shared chunks are skipped by pointer, so
+// only the chunks that actually differ between the two steps are compared.
+void TableHistory::moveTo(int step, QVector<int>& changedCards)
+{
+    const Step& from = _working;
+    const Step& to = _steps[step];
+
+    for (int i = 0; i < to.chunks.size(); ++i)
+    {
+        if (from.chunks[i] == to.chunks[i]) continue;
+
+        const CardState* a = from.chunks[i]->states;
+        const CardState* b = to.chunks[i]->states;
+
+        for (int j = 0; j < ChunkSize && i * ChunkSize + j < _cardCount; ++j)
+            if (a[j] != b[j]) changedCards.append(i * ChunkSize + j);
+    }
+
+    _current = step;
+    _working = to;
+    _working.copiedChunks = 0;
+    _isCopied.fill(false);
+}
@@ -0,0 +1,91 @@
+#ifndef TABLEHISTORY_HPP
+#define TABLEHISTORY_HPP
+
+#include "Rotation.hpp"
+#include <QList>
+#include <QSharedPointer>
+#include <QVector>
+#include <QVector3D>
+
+class CardState
+{
+public:
+    QVector3D position;
+    Rotation rotation;
+    Rotation flip;
+
+    inline bool operator==(const CardState& other) const
+    {
+        return position == other.position
+            && rotation.toRadians() == other.rotation.toRadians()
+            && flip.toRadians() == other.flip.toRadians();
+    }
+
+    inline bool operator!=(const CardState& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// Undo and redo for the state of the cards on the table. Card states are kept
+// in fixed-size chunks that are shared between history steps, so a step only
+// owns copies of the chunks its action touched, and moving between steps only
+// looks at the chunks that differ.
+//
+// Changes are staged with change() and become a single undoable step on
+// commit().
+class TableHistory
+{
+public:
+    static const int ChunkSize = 32;
+
+    explicit TableHistory(int maxSteps = 256);
+    ~TableHistory();
+
+    void reset(const QVector<CardState>& states);
+
+    inline int cardCount() const { return _cardCount; }
+    const CardState& state(int card) const;
+
+    void change(int card, const CardState& state);
+    void commit();
+
+    inline bool canUndo() const { return _current > 0; }
+    inline bool canRedo() const { return _current + 1 < _steps.size(); }
+
+    // Both list the cards whose state differs afterward.
+    bool undo(QVector<int>& changedCards);
+    bool redo(QVector<int>& changedCards);
+
+    // Memory owned by one step (the chunks it copied plus its chunk table) and
+    // by the whole history.
+    inline int stepCount() const { return _steps.size(); }
+    inline int currentStep() const { return _current; }
+    int stepBytes(int step) const;
+    int totalBytes() const;
+
+private:
+    class Chunk
+    {
+    public:
+        CardState states[ChunkSize];
+    };
+
+    class Step
+    {
+    public:
+        QVector<QSharedPointer<Chunk> > chunks;
+        int copiedChunks;
+    };
+
+    void moveTo(int step, QVector<int>& changedCards);
+
+    int _maxSteps;
+    int _cardCount;
+    int _current;
+    QList<Step> _steps;
+    Step _working;
+    QVector<bool> _isCopied;
+};
+
+#endif
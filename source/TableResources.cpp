@@ -0,0 +1,127 @@
+#include "TableResources.hpp"
+
+// The fixed textures are wanted before any card face.
+static const float FixedPriority = 1e30f;
+
+TableResources::TableResources()
+{
+    _program = 0;
+    _cardBuffer = 0;
+    _tableBuffer = 0;
+    _glyphAtlas = 0;
+    _textProgram = 0;
+    _streamer = 0;
+    _textures = 0;
+    _compositor = 0;
+    _placeholders[0] = 0;
+    _placeholders[1] = 0;
+    _placeholders[2] = 0;
+    _frame = 0;
+}
+
+TableResources::~TableResources()
+{
+    if (!isInitialized()) return;
+
+    // Outstanding jobs point into the texture manager, so the workers go
+    // first, and the handles have to be gone before the manager is.
+    delete _streamer;
+    _table = TextureManager::Handle();
+    _front = TextureManager::Handle();
+    _back = TextureManager::Handle();
+    delete _compositor;
+    delete _textures;
+    glDeleteTextures(3, _placeholders);
+    delete _textProgram;
+    delete _glyphAtlas;
+    delete _tableBuffer;
+    delete _cardBuffer;
+    delete _program;
+}
+
+void TableResources::initialize(int cardCount)
+{
+    if (isInitialized()) return;
+
+    initializeOpenGLFunctions();
+
+    _program = new MainProgram;
+    _glyphAtlas = new GlyphAtlas;
+    _textProgram = new TextProgram(_glyphAtlas->spread());
+
+    _pack.open("../cards.pack");
+    _database.open("../cards.db");
+    _streamer = new TextureStreamer;
+    _textures = new TextureManager(*_streamer);
+    _compositor = new CardCompositor(*_textures, 256, &_pack);
+
+    _table = loadImage("wood", "../wood.jpg");
+    _front = loadImage("localuprising", "../localuprising.gif");
+    _back = loadImage("liberation", "../liberation.gif");
+    _placeholders[0] = createPlaceholder(QColor(90, 60, 30));
+    _placeholders[1] = createPlaceholder(QColor(60, 60, 70));
+    _placeholders[2] = createPlaceholder(QColor(20, 20, 60));
+
+    // Room for every face on the table at once, plus the fixed textures.
+    qint64 faceBytes = qint64(256) * 256 * 4 * 4 / 3;
+    _textures->budget(qMax(_textures->budget(),
+        faceBytes * (cardCount + 16)));
+
+    CardSpecifications specifications;
+    //specifications.depth(1.0f);
+    CardBuilder builder(specifications);
+    _cardBuffer = new CardBuffer(builder);
+    _tableBuffer = new TableBuffer;
+}
+
+void TableResources::update(int budgetMilliseconds, int& viewFrame)
+{
+    if (viewFrame == _frame)
+    {
+        ++_frame;
+        _streamer->upload(budgetMilliseconds);
+        _textures->nextFrame();
+    }
+
+    viewFrame = _frame;
+}
+
+GLuint TableResources::tableTexture()
+{
+    return _textures->texture(_table, FixedPriority, _placeholders[0]);
+}
+
+GLuint TableResources::frontTexture()
+{
+    return _textures->texture(_front, FixedPriority, _placeholders[1]);
+}
+
+GLuint TableResources::backTexture()
+{
+    return _textures->texture(_back, FixedPriority, _placeholders[2]);
+}
+
+TextureManager::Handle TableResources::loadImage(const QByteArray& id,
+    const QString& path)
+{
+    CardPack::Entry entry;
+
+    if (_pack.find(id, entry)) return _textures->loadPack(_pack, id);
+
+    return _textures->loadFile(path);
+}
+
+GLuint TableResources::createPlaceholder(const QColor& color)
+{
+    GLubyte pixel[4] = { GLubyte(color.red()), GLubyte(color.green()),
+        GLubyte(color.blue()), 255 };
+
+    GLuint result;
+    glGenTextures(1, &result);
+    glBindTexture(GL_TEXTURE_2D, result);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA,
+        GL_UNSIGNED_BYTE, pixel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return result;
+}
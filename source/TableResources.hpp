@@ -0,0 +1,88 @@
+#ifndef TABLERESOURCES_HPP
+#define TABLERESOURCES_HPP
+
+#include "MainProgram.hpp"
+#include "CardBuffer.hpp"
+#include "TableBuffer.hpp"
+#include "GlyphAtlas.hpp"
+#include "TextProgram.hpp"
+#include "CardCompositor.hpp"
+#include "CardPack.hpp"
+#include "CardDatabase.hpp"
+#include "TextureManager.hpp"
+#include "TextureStreamer.hpp"
+#include <QOpenGLFunctions>
+#include <QColor>
+
+// Everything a table view draws with that does not depend on the view:
+// shaders, card and table geometry, the glyph atlas, the composed faces and
+// the fixed textures. Views whose contexts share objects hold one of these
+// through a QSharedPointer, so each additional view costs a framebuffer and
+// its own small caches rather than another copy of every asset.
+//
+// Card images come from the card pack when there is one and it has them,
+// and from loose files otherwise. Card details come from the card database,
+// which is left closed if there is none.
+//
+// Textures are streamed in and may be evicted: until one is resident, a flat
+// colored one stands in for it, so texture names may change from frame to
+// frame and should be asked for each time they are bound.
+//
+// Nothing is created until initialize() is called by the first view to get
+// a current context, and the last view to let go must make its context
+// current first, since the destructor deletes GL objects.
+class TableResources : protected QOpenGLFunctions
+{
+public:
+    TableResources();
+    virtual ~TableResources();
+
+    inline bool isInitialized() const { return _program != 0; }
+
+    void initialize(int cardCount);
+
+    // Uploads whatever the streamer has finished loading, within the budget,
+    // and starts a new frame. Every view calls this after drawing, passing
+    // the number of the frame it last drew in, which is updated. A frame
+    // ends when some view comes round to draw in it a second time, so the
+    // budget and the frame count do not grow with the number of views, and
+    // a view that stops drawing holds nothing up.
+    void update(int budgetMilliseconds, int& viewFrame);
+
+    inline MainProgram& program() { return *_program; }
+    inline CardBuffer& cardBuffer() { return *_cardBuffer; }
+    inline TableBuffer& tableBuffer() { return *_tableBuffer; }
+    inline GlyphAtlas& glyphAtlas() { return *_glyphAtlas; }
+    inline TextProgram& textProgram() { return *_textProgram; }
+    inline CardCompositor& compositor() { return *_compositor; }
+    inline TextureManager& textures() { return *_textures; }
+    inline const CardDatabase& database() const { return _database; }
+
+    GLuint tableTexture();
+    GLuint frontTexture();
+    GLuint backTexture();
+
+private:
+    TextureManager::Handle loadImage(const QByteArray& id,
+        const QString& path);
+    GLuint createPlaceholder(const QColor& color);
+
+    CardPack _pack;
+    CardDatabase _database;
+
+    MainProgram* _program;
+    CardBuffer* _cardBuffer;
+    TableBuffer* _tableBuffer;
+    GlyphAtlas* _glyphAtlas;
+    TextProgram* _textProgram;
+    TextureStreamer* _streamer;
+    TextureManager* _textures;
+    CardCompositor* _compositor;
+    TextureManager::Handle _table;
+    TextureManager::Handle _front;
+    TextureManager::Handle _back;
+    GLuint _placeholders[3];
+    int _frame;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "TextBuffer.hpp"
+
+TextBuffer::TextBuffer(const GlyphAtlas& atlas)
+    : _atlas(atlas), _capacity(0)
+{
+    initializeOpenGLFunctions();
+    glGenBuffers(1, &_buffer);
+
+    // Reserving keeps the capacity when the vector is emptied each frame.
+    _vertices.reserve(FloatsPerQuad * 256);
+}
+
+TextBuffer::~TextBuffer()
+{
+    glDeleteBuffers(1, &_buffer);
+}
+
+void TextBuffer::clear()
+{
+    _vertices.resize(0);
+}
+
+void TextBuffer::addText(const QVector3D& position, const char* text,
+    float size, const QVector4D& color)
+{
+    float texel = size / _atlas.texelsPerLine();
+    float x = -_atlas.width(text) * size * 0.5f;
+    float y = -_atlas.middle() * size;
+
+    for (; *text; ++text)
+    {
+        const GlyphAtlas::Glyph& glyph = _atlas.glyph(*text);
+
+        if (*text != ' ')
+        {
+            addQuad(position, x + glyph.left * size, y + glyph.bottom * size,
+                x + glyph.right * size, y + glyph.top * size, glyph, color,
+                texel);
+        }
+
+        x += glyph.advance * size;
+    }
+}
+
+// The disc is drawn first so the text that follows lands on top of it within
+// the same draw.
+void TextBuffer::addBadge(const QVector3D& position, const char* text,
+    float size, const QVector4D& textColor, const QVector4D& badgeColor)
+{
+    float radius = qMax(size, _atlas.width(text) * size) * 0.5f
+        + size * 0.25f;
+    float half = radius / (_atlas.badgeRadius() * 2.0f);
+    float texel = half * 2.0f / float(_atlas.cellSize());
+
+    addQuad(position, -half, -half, half, half,
+        _atlas.glyph(char(GlyphAtlas::Badge)), badgeColor, texel);
+    addText(position, text, size, textColor);
+}
+
+void TextBuffer::addBadge(const QVector3D& position, int number, float size,
+    const QVector4D& textColor, const QVector4D& badgeColor)
+{
+    char digits[16];
+    char* p = digits + sizeof(digits) - 1;
+    unsigned int n = number < 0 ? 0u - unsigned(number) : unsigned(number);
+    *p = '\0';
+
+    do
+    {
+        *--p = char('0' + n % 10);
+        n /= 10;
+    } while (n);
+
+    if (number < 0) *--p = '-';
+
+    addBadge(position, p, size, textColor, badgeColor);
+}
+
+void TextBuffer::draw(TextProgram& program)
+{
+    int count = _vertices.size() / FloatsPerVertex;
+
+    if (count == 0) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+
+    // Respecifying the store orphans last frame's contents, so the driver
+    // need not wait for it to be drawn. It only grows with the vector.
+    int bytes = _vertices.size() * int(sizeof(GLfloat));
+    _capacity = qMax(_capacity, _vertices.capacity() * int(sizeof(GLfloat)));
+    glBufferData(GL_ARRAY_BUFFER, _capacity, 0, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, _vertices.constData());
+
+    const GLsizei stride = FloatsPerVertex * sizeof(GLfloat);
+    glVertexAttribPointer(program.positionAttribute(), 3, GL_FLOAT, GL_FALSE,
+        stride, 0);
+    glVertexAttribPointer(program.textureAttribute(), 2, GL_FLOAT, GL_FALSE,
+        stride, reinterpret_cast<const GLvoid*>(3 * sizeof(GLfloat)));
+    glVertexAttribPointer(program.colorAttribute(), 4, GL_FLOAT, GL_FALSE,
+        stride, reinterpret_cast<const GLvoid*>(5 * sizeof(GLfloat)));
+    glVertexAttribPointer(program.texelAttribute(), 1, GL_FLOAT, GL_FALSE,
+        stride, reinterpret_cast<const GLvoid*>(9 * sizeof(GLfloat)));
+
+    glBindTexture(GL_TEXTURE_2D, _atlas.texture());
+    glDrawArrays(GL_TRIANGLES, 0, count);
+}
+
+void TextBuffer::addQuad(const QVector3D& position, float left, float bottom,
+    float right, float top, const GlyphAtlas::Glyph& glyph,
+    const QVector4D& color, float texel)
+{
+    addVertex(position, left, bottom, glyph.s0, glyph.t0, color, texel);
+    addVertex(position, right, bottom, glyph.s1, glyph.t0, color, texel);
+    addVertex(position, right, top, glyph.s1, glyph.t1, color, texel);
+    addVertex(position, left, bottom, glyph.s0, glyph.t0, color, texel);
+    addVertex(position, right, top, glyph.s1, glyph.t1, color, texel);
+    addVertex(position, left, top, glyph.s0, glyph.t1, color, texel);
+}
+
+void TextBuffer::addVertex(const QVector3D& position, float x, float y,
+    float s, float t, const QVector4D& color, float texel)
+{
+    _vertices.append(position.x() + x);
+    _vertices.append(position.y() + y);
+    _vertices.append(position.z());
+    _vertices.append(s);
+    _vertices.append(t);
+    _vertices.append(color.x());
+    _vertices.append(color.y());
+    _vertices.append(color.z());
+    _vertices.append(color.w());
+    _vertices.append(texel);
+}
@@ -0,0 +1,50 @@
+#ifndef TEXTBUFFER_HPP
+#define TEXTBUFFER_HPP
+
+#include "GlyphAtlas.hpp"
+#include "TextProgram.hpp"
+#include <QVector>
+#include <QVector3D>
+#include <QVector4D>
+
+// Collects every label and badge of a frame into one vertex stream so they all
+// go out in a single draw. Positions are in view space and the quads face the
+// camera. Text is plain ASCII; numbers are formatted in place, so refilling
+// the buffer every frame does not allocate once it has grown large enough.
+class TextBuffer : protected QOpenGLFunctions
+{
+public:
+    TextBuffer(const GlyphAtlas& atlas);
+    virtual ~TextBuffer();
+
+    void clear();
+
+    // Text is centered on position; size is the height of a line.
+    void addText(const QVector3D& position, const char* text, float size,
+        const QVector4D& color);
+    void addBadge(const QVector3D& position, const char* text, float size,
+        const QVector4D& textColor, const QVector4D& badgeColor);
+    void addBadge(const QVector3D& position, int number, float size,
+        const QVector4D& textColor, const QVector4D& badgeColor);
+
+    inline int quadCount() const { return _vertices.size() / FloatsPerQuad; }
+
+    void draw(TextProgram& program);
+
+private:
+    static const int FloatsPerVertex = 10;
+    static const int FloatsPerQuad = FloatsPerVertex * 6;
+
+    void addQuad(const QVector3D& position, float left, float bottom,
+        float right, float top, const GlyphAtlas::Glyph& glyph,
+        const QVector4D& color, float texel);
+    void addVertex(const QVector3D& position, float x, float y, float s,
+        float t, const QVector4D& color, float texel);
+
+    const GlyphAtlas& _atlas;
+    QVector<GLfloat> _vertices;
+    GLuint _buffer;
+    int _capacity;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "TextProgram.hpp"
+
+TextProgram::TextProgram(int spread)
+{
+    initializeOpenGLFunctions();
+
+    const char* vertexShaderSource =
+        "attribute highp vec4 position;\n"
+        "attribute mediump vec2 tc;\n"
+        "attribute lowp vec4 color;\n"
+        "attribute highp float texel;\n"
+        "varying mediump vec2 vtc;\n"
+        "varying lowp vec4 vcolor;\n"
+        "varying mediump float vsmoothing;\n"
+        "uniform highp mat4 matrix;\n"
+        "uniform highp float pixelScale;\n"
+        "uniform highp float smoothing;\n"
+        "void main() {\n"
+        "   vtc = tc;\n"
+        "   vcolor = color;\n"
+        "   gl_Position = matrix * position;\n"
+        "   float pixels = pixelScale * texel / max(gl_Position.w, 0.0001);\n"
+        "   vsmoothing = clamp(smoothing / max(pixels, 0.0001), 0.001, 0.5);\n"
+        "}\n";
+
+    const char* fragmentShaderSource =
+#ifdef Q_OS_WIN
+        "precision highp float;\n"
+#endif
+        "uniform sampler2D texture;\n"
+        "varying mediump vec2 vtc;\n"
+        "varying lowp vec4 vcolor;\n"
+        "varying mediump float vsmoothing;\n"
+        "void main() {\n"
+        "   float d = texture2D(texture, vtc).r;\n"
+        "   float a = smoothstep(0.5 - vsmoothing, 0.5 + vsmoothing, d);\n"
+        "   gl_FragColor = vec4(vcolor.rgb, vcolor.a * a);\n"
+        "}\n";
+
+    _program.addShaderFromSourceCode(QOpenGLShader::Vertex,
+        vertexShaderSource);
+    _program.addShaderFromSourceCode(QOpenGLShader::Fragment,
+        fragmentShaderSource);
+    _program.link();
+    _positionAttribute = _program.attributeLocation("position");
+    _textureAttribute = _program.attributeLocation("tc");
+    _colorAttribute = _program.attributeLocation("color");
+    _texelAttribute = _program.attributeLocation("texel");
+    _matrixUniform = _program.uniformLocation("matrix");
+    _textureUniform = _program.uniformLocation("texture");
+    _pixelScaleUniform = _program.uniformLocation("pixelScale");
+    _smoothingUniform = _program.uniformLocation("smoothing");
+
+    // The distance field changes by 1 / (2 * spread) per texel; smooth over
+    // roughly 1.4 pixels.
+    _program.bind();
+    _program.setUniformValue(_textureUniform, 0);
+    _program.setUniformValue(_smoothingUniform, 0.35f / float(spread));
+    _program.release();
+}
+
+TextProgram::~TextProgram()
+{
+}
+
+void TextProgram::bind()
+{
+    _program.bind();
+    glEnableVertexAttribArray(_positionAttribute);
+    glEnableVertexAttribArray(_textureAttribute);
+    glEnableVertexAttribArray(_colorAttribute);
+    glEnableVertexAttribArray(_texelAttribute);
+}
+
+void TextProgram::release()
+{
+    glDisableVertexAttribArray(_texelAttribute);
+    glDisableVertexAttribArray(_colorAttribute);
+    glDisableVertexAttribArray(_textureAttribute);
+    glDisableVertexAttribArray(_positionAttribute);
+    _program.release();
+}
+
+void TextProgram::setMatrix(const QMatrix4x4& matrix)
+{
+    _program.setUniformValue(_matrixUniform, matrix);
+}
+
+void TextProgram::setPixelScale(float pixelScale)
+{
+    _program.setUniformValue(_pixelScaleUniform, pixelScale);
+}
@@ -0,0 +1,42 @@
+#ifndef TEXTPROGRAM_HPP
+#define TEXTPROGRAM_HPP
+
+#include <QMatrix4x4>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFunctions>
+
+// Draws signed distance field glyphs. Each vertex carries how big an atlas
+// texel is in view space, so the shader can work out how many pixels that is
+// and keep the antialiased edge about one pixel wide at any distance.
+class TextProgram : protected QOpenGLFunctions
+{
+public:
+    TextProgram(int spread);
+    virtual ~TextProgram();
+
+    inline GLuint positionAttribute() const { return _positionAttribute; }
+    inline GLuint textureAttribute() const { return _textureAttribute; }
+    inline GLuint colorAttribute() const { return _colorAttribute; }
+    inline GLuint texelAttribute() const { return _texelAttribute; }
+
+    void bind();
+    void release();
+    void setMatrix(const QMatrix4x4& matrix);
+
+    // Pixels covered by one view space unit at a depth of one.
+    void setPixelScale(float pixelScale);
+
+private:
+    QOpenGLShaderProgram _program;
+
+    GLuint _positionAttribute;
+    GLuint _textureAttribute;
+    GLuint _colorAttribute;
+    GLuint _texelAttribute;
+    GLuint _matrixUniform;
+    GLuint _textureUniform;
+    GLuint _pixelScaleUniform;
+    GLuint _smoothingUniform;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "TextureFile.hpp"
+#include "BlockCompressor.hpp"
+#include "ImageResampler.hpp"
+#include <cstring>
+
+static const uchar Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB,
+    '\r', '\n', 0x1A, '\n' };
+static const quint32 Endianness = 0x04030201;
+static const int HeaderWords = 13;
+static const int HeaderSize = 12 + HeaderWords * 4;
+
+static int levelBytes(TextureFile::Format format, int width, int height)
+{
+    switch (format)
+    {
+    case TextureFile::Bc1: return BlockCompressor::bc1Size(width, height);
+    case TextureFile::Bc3: return BlockCompressor::bc3Size(width, height);
+    default: return width * height * 4;
+    }
+}
+
+static void appendWord(QByteArray& data, quint32 word)
+{
+    data.append(reinterpret_cast<const char*>(&word), 4);
+}
+
+TextureFile::TextureFile() : _format(Rgba), _width(0), _height(0)
+{
+}
+
+TextureFile::~TextureFile()
+{
+}
+
+// The file is sized up front so that uncompressed levels can be filtered
+// straight into it. Compressed levels go through two scratch images instead.
+QByteArray TextureFile::write(const QImage& image, int width, int height,
+    Format format)
+{
+    bool isBgra;
+    QImage pixels = ImageResampler::pixels(image, isBgra);
+    bool swapRedBlue = isBgra != (format == Bgra);
+    bool isUncompressed = format == Rgba || format == Bgra;
+    int levelCount = 1;
+
+    while ((qMax(width, height) >> levelCount) > 0)
+        ++levelCount;
+
+    TextureFile file;
+    file._format = format;
+    file._width = width;
+    file._height = height;
+
+    QByteArray result;
+    result.append(reinterpret_cast<const char*>(Identifier), 12);
+    appendWord(result, Endianness);
+    appendWord(result, isUncompressed ? GL_UNSIGNED_BYTE : 0);
+    appendWord(result, 1);
+    appendWord(result, isUncompressed ? file.pixelFormat() : 0);
+    appendWord(result, file.internalFormat());
+    appendWord(result, format == Bc1 ? GL_RGB : GL_RGBA);
+    appendWord(result, width);
+    appendWord(result, height);
+    appendWord(result, 0);
+    appendWord(result, 0);
+    appendWord(result, 1);
+    appendWord(result, levelCount);
+    appendWord(result, 0);
+
+    int total = result.size();
+
+    for (int i = 0; i < levelCount; ++i)
+        total += 4 + levelBytes(format, file.width(i), file.height(i));
+
+    int offset = result.size();
+    result.resize(total);
+
+    QByteArray scratch[2];
+    const uchar* previous = 0;
+
+    for (int i = 0; i < levelCount; ++i)
+    {
+        int levelWidth = file.width(i);
+        int levelHeight = file.height(i);
+        quint32 size = levelBytes(format, levelWidth, levelHeight);
+
+        memcpy(result.data() + offset, &size, 4);
+        offset += 4;
+        uchar* target = reinterpret_cast<uchar*>(result.data() + offset);
+        offset += size;
+        uchar* level = target;
+
+        if (!isUncompressed)
+        {
+            scratch[i & 1].resize(levelWidth * levelHeight * 4);
+            level = reinterpret_cast<uchar*>(scratch[i & 1].data());
+        }
+
+        if (i == 0)
+        {
+            ImageResampler::resample(pixels, width, height, level,
+                swapRedBlue, true);
+        }
+        else
+        {
+            ImageResampler::halve(previous, file.width(i - 1),
+                file.height(i - 1), level);
+        }
+
+        if (format == Bc1)
+            BlockCompressor::compressBc1(level, levelWidth, levelHeight,
+                target);
+        else if (format == Bc3)
+            BlockCompressor::compressBc3(level, levelWidth, levelHeight,
+                target);
+
+        previous = level;
+    }
+
+    return result;
+}
+
+bool TextureFile::read(const uchar* data, qint64 size)
+{
+    _levels.clear();
+    _sizes.clear();
+
+    if (size < HeaderSize || memcmp(data, Identifier, 12) != 0) return false;
+
+    quint32 header[HeaderWords];
+    memcpy(header, data + 12, sizeof(header));
+
+    if (header[0] != Endianness || header[9] != 0 || header[10] != 1)
+        return false;
+
+    switch (header[4])
+    {
+    case GL_RGBA: _format = header[3] == GL_BGRA_EXT ? Bgra : Rgba; break;
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: _format = Bc1; break;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: _format = Bc3; break;
+    default: return false;
+    }
+
+    _width = header[6];
+    _height = header[7];
+    int levelCount = header[11];
+    qint64 offset = HeaderSize + header[12];
+
+    for (int i = 0; i < levelCount; ++i)
+    {
+        if (offset + 4 > size) return false;
+
+        quint32 levelSize;
+        memcpy(&levelSize, data + offset, 4);
+        offset += 4;
+
+        if (offset + levelSize > size
+            || int(levelSize) != levelBytes(_format, width(i), height(i)))
+            return false;
+
+        _levels.append(data + offset);
+        _sizes.append(levelSize);
+        offset += (levelSize + 3) & ~3;
+    }
+
+    return levelCount > 0;
+}
+
+GLenum TextureFile::internalFormat() const
+{
+    switch (_format)
+    {
+    case Bc1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case Bc3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default: return GL_RGBA;
+    }
+}
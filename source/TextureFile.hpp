@@ -0,0 +1,68 @@
+#ifndef TEXTUREFILE_HPP
+#define TEXTUREFILE_HPP
+
+#include <QOpenGLFunctions>
+#include <QByteArray>
+#include <QImage>
+#include <QVector>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#ifndef GL_BGRA_EXT
+#define GL_BGRA_EXT 0x80E1
+#endif
+
+// A texture with its whole mip chain, ready to hand to GL as is, in a KTX 1.1
+// container. write() builds one from an image; read() only points into the
+// data it is given (a mapped file, say), so that data has to outlive it.
+class TextureFile
+{
+public:
+    enum Format
+    {
+        Rgba,
+        Bgra,
+        Bc1,
+        Bc3
+    };
+
+    TextureFile();
+    ~TextureFile();
+
+    // Scales the image to width by height, flips it bottom up and puts its
+    // channels in the format's order, all in one pass over its pixels. Each
+    // mip level is then made from the one before.
+    static QByteArray write(const QImage& image, int width, int height,
+        Format format);
+
+    bool read(const uchar* data, qint64 size);
+
+    inline Format format() const { return _format; }
+    inline bool isCompressed() const { return _format >= Bc1; }
+    GLenum internalFormat() const;
+    inline GLenum pixelFormat() const
+    {
+        return _format == Bgra ? GL_BGRA_EXT : GL_RGBA;
+    }
+
+    inline int levelCount() const { return _levels.size(); }
+    inline int width(int level) const { return qMax(_width >> level, 1); }
+    inline int height(int level) const { return qMax(_height >> level, 1); }
+    inline const uchar* data(int level) const { return _levels[level]; }
+    inline int size(int level) const { return _sizes[level]; }
+
+private:
+    Format _format;
+    int _width;
+    int _height;
+    QVector<const uchar*> _levels;
+    QVector<int> _sizes;
+};
+
+#endif
@@ -0,0 +1,722 @@
+#include "TextureManager.hpp"
+#include "ImageResampler.hpp"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QOpenGLContext>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <climits>
+
+// One level finer than the screen needs keeps minification filtering smooth.
+static const int TailLevels = 1;
+
+// How long a texture has to be drawn smaller before its finer levels go.
+static const int CoarseFrames = 120;
+
+#ifndef GL_RGBA8_OES
+#define GL_RGBA8_OES 0x8058
+#endif
+
+#ifndef GL_BGRA8_EXT
+#define GL_BGRA8_EXT 0x93A1
+#endif
+
+class FileSource : public TextureManager::Source
+{
+public:
+    FileSource(const QString& path) : _path(path)
+    {
+    }
+
+    virtual QByteArray cacheKey() const
+    {
+        QFile file(_path);
+
+        if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(&file);
+        return hash.result().toHex();
+    }
+
+    virtual QImage load() const
+    {
+        return QImage(_path);
+    }
+
+private:
+    QString _path;
+};
+
+// The pack already knows the hash of each image, so finding the cache key
+// reads nothing.
+class PackSource : public TextureManager::Source
+{
+public:
+    PackSource(const CardPack& pack, const QByteArray& id)
+        : _pack(pack), _id(id)
+    {
+    }
+
+    virtual QByteArray cacheKey() const
+    {
+        CardPack::Entry entry;
+        return _pack.find(_id, entry) ? entry.hash.toHex() : QByteArray();
+    }
+
+    virtual QImage load() const
+    {
+        return _pack.image(_id);
+    }
+
+private:
+    const CardPack& _pack;
+    QByteArray _id;
+};
+
+TextureManager::Handle::Handle() : _manager(0), _entry(-1)
+{
+}
+
+TextureManager::Handle::Handle(TextureManager* manager, int entry)
+    : _manager(manager), _entry(entry)
+{
+    _manager->retain(_entry);
+}
+
+TextureManager::Handle::Handle(const Handle& other)
+    : _manager(other._manager), _entry(other._entry)
+{
+    if (_manager) _manager->retain(_entry);
+}
+
+TextureManager::Handle::~Handle()
+{
+    if (_manager) _manager->release(_entry);
+}
+
+TextureManager::Handle& TextureManager::Handle::operator=(
+    const Handle& other)
+{
+    if (other._manager) other._manager->retain(other._entry);
+    if (_manager) _manager->release(_entry);
+
+    _manager = other._manager;
+    _entry = other._entry;
+    return *this;
+}
+
+TextureManager::LoadJob::LoadJob(TextureManager& manager, int entry,
+    int level, float screenSize)
+    : _manager(manager), _entry(entry), _level(level),
+    _screenSize(screenSize), _source(manager._entries[entry].source),
+    _isCached(false)
+{
+}
+
+// The hash covers the finished texture, so sources that differ only in name
+// share one.
+void TextureManager::LoadJob::load()
+{
+    _isCached = readCache();
+
+    if (!_isCached)
+    {
+        QImage image = _source->load();
+
+        if (image.isNull()) return;
+
+        encode(image);
+    }
+
+    int format = _texture.format();
+    int width = _texture.width(0);
+    int height = _texture.height(0);
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(reinterpret_cast<const char*>(&format), sizeof(format));
+    hash.addData(reinterpret_cast<const char*>(&width), sizeof(width));
+    hash.addData(reinterpret_cast<const char*>(&height), sizeof(height));
+    hash.addData(reinterpret_cast<const char*>(_texture.data(0)),
+        _texture.size(0));
+    _hash = hash.result();
+}
+
+void TextureManager::LoadJob::finish()
+{
+    if (_isCached) ++_manager._statistics.cacheHits;
+
+    _manager.store(_entry, _texture, _hash, _level, _screenSize);
+}
+
+// The mapping stays open until the job is done with, so the upload reads
+// straight from the page cache.
+bool TextureManager::LoadJob::readCache()
+{
+    QByteArray key = _source->cacheKey();
+
+    if (key.isEmpty()) return false;
+
+    _file.setFileName(_manager._cacheDirectory + "/"
+        + QString::fromLatin1(key) + _manager._cacheSuffix);
+
+    if (!_file.open(QIODevice::ReadOnly)) return false;
+
+    uchar* data = _file.map(0, _file.size());
+
+    if (data && _texture.read(data, _file.size())) return true;
+
+    _file.close();
+    return false;
+}
+
+// Stretched to power of two sides (for mipmaps under plain OpenGL ES 2), or
+// only to whole S3TC blocks, and flipped bottom up, the same way
+// QGLWidget::bindTexture does it.
+void TextureManager::LoadJob::encode(const QImage& image)
+{
+    int width = image.width();
+    int height = image.height();
+
+    if (!_manager._hasNpot)
+    {
+        width = 1;
+        height = 1;
+
+        while (width < image.width()) width *= 2;
+        while (height < image.height()) height *= 2;
+    }
+    else if (_manager._canCompress)
+    {
+        width = (width + 3) & ~3;
+        height = (height + 3) & ~3;
+    }
+
+    TextureFile::Format format =
+        _manager._hasBgra ? TextureFile::Bgra : TextureFile::Rgba;
+
+    if (_manager._canCompress)
+    {
+        bool isBgra;
+        format = ImageResampler::isOpaque(ImageResampler::pixels(image,
+            isBgra)) ? TextureFile::Bc1 : TextureFile::Bc3;
+    }
+
+    _encoded = TextureFile::write(image, width, height, format);
+    _texture.read(reinterpret_cast<const uchar*>(_encoded.constData()),
+        _encoded.size());
+
+    if (_file.fileName().isEmpty()) return;
+
+    QSaveFile file(_file.fileName());
+
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(_encoded);
+        file.commit();
+    }
+}
+
+TextureManager::TextureManager(TextureStreamer& streamer, qint64 budget,
+    const QString& cacheDirectory)
+    : _streamer(streamer), _budget(budget), _cacheDirectory(cacheDirectory),
+    _frame(0)
+{
+    initializeOpenGLFunctions();
+
+    if (_cacheDirectory.isEmpty())
+    {
+        _cacheDirectory = QStandardPaths::writableLocation(
+            QStandardPaths::CacheLocation) + "/textures";
+    }
+
+    QDir().mkpath(_cacheDirectory);
+
+    // ANGLE splits S3TC into one extension per format.
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    _canCompress = context->hasExtension("GL_EXT_texture_compression_s3tc")
+        || (context->hasExtension("GL_EXT_texture_compression_dxt1")
+        && context->hasExtension("GL_ANGLE_texture_compression_dxt5"));
+
+    // OpenGL ES 2 takes non power of two textures, but not with mipmaps.
+    QSurfaceFormat format = context->format();
+    bool isVersion3 = format.majorVersion() >= 3;
+    _isDesktop = !context->isOpenGLES();
+    _hasNpot = _isDesktop || isVersion3
+        || context->hasExtension("GL_OES_texture_npot");
+    _hasBgra = _isDesktop
+        || context->hasExtension("GL_EXT_texture_format_BGRA8888");
+
+    // OpenGL ES 3 only takes sized BGRA storage through the extension.
+    const char* texStorage2D = 0;
+
+    if (_isDesktop)
+    {
+        if (format.version() >= qMakePair(4, 2)
+            || context->hasExtension("GL_ARB_texture_storage"))
+            texStorage2D = "glTexStorage2D";
+    }
+    else if (context->hasExtension("GL_EXT_texture_storage"))
+    {
+        texStorage2D = "glTexStorage2DEXT";
+    }
+    else if (isVersion3 && !_hasBgra)
+    {
+        texStorage2D = "glTexStorage2D";
+    }
+
+    _texStorage2D = texStorage2D ? reinterpret_cast<TexStorage2D>(
+        context->getProcAddress(texStorage2D)) : 0;
+
+    _cacheSuffix = QString(_hasNpot ? ".npot" : "")
+        + (_canCompress ? ".s3tc.ktx" : _hasBgra ? ".bgra.ktx" : ".rgba.ktx");
+
+    _statistics.residentBytes = 0;
+    _statistics.textureCount = 0;
+    _statistics.entryCount = 0;
+    _statistics.requests = 0;
+    _statistics.hits = 0;
+    _statistics.loads = 0;
+    _statistics.cacheHits = 0;
+    _statistics.levelChanges = 0;
+    _statistics.duplicates = 0;
+    _statistics.evictions = 0;
+}
+
+// Any handles still out there must not be used from here on.
+TextureManager::~TextureManager()
+{
+    for (int i = 0; i < _textures.size(); ++i)
+    {
+        if (_textures[i].entries > 0)
+            glDeleteTextures(1, &_textures[i].name);
+    }
+
+    for (int i = 0; i < _entries.size(); ++i)
+        delete _entries[i].source;
+}
+
+QString TextureManager::report() const
+{
+    const Statistics& s = _statistics;
+    float hitRate = s.requests > 0 ? float(s.hits) / float(s.requests) : 0.0f;
+
+    return QString("textures: %1 resident (%2 of %3 KiB), %4 entries, "
+        "%5% hits over %6 requests, %7 loads (%8 from the disk cache), "
+        "%9 duplicates, %10 evictions, %11 mip level changes")
+        .arg(s.textureCount).arg(s.residentBytes / 1024)
+        .arg(_budget / 1024).arg(s.entryCount)
+        .arg(hitRate * 100.0f, 0, 'f', 1).arg(s.requests).arg(s.loads)
+        .arg(s.cacheHits).arg(s.duplicates).arg(s.evictions)
+        .arg(s.levelChanges);
+}
+
+TextureManager::Handle TextureManager::load(const QByteArray& key,
+    Source* source)
+{
+    QHash<QByteArray, int>::ConstIterator i = _entriesByKey.constFind(key);
+
+    if (i != _entriesByKey.constEnd())
+    {
+        delete source;
+        return Handle(this, i.value());
+    }
+
+    int entry;
+
+    if (_freeEntries.isEmpty())
+    {
+        entry = _entries.size();
+        _entries.resize(entry + 1);
+    }
+    else
+    {
+        entry = _freeEntries.last();
+        _freeEntries.removeLast();
+    }
+
+    Entry& e = _entries[entry];
+    e.key = key;
+    e.source = source;
+    e.state = Unloaded;
+    e.references = 0;
+    e.lastUsed = _frame;
+    e.texture = -1;
+    e.hasJob = false;
+
+    _entriesByKey.insert(key, entry);
+    ++_statistics.entryCount;
+
+    return Handle(this, entry);
+}
+
+TextureManager::Handle TextureManager::loadFile(const QString& path)
+{
+    QByteArray key = "file:" + path.toUtf8();
+
+    if (_entriesByKey.contains(key))
+        return Handle(this, _entriesByKey.value(key));
+
+    return load(key, new FileSource(path));
+}
+
+TextureManager::Handle TextureManager::loadPack(const CardPack& pack,
+    const QByteArray& id)
+{
+    QByteArray key = "pack:" + id;
+
+    if (_entriesByKey.contains(key))
+        return Handle(this, _entriesByKey.value(key));
+
+    return load(key, new PackSource(pack, id));
+}
+
+GLuint TextureManager::texture(const Handle& handle, float priority,
+    GLuint fallback, float screenSize)
+{
+    if (handle._manager != this) return fallback;
+
+    Entry& entry = _entries[handle._entry];
+    entry.lastUsed = _frame;
+    ++_statistics.requests;
+
+    switch (entry.state)
+    {
+    case Resident:
+    {
+        ++_statistics.hits;
+        Texture& t = _textures[entry.texture];
+        int wanted = levelFor(t.width, t.height, t.levelCount, screenSize);
+        t.wantedLevel = qMin(t.wantedLevel, wanted);
+
+        if (t.pendingLevel < 0 && !entry.hasJob)
+        {
+            if (wanted < t.level)
+                reload(handle._entry, wanted);
+            else if (t.coarseFrames >= CoarseFrames)
+                reload(handle._entry, t.targetLevel);
+        }
+
+        return t.name;
+    }
+
+    case Unloaded:
+        entry.state = Loading;
+
+        if (!entry.hasJob)
+        {
+            entry.hasJob = true;
+            _streamer.submit(entry.key, new LoadJob(*this, handle._entry, -1,
+                screenSize), priority);
+            break;
+        }
+
+        // An evicted entry still waiting on a level change gets that load.
+        _streamer.prioritize(entry.key, priority);
+        break;
+
+    case Loading:
+        _streamer.prioritize(entry.key, priority);
+        break;
+
+    default:
+        break;
+    }
+
+    return fallback;
+}
+
+void TextureManager::nextFrame()
+{
+    while (_statistics.residentBytes > _budget)
+    {
+        int victim = -1;
+
+        for (int i = 0; i < _entries.size(); ++i)
+        {
+            const Entry& e = _entries[i];
+
+            if (e.state != Resident || e.lastUsed >= _frame) continue;
+
+            if (victim < 0)
+            {
+                victim = i;
+                continue;
+            }
+
+            const Entry& v = _entries[victim];
+            bool isHeld = e.references > 0;
+            bool isVictimHeld = v.references > 0;
+
+            if (isHeld != isVictimHeld ? !isHeld : e.lastUsed < v.lastUsed)
+                victim = i;
+        }
+
+        // Everything resident is on screen; the budget will have to wait.
+        if (victim < 0) break;
+
+        evict(victim);
+    }
+
+    for (int i = 0; i < _textures.size(); ++i)
+    {
+        Texture& t = _textures[i];
+
+        if (t.entries == 0 || t.wantedLevel == INT_MAX) continue;
+
+        if (t.wantedLevel > t.level)
+        {
+            if (t.targetLevel != t.wantedLevel) t.coarseFrames = 0;
+
+            t.targetLevel = t.wantedLevel;
+            ++t.coarseFrames;
+        }
+        else
+        {
+            t.coarseFrames = 0;
+        }
+
+        t.wantedLevel = INT_MAX;
+    }
+
+    ++_frame;
+}
+
+void TextureManager::retain(int entry)
+{
+    ++_entries[entry].references;
+}
+
+void TextureManager::release(int entry)
+{
+    Entry& e = _entries[entry];
+
+    if (--e.references == 0 && !e.hasJob
+        && (e.state == Unloaded || e.state == Missing))
+        destroy(entry);
+}
+
+// Picks the level whose height is closest to (but not below) the screen size,
+// then backs off by the tail.
+int TextureManager::levelFor(int width, int height, int levelCount,
+    float screenSize)
+{
+    if (screenSize <= 0.0f) return 0;
+
+    int size = qMax(width, height);
+    int level = 0;
+
+    while (level + 1 < levelCount && float(size >> (level + 1)) >= screenSize)
+        ++level;
+
+    return qMax(level - TailLevels, 0);
+}
+
+void TextureManager::store(int entry, const TextureFile& file,
+    const QByteArray& hash, int level, float screenSize)
+{
+    Entry& e = _entries[entry];
+    e.hasJob = false;
+
+    if (file.levelCount() == 0)
+    {
+        if (e.state == Loading)
+        {
+            qWarning("Could not load texture %s", e.key.constData());
+            e.state = Missing;
+        }
+        else if (e.state == Resident)
+        {
+            _textures[e.texture].pendingLevel = -1;
+        }
+
+        if (e.references == 0 && e.state != Resident) destroy(entry);
+
+        return;
+    }
+
+    if (level < 0)
+    {
+        level = levelFor(file.width(0), file.height(0), file.levelCount(),
+            screenSize);
+    }
+
+    level = qMin(level, file.levelCount() - 1);
+
+    if (e.state == Resident)
+    {
+        Texture& t = _textures[e.texture];
+        t.pendingLevel = -1;
+        t.coarseFrames = 0;
+
+        if (t.hash == hash && t.level != level)
+        {
+            upload(t, file, level);
+            ++_statistics.levelChanges;
+        }
+
+        return;
+    }
+
+    QHash<QByteArray, int>::ConstIterator i = _texturesByHash.constFind(hash);
+    int texture;
+
+    if (i != _texturesByHash.constEnd())
+    {
+        texture = i.value();
+        ++_statistics.duplicates;
+    }
+    else
+    {
+        if (_freeTextures.isEmpty())
+        {
+            texture = _textures.size();
+            _textures.resize(texture + 1);
+        }
+        else
+        {
+            texture = _freeTextures.last();
+            _freeTextures.removeLast();
+        }
+
+        Texture& t = _textures[texture];
+        t.name = 0;
+        t.hash = hash;
+        t.bytes = 0;
+        t.entries = 0;
+        t.pendingLevel = -1;
+        t.wantedLevel = INT_MAX;
+        t.targetLevel = 0;
+        t.coarseFrames = 0;
+        upload(t, file, level);
+
+        _texturesByHash.insert(hash, texture);
+        ++_statistics.textureCount;
+        ++_statistics.loads;
+    }
+
+    ++_textures[texture].entries;
+    e.texture = texture;
+    e.state = Resident;
+}
+
+// OpenGL ES 2 has no GL_TEXTURE_BASE_LEVEL, so a texture whose first level
+// changes is made anew from the levels it keeps. Callers look names up every
+// frame, so the new name simply takes over. That also suits immutable
+// storage, which could not be given new levels anyway.
+void TextureManager::upload(Texture& texture, const TextureFile& file,
+    int level)
+{
+    if (texture.name) glDeleteTextures(1, &texture.name);
+
+    glGenTextures(1, &texture.name);
+    glBindTexture(GL_TEXTURE_2D, texture.name);
+
+    // OpenGL ES names BGRA as an internal format; desktop OpenGL only as a
+    // layout for RGBA.
+    bool isBgra = file.format() == TextureFile::Bgra && !_isDesktop;
+    GLenum internalFormat = file.internalFormat();
+
+    if (_texStorage2D)
+    {
+        GLenum sizedFormat = internalFormat;
+
+        if (!file.isCompressed())
+            sizedFormat = isBgra ? GL_BGRA8_EXT : GL_RGBA8_OES;
+
+        _texStorage2D(GL_TEXTURE_2D, file.levelCount() - level, sizedFormat,
+            file.width(level), file.height(level));
+    }
+    else if (isBgra)
+    {
+        internalFormat = GL_BGRA_EXT;
+    }
+
+    qint64 bytes = 0;
+
+    for (int i = level; i < file.levelCount(); ++i)
+    {
+        if (file.isCompressed() && _texStorage2D)
+        {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, i - level, 0, 0,
+                file.width(i), file.height(i), internalFormat, file.size(i),
+                file.data(i));
+        }
+        else if (file.isCompressed())
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i - level, internalFormat,
+                file.width(i), file.height(i), 0, file.size(i),
+                file.data(i));
+        }
+        else if (_texStorage2D)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, i - level, 0, 0, file.width(i),
+                file.height(i), file.pixelFormat(), GL_UNSIGNED_BYTE,
+                file.data(i));
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, i - level, internalFormat,
+                file.width(i), file.height(i), 0, file.pixelFormat(),
+                GL_UNSIGNED_BYTE, file.data(i));
+        }
+
+        bytes += file.size(i);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+        GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    _statistics.residentBytes += bytes - texture.bytes;
+    texture.bytes = bytes;
+    texture.width = file.width(0);
+    texture.height = file.height(0);
+    texture.levelCount = file.levelCount();
+    texture.level = level;
+}
+
+// Level changes load the file again (mapped from the cache, usually) ahead
+// of anything that is merely missing.
+void TextureManager::reload(int entry, int level)
+{
+    Entry& e = _entries[entry];
+    _textures[e.texture].pendingLevel = level;
+    e.hasJob = true;
+    _streamer.submit(e.key, new LoadJob(*this, entry, level, 0.0f), 1e30f);
+}
+
+void TextureManager::evict(int entry)
+{
+    Entry& e = _entries[entry];
+    Texture& t = _textures[e.texture];
+
+    // A level change still on its way will arrive as a fresh load instead.
+    if (e.hasJob) t.pendingLevel = -1;
+
+    if (--t.entries == 0)
+    {
+        glDeleteTextures(1, &t.name);
+        _texturesByHash.remove(t.hash);
+        _freeTextures.append(e.texture);
+        _statistics.residentBytes -= t.bytes;
+        --_statistics.textureCount;
+    }
+
+    e.texture = -1;
+    e.state = Unloaded;
+    ++_statistics.evictions;
+
+    if (e.references == 0 && !e.hasJob) destroy(entry);
+}
+
+void TextureManager::destroy(int entry)
+{
+    Entry& e = _entries[entry];
+    delete e.source;
+    e.source = 0;
+    _entriesByKey.remove(e.key);
+    e.key.clear();
+    _freeEntries.append(entry);
+    --_statistics.entryCount;
+}
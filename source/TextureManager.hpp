@@ -0,0 +1,218 @@
+#ifndef TEXTUREMANAGER_HPP
+#define TEXTUREMANAGER_HPP
+
+#include "TextureStreamer.hpp"
+#include "TextureFile.hpp"
+#include "CardPack.hpp"
+#include <QOpenGLFunctions>
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QString>
+#include <QVector>
+
+// Owns every streamed texture. Callers hold handles, which count references
+// to an entry (a texture identified by a key such as a file path or a face
+// key) and look it up each time they draw. An entry that is not resident is
+// loaded on the streamer in the meantime and the caller's fallback is drawn.
+//
+// The first load of a source with a cache key encodes its image, with every
+// mip level, into a KTX file in the cache directory: S3TC compressed if the
+// driver takes it, plain pixels otherwise (in QImage's own BGRA order where
+// the driver allows, so they are never swizzled). Images keep their own size
+// where the driver has mipmapped non power of two textures, and go into
+// immutable storage where it has that. Later loads map that file and upload
+// it as is, skipping decoding, scaling and mipmap generation.
+//
+// Only the mip levels a texture needs are resident. Callers pass how many
+// pixels tall the texture appears on screen, and the finest level worth
+// having (plus one finer for smooth filtering) is what gets uploaded. Finer
+// levels are reloaded from the cache as soon as something is drawn larger;
+// coarser ones replace them after a couple of seconds drawn smaller.
+//
+// Entries whose images turn out identical share one GL texture. Once the
+// resident textures exceed the budget, entries that were not drawn this frame
+// are evicted, those nobody holds a handle to first and the least recently
+// drawn after that; they come back by themselves the next time they are
+// drawn.
+class TextureManager : protected QOpenGLFunctions
+{
+public:
+    // Produces an entry's image. Both functions run on streamer threads and
+    // may run more than once over the life of the entry, so they must be
+    // thread safe. The cache key identifies the image's content; sources
+    // without one are never cached.
+    class Source
+    {
+    public:
+        virtual ~Source() {}
+        virtual QByteArray cacheKey() const { return QByteArray(); }
+        virtual QImage load() const = 0;
+    };
+
+    class Handle
+    {
+    public:
+        Handle();
+        Handle(const Handle& other);
+        ~Handle();
+
+        Handle& operator=(const Handle& other);
+
+        inline bool isNull() const { return !_manager; }
+
+    private:
+        friend class TextureManager;
+
+        Handle(TextureManager* manager, int entry);
+
+        TextureManager* _manager;
+        int _entry;
+    };
+
+    class Statistics
+    {
+    public:
+        qint64 residentBytes;
+        int textureCount;
+        int entryCount;
+        int requests;
+        int hits;
+        int loads;
+        int cacheHits;
+        int levelChanges;
+        int duplicates;
+        int evictions;
+    };
+
+    TextureManager(TextureStreamer& streamer,
+        qint64 budget = 96 * 1024 * 1024,
+        const QString& cacheDirectory = QString());
+    virtual ~TextureManager();
+
+    inline qint64 budget() const { return _budget; }
+    inline void budget(qint64 budget) { _budget = budget; }
+
+    inline const Statistics& statistics() const { return _statistics; }
+    QString report() const;
+
+    // Takes ownership of the source. If an entry with this key exists
+    // already, the source is deleted and the existing entry is returned.
+    Handle load(const QByteArray& key, Source* source);
+    Handle loadFile(const QString& path);
+
+    // The pack has to stay open for as long as the manager is around.
+    Handle loadPack(const CardPack& pack, const QByteArray& id);
+
+    // The texture for the handle if it is resident, or else fallback. A
+    // missing texture is queued with the given priority. A screen size of
+    // zero asks for full resolution.
+    GLuint texture(const Handle& handle, float priority, GLuint fallback = 0,
+        float screenSize = 0.0f);
+
+    // Evicts down to the budget and starts a new frame. Call once per frame,
+    // after drawing.
+    void nextFrame();
+
+private:
+    enum State
+    {
+        Unloaded,
+        Loading,
+        Resident,
+        Missing
+    };
+
+    class Entry
+    {
+    public:
+        QByteArray key;
+        Source* source;
+        State state;
+        int references;
+        int lastUsed;
+        int texture;
+        bool hasJob;
+    };
+
+    // Sizes are those of the full image, of which levels from level on are
+    // resident.
+    class Texture
+    {
+    public:
+        GLuint name;
+        QByteArray hash;
+        qint64 bytes;
+        int entries;
+        int width;
+        int height;
+        int levelCount;
+        int level;
+        int pendingLevel;
+        int wantedLevel;
+        int targetLevel;
+        int coarseFrames;
+    };
+
+    class LoadJob : public TextureStreamer::Job
+    {
+    public:
+        // A level of -1 picks one to suit the screen size.
+        LoadJob(TextureManager& manager, int entry, int level,
+            float screenSize);
+
+        virtual void load();
+        virtual void finish();
+
+    private:
+        bool readCache();
+        void encode(const QImage& image);
+
+        TextureManager& _manager;
+        int _entry;
+        int _level;
+        float _screenSize;
+        const Source* _source;
+        QFile _file;
+        QByteArray _encoded;
+        TextureFile _texture;
+        QByteArray _hash;
+        bool _isCached;
+    };
+
+    void retain(int entry);
+    void release(int entry);
+    static int levelFor(int width, int height, int levelCount,
+        float screenSize);
+
+    void store(int entry, const TextureFile& file, const QByteArray& hash,
+        int level, float screenSize);
+    void upload(Texture& texture, const TextureFile& file, int level);
+    void reload(int entry, int level);
+    void evict(int entry);
+    void destroy(int entry);
+
+    typedef void (QOPENGLF_APIENTRYP TexStorage2D)(GLenum target,
+        GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height);
+
+    TextureStreamer& _streamer;
+    qint64 _budget;
+    QString _cacheDirectory;
+    QString _cacheSuffix;
+    bool _isDesktop;
+    bool _canCompress;
+    bool _hasNpot;
+    bool _hasBgra;
+    TexStorage2D _texStorage2D;
+    int _frame;
+    QVector<Entry> _entries;
+    QVector<int> _freeEntries;
+    QHash<QByteArray, int> _entriesByKey;
+    QVector<Texture> _textures;
+    QVector<int> _freeTextures;
+    QHash<QByteArray, int> _texturesByHash;
+    Statistics _statistics;
+};
+
+#endif
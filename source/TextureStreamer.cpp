@@ -0,0 +1,150 @@
+#include "TextureStreamer.hpp"
+#include <QElapsedTimer>
+
+TextureStreamer::Worker::Worker(TextureStreamer& streamer)
+    : _streamer(streamer)
+{
+}
+
+void TextureStreamer::Worker::run()
+{
+    _streamer.work();
+}
+
+TextureStreamer::TextureStreamer(int threadCount) : _isQuitting(false)
+{
+    if (threadCount < 1) threadCount = QThread::idealThreadCount() - 1;
+    if (threadCount < 1) threadCount = 1;
+
+    for (int i = 0; i < threadCount; ++i)
+    {
+        Worker* worker = new Worker(*this);
+        _workers.append(worker);
+        worker->start(QThread::LowPriority);
+    }
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _isQuitting = true;
+        _wake.wakeAll();
+    }
+
+    for (int i = 0; i < _workers.size(); ++i)
+    {
+        _workers[i]->wait();
+        delete _workers[i];
+    }
+
+    for (int i = 0; i < _waiting.size(); ++i)
+        delete _waiting[i].job;
+
+    for (int i = 0; i < _ready.size(); ++i)
+        delete _ready[i].job;
+}
+
+void TextureStreamer::submit(const QByteArray& key, Job* job, float priority)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_keys.contains(key))
+    {
+        delete job;
+        return;
+    }
+
+    Request request;
+    request.key = key;
+    request.job = job;
+    _waiting.append(request);
+    _priorities.insert(key, priority);
+    _keys.insert(key);
+    _wake.wakeOne();
+}
+
+bool TextureStreamer::prioritize(const QByteArray& key, float priority)
+{
+    QMutexLocker locker(&_mutex);
+    QHash<QByteArray, float>::Iterator i = _priorities.find(key);
+
+    if (i != _priorities.end())
+    {
+        i.value() = priority;
+        return true;
+    }
+
+    return _keys.contains(key);
+}
+
+int TextureStreamer::upload(int budgetMilliseconds)
+{
+    QElapsedTimer timer;
+    timer.start();
+    int result = 0;
+
+    do
+    {
+        Request request;
+
+        {
+            QMutexLocker locker(&_mutex);
+
+            if (_ready.isEmpty()) break;
+
+            request = _ready.takeFirst();
+        }
+
+        request.job->finish();
+        delete request.job;
+        ++result;
+
+        // The key stays taken until the texture exists, so a caller checking
+        // in between does not submit it again.
+        QMutexLocker locker(&_mutex);
+        _keys.remove(request.key);
+    } while (timer.elapsed() < budgetMilliseconds);
+
+    return result;
+}
+
+// The waiting list is short (cards on the table, not cards in the set), so a
+// scan for the most urgent job is cheaper than keeping a heap in order while
+// priorities change every frame.
+void TextureStreamer::work()
+{
+    QMutexLocker locker(&_mutex);
+
+    while (!_isQuitting)
+    {
+        if (_waiting.isEmpty())
+        {
+            _wake.wait(&_mutex);
+            continue;
+        }
+
+        int best = 0;
+        float bestPriority = _priorities.value(_waiting[0].key);
+
+        for (int i = 1; i < _waiting.size(); ++i)
+        {
+            float priority = _priorities.value(_waiting[i].key);
+
+            if (priority > bestPriority)
+            {
+                best = i;
+                bestPriority = priority;
+            }
+        }
+
+        Request request = _waiting.takeAt(best);
+        _priorities.remove(request.key);
+
+        locker.unlock();
+        request.job->load();
+        locker.relock();
+
+        _ready.append(request);
+    }
+}
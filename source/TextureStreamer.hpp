@@ -0,0 +1,80 @@
+#ifndef TEXTURESTREAMER_HPP
+#define TEXTURESTREAMER_HPP
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+// Gets images off disk (or painted) on background threads and onto the GPU
+// a few at a time, so neither startup nor play ever waits on a decode.
+//
+// Each job has two halves: load() runs on a worker thread and keeps whatever
+// it produced, and finish() runs later on the thread that owns the GL context,
+// inside upload(), which stops once its time budget is spent. Workers always
+// take the waiting job with the highest priority, and callers are expected to
+// raise or lower priorities every frame as cards come into or out of view.
+class TextureStreamer
+{
+public:
+    class Job
+    {
+    public:
+        virtual ~Job() {}
+        virtual void load() = 0;
+        virtual void finish() = 0;
+    };
+
+    // A thread count of zero leaves one core for the GUI thread.
+    explicit TextureStreamer(int threadCount = 0);
+    ~TextureStreamer();
+
+    // The streamer takes ownership of the job. Keys identify jobs so the
+    // same texture is not loaded twice.
+    void submit(const QByteArray& key, Job* job, float priority);
+
+    // Returns false if no job with this key is waiting, loading or waiting
+    // to be uploaded. Only jobs that have not started care about priority.
+    bool prioritize(const QByteArray& key, float priority);
+
+    // Finishes loaded jobs until the budget runs out. At least one is
+    // finished if any are ready, so uploads always make progress.
+    int upload(int budgetMilliseconds);
+
+private:
+    class Request
+    {
+    public:
+        QByteArray key;
+        Job* job;
+    };
+
+    class Worker : public QThread
+    {
+    public:
+        Worker(TextureStreamer& streamer);
+
+    protected:
+        virtual void run();
+
+    private:
+        TextureStreamer& _streamer;
+    };
+
+    void work();
+
+    QMutex _mutex;
+    QWaitCondition _wake;
+    QList<Request> _waiting;
+    QList<Request> _ready;
+    QHash<QByteArray, float> _priorities;
+    QSet<QByteArray> _keys;
+    QVector<Worker*> _workers;
+    bool _isQuitting;
+};
+
+#endif
@@ -0,0 +1,380 @@
+#include "Tweener.hpp"
+
+Tweener::Tweener(int capacity) : _time(0.0f)
+{
+    Q_ASSERT(capacity <= IndexMask + 1);
+
+    _tweens.resize(capacity);
+    _free.reserve(capacity);
+    _active.reserve(capacity);
+
+    for (int i = capacity - 1; i >= 0; --i)
+    {
+        _tweens[i].state = Free;
+        _tweens[i].generation = 0;
+        _free.append(i);
+    }
+}
+
+Tweener::~Tweener()
+{
+}
+
+bool Tweener::update(float time)
+{
+    _time = time;
+
+    // Finished tweens are swapped out from under the loop, and the tweens
+    // chained to them are appended, so the bound is re-read every pass.
+    int i = 0;
+
+    while (i < _active.size())
+    {
+        int index = _active[i];
+        Tween& tween = _tweens[index];
+
+        if (time < tween.start)
+        {
+            ++i;
+            continue;
+        }
+
+        if (tween.state == Scheduled) begin(tween);
+
+        float t = tween.duration > 0.0f
+            ? (time - tween.start) / tween.duration : 1.0f;
+
+        if (t < 1.0f)
+        {
+            apply(tween, ease(tween.easing, t));
+            ++i;
+        }
+        else
+        {
+            apply(tween, 1.0f);
+            _active[i] = _active.last();
+            _active.removeLast();
+            finish(index);
+        }
+    }
+
+    return _free.size() < _tweens.size();
+}
+
+void Tweener::clear()
+{
+    _free.clear();
+    _active.clear();
+
+    for (int i = _tweens.size() - 1; i >= 0; --i)
+    {
+        if (_tweens[i].state != Free) release(i);
+        else _free.append(i);
+    }
+}
+
+int Tweener::moveCard(CardActor& card, const QVector3D& position,
+    float duration, Easing easing, float delay, int after)
+{
+    float to[4] = { position.x(), position.y(), position.z(), 0.0f };
+    return add(CardPosition, &card, 0, to, duration, easing, delay, after);
+}
+
+int Tweener::rotateCard(CardActor& card, const Rotation& rotation,
+    float duration, Easing easing, float delay, int after)
+{
+    float to[4] = { rotation.toRadians(), 0.0f, 0.0f, 0.0f };
+    return add(CardRotation, &card, 0, to, duration, easing, delay, after);
+}
+
+int Tweener::flipCard(CardActor& card, const Rotation& flip, float duration,
+    Easing easing, float delay, int after)
+{
+    float to[4] = { flip.toRadians(), 0.0f, 0.0f, 0.0f };
+    return add(CardFlip, &card, 0, to, duration, easing, delay, after);
+}
+
+int Tweener::highlightCard(CardActor& card, const QVector4D& highlight,
+    float duration, Easing easing, float delay, int after)
+{
+    float to[4] = { highlight.x(), highlight.y(), highlight.z(),
+        highlight.w() };
+    return add(CardHighlight, &card, 0, to, duration, easing, delay, after);
+}
+
+int Tweener::moveCamera(Camera& camera, const QVector3D& position,
+    float duration, Easing easing, float delay, int after)
+{
+    float to[4] = { position.x(), position.y(), position.z(), 0.0f };
+    return add(CameraPosition, 0, &camera, to, duration, easing, delay,
+        after);
+}
+
+int Tweener::zoomCamera(Camera& camera, float distance, float duration,
+    Easing easing, float delay, int after)
+{
+    float to[4] = { distance, 0.0f, 0.0f, 0.0f };
+    return add(CameraDistance, 0, &camera, to, duration, easing, delay,
+        after);
+}
+
+int Tweener::orbitCamera(Camera& camera, const Rotation& rotation,
+    const Rotation& angle, float duration, Easing easing, float delay,
+    int after)
+{
+    float to[4] = { rotation.toRadians(), angle.toRadians(), 0.0f, 0.0f };
+    return add(CameraOrbit, 0, &camera, to, duration, easing, delay, after);
+}
+
+float Tweener::ease(int easing, float t)
+{
+    switch (easing)
+    {
+        case EaseIn: return t * t;
+        case EaseOut: return t * (2.0f - t);
+        case EaseInOut: return t * t * (3.0f - 2.0f * t);
+        default: return t;
+    }
+}
+
+int Tweener::add(int property, CardActor* card, Camera* camera,
+    const float* to, float duration, Easing easing, float delay, int after)
+{
+    if (_free.isEmpty()) return NoTween;
+
+    int index = _free.last();
+    _free.removeLast();
+
+    Tween& tween = _tweens[index];
+    tween.card = card;
+    tween.camera = camera;
+    tween.property = property;
+    tween.easing = easing;
+    tween.delay = delay;
+    tween.duration = duration;
+    tween.next = NoTween;
+    tween.sibling = NoTween;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        tween.from[i] = 0.0f;
+        tween.to[i] = to[i];
+    }
+
+    int previous = find(after);
+
+    if (previous != NoTween)
+    {
+        tween.state = Waiting;
+        tween.sibling = _tweens[previous].next;
+        _tweens[previous].next = index;
+    }
+    else
+    {
+        schedule(index, _time);
+    }
+
+    return name(index);
+}
+
+int Tweener::find(int name) const
+{
+    int index = name & IndexMask;
+
+    if (name < 0 || index >= _tweens.size()
+        || _tweens[index].state == Free || this->name(index) != name)
+        return NoTween;
+
+    return index;
+}
+
+void Tweener::schedule(int tween, float start)
+{
+    Tween& t = _tweens[tween];
+    t.state = Scheduled;
+    t.start = start + t.delay;
+    replace(tween);
+    _active.append(tween);
+}
+
+// Rotations are stored as a starting angle and the shortest signed turn that
+// reaches the target, so a card never spins the long way around.
+void Tweener::begin(Tween& tween)
+{
+    tween.state = Running;
+
+    switch (tween.property)
+    {
+        case CardPosition:
+        {
+            const QVector3D& p = tween.card->position();
+            tween.from[0] = p.x();
+            tween.from[1] = p.y();
+            tween.from[2] = p.z();
+            break;
+        }
+
+        case CardRotation:
+        {
+            Rotation r = tween.card->rotation();
+            tween.from[0] = r.toRadians();
+            tween.to[0] = (Rotation::fromRadians(tween.to[0]) - r)
+                .toRadians();
+            break;
+        }
+
+        case CardFlip:
+        {
+            Rotation f = tween.card->flip();
+            tween.from[0] = f.toRadians();
+            tween.to[0] = (Rotation::fromRadians(tween.to[0]) - f)
+                .toRadians();
+            break;
+        }
+
+        case CardHighlight:
+        {
+            const QVector4D& h = tween.card->highlight();
+            tween.from[0] = h.x();
+            tween.from[1] = h.y();
+            tween.from[2] = h.z();
+            tween.from[3] = h.w();
+            break;
+        }
+
+        case CameraPosition:
+        {
+            const QVector3D& p = tween.camera->position();
+            tween.from[0] = p.x();
+            tween.from[1] = p.y();
+            tween.from[2] = p.z();
+            break;
+        }
+
+        case CameraDistance:
+            tween.from[0] = tween.camera->distance();
+            break;
+
+        case CameraOrbit:
+        {
+            Rotation r = tween.camera->rotation();
+            Rotation a = tween.camera->angle();
+            tween.from[0] = r.toRadians();
+            tween.from[1] = a.toRadians();
+            tween.to[0] = (Rotation::fromRadians(tween.to[0]) - r)
+                .toRadians();
+            tween.to[1] = (Rotation::fromRadians(tween.to[1]) - a)
+                .toRadians();
+            break;
+        }
+
+        default: break;
+    }
+}
+
+void Tweener::apply(const Tween& tween, float e)
+{
+    const float* a = tween.from;
+    const float* b = tween.to;
+
+    switch (tween.property)
+    {
+        case CardPosition:
+            tween.card->position(QVector3D(a[0] + (b[0] - a[0]) * e,
+                a[1] + (b[1] - a[1]) * e, a[2] + (b[2] - a[2]) * e));
+            break;
+
+        case CardRotation:
+            tween.card->rotation(Rotation::fromRadians(a[0] + b[0] * e));
+            break;
+
+        case CardFlip:
+            tween.card->flip(Rotation::fromRadians(a[0] + b[0] * e));
+            break;
+
+        case CardHighlight:
+            tween.card->highlight(QVector4D(a[0] + (b[0] - a[0]) * e,
+                a[1] + (b[1] - a[1]) * e, a[2] + (b[2] - a[2]) * e,
+                a[3] + (b[3] - a[3]) * e));
+            break;
+
+        case CameraPosition:
+            tween.camera->position(QVector3D(a[0] + (b[0] - a[0]) * e,
+                a[1] + (b[1] - a[1]) * e, a[2] + (b[2] - a[2]) * e));
+            break;
+
+        case CameraDistance:
+            tween.camera->distance(a[0] + (b[0] - a[0]) * e);
+            break;
+
+        case CameraOrbit:
+            tween.camera->rotation(Rotation::fromRadians(a[0] + b[0] * e));
+            tween.camera->angle(Rotation::fromRadians(a[1] + b[1] * e));
+            break;
+
+        default: break;
+    }
+}
+
+// Chained tweens are timed from the moment their predecessor was due to end
+// rather than from the frame that noticed, so long chains do not drift.
+void Tweener::finish(int tween)
+{
+    Tween& t = _tweens[tween];
+    float end = t.start + t.duration;
+    int next = t.next;
+
+    release(tween);
+
+    while (next != NoTween)
+    {
+        int sibling = _tweens[next].sibling;
+        schedule(next, end);
+        next = sibling;
+    }
+}
+
+// The tweens being dropped are all taken out of the active list before any of
+// their chains are scheduled, since scheduling reorders the list. A tween
+// that is scheduled or running has no further use for its sibling link, so
+// that strings them together meanwhile.
+void Tweener::replace(int tween)
+{
+    const Tween& t = _tweens[tween];
+    int dropped = NoTween;
+    int i = 0;
+
+    while (i < _active.size())
+    {
+        int index = _active[i];
+        Tween& other = _tweens[index];
+
+        if (other.property == t.property && other.card == t.card
+            && other.camera == t.camera)
+        {
+            _active[i] = _active.last();
+            _active.removeLast();
+            other.sibling = dropped;
+            dropped = index;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    while (dropped != NoTween)
+    {
+        int sibling = _tweens[dropped].sibling;
+        finish(dropped);
+        dropped = sibling;
+    }
+}
+
+void Tweener::release(int tween)
+{
+    Tween& t = _tweens[tween];
+    t.state = Free;
+    t.generation = (t.generation + 1) & (0x7fffffff >> IndexBits);
+    _free.append(tween);
+}
@@ -0,0 +1,132 @@
+#ifndef TWEENER_HPP
+#define TWEENER_HPP
+
+#include "Animation.hpp"
+#include "CardActor.hpp"
+#include "Camera.hpp"
+#include <QVector>
+
+// Runs every card and camera tween as a single Animation. Tweens live in a
+// fixed pool that is allocated up front, and each frame walks a dense list of
+// the active ones, so dealing or shuffling a whole deck neither allocates nor
+// makes a virtual call per tween.
+//
+// All times are in seconds. A tween's starting value is captured when it
+// actually begins, which lets chained tweens pick up where the previous one
+// left off. Only one tween at a time animates a given property of a card or
+// the camera: once a tween is scheduled, any other scheduled or running tween
+// on the same property is dropped, as if it had finished where it stands,
+// so the newest tween takes over from wherever the property has got to.
+//
+// Tweens are named by an index into the pool tagged with a generation that
+// changes each time the slot is reused, so a name kept after its tween has
+// finished never refers to a later one.
+class Tweener : public Animation
+{
+public:
+    static const int NoTween = -1;
+
+    enum Easing
+    {
+        Linear,
+        EaseIn,
+        EaseOut,
+        EaseInOut
+    };
+
+    explicit Tweener(int capacity = 1024);
+    virtual ~Tweener();
+
+    virtual bool update(float time);
+    void clear();
+
+    inline float time() const { return _time; }
+    inline int activeCount() const { return _active.size(); }
+    inline bool isFull() const { return _free.isEmpty(); }
+
+    // Each of these starts after the given delay, or (when after names a
+    // tween that has not finished yet) that long after that tween finishes.
+    // They return NoTween if the pool is exhausted.
+    int moveCard(CardActor& card, const QVector3D& position, float duration,
+        Easing easing = EaseInOut, float delay = 0.0f, int after = NoTween);
+    int rotateCard(CardActor& card, const Rotation& rotation, float duration,
+        Easing easing = EaseInOut, float delay = 0.0f, int after = NoTween);
+    int flipCard(CardActor& card, const Rotation& flip, float duration,
+        Easing easing = EaseInOut, float delay = 0.0f, int after = NoTween);
+    int highlightCard(CardActor& card, const QVector4D& highlight,
+        float duration, Easing easing = Linear, float delay = 0.0f,
+        int after = NoTween);
+    int moveCamera(Camera& camera, const QVector3D& position, float duration,
+        Easing easing = EaseInOut, float delay = 0.0f, int after = NoTween);
+    int zoomCamera(Camera& camera, float distance, float duration,
+        Easing easing = EaseInOut, float delay = 0.0f, int after = NoTween);
+    int orbitCamera(Camera& camera, const Rotation& rotation,
+        const Rotation& angle, float duration, Easing easing = EaseInOut,
+        float delay = 0.0f, int after = NoTween);
+
+private:
+    enum Property
+    {
+        CardPosition,
+        CardRotation,
+        CardFlip,
+        CardHighlight,
+        CameraPosition,
+        CameraDistance,
+        CameraOrbit
+    };
+
+    enum State
+    {
+        Free,
+        Waiting,
+        Scheduled,
+        Running
+    };
+
+    class Tween
+    {
+    public:
+        CardActor* card;
+        Camera* camera;
+        int property;
+        int easing;
+        int state;
+        float delay;
+        float start;
+        float duration;
+        float from[4];
+        float to[4];
+        int next;
+        int sibling;
+        int generation;
+    };
+
+    static const int IndexBits = 16;
+    static const int IndexMask = (1 << IndexBits) - 1;
+
+    static float ease(int easing, float t);
+
+    inline int name(int tween) const
+    {
+        return (_tweens[tween].generation << IndexBits) | tween;
+    }
+
+    int find(int name) const;
+
+    int add(int property, CardActor* card, Camera* camera, const float* to,
+        float duration, Easing easing, float delay, int after);
+    void schedule(int tween, float start);
+    void begin(Tween& tween);
+    void apply(const Tween& tween, float e);
+    void finish(int tween);
+    void replace(int tween);
+    void release(int tween);
+
+    float _time;
+    QVector<Tween> _tweens;
+    QVector<int> _free;
+    QVector<int> _active;
+};
+
+#endif
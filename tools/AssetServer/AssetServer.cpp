@@ -0,0 +1,302 @@
+#include "AssetServer.hpp"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QStringList>
+#include <QUrl>
+
+static const qint64 SliceSize = 64 * 1024;
+
+AssetServer::AssetServer(const QString& inDirectory, QObject* inParent)
+    : QObject(inParent), mDirectory(inDirectory), mDropAfter(-1)
+{
+    connect(&mServer, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+AssetServer::~AssetServer()
+{
+    QHash<QTcpSocket*, Connection>::Iterator i = mConnections.begin();
+
+    for (; i != mConnections.end(); ++i)
+        delete i.value().file;
+}
+
+bool AssetServer::listen(quint16 inPort)
+{
+    return mServer.listen(QHostAddress::LocalHost, inPort);
+}
+
+void AssetServer::onNewConnection()
+{
+    while (QTcpSocket* socket = mServer.nextPendingConnection())
+    {
+        Connection connection;
+        connection.file = 0;
+        connection.remaining = 0;
+        connection.sent = 0;
+        connection.isClosing = false;
+        mConnections.insert(socket, connection);
+
+        connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(socket, SIGNAL(bytesWritten(qint64)), this,
+            SLOT(onBytesWritten()));
+
+        // abort() and disconnectFromHost() can emit disconnected() on the
+        // spot, in the middle of a slot still holding on to the connection,
+        // so it is only forgotten once control is back in the event loop.
+        connect(socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()),
+            Qt::QueuedConnection);
+    }
+}
+
+/// Requests are answered one at a time; any that arrive while a body is
+/// still going out wait in the buffer.
+void AssetServer::onReadyRead()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    QHash<QTcpSocket*, Connection>::Iterator i = mConnections.find(socket);
+
+    if (i == mConnections.end()) return;
+
+    Connection& connection = i.value();
+    connection.request.append(socket->readAll());
+
+    while (!connection.file && !connection.isClosing)
+    {
+        int end = connection.request.indexOf("\r\n\r\n");
+
+        if (end < 0) break;
+
+        QByteArray header = connection.request.left(end);
+        connection.request.remove(0, end + 4);
+        respond(socket, connection, header);
+    }
+}
+
+void AssetServer::onBytesWritten()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    QHash<QTcpSocket*, Connection>::Iterator i = mConnections.find(socket);
+
+    if (i == mConnections.end()) return;
+
+    sendBody(socket, i.value());
+
+    // The next request may already be waiting.
+    if (!i.value().file && !i.value().request.isEmpty())
+        QMetaObject::invokeMethod(socket, "readyRead", Qt::QueuedConnection);
+}
+
+void AssetServer::onDisconnected()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    delete mConnections.value(socket).file;
+    mConnections.remove(socket);
+    socket->deleteLater();
+}
+
+void AssetServer::respond(QTcpSocket* inSocket, Connection& inConnection,
+    const QByteArray& inHeader)
+{
+    QList<QByteArray> lines = inHeader.split('\n');
+    QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    QByteArray range;
+    QByteArray ifRange;
+
+    for (int i = 1; i < lines.size(); ++i)
+    {
+        QByteArray line = lines[i].trimmed();
+        int colon = line.indexOf(':');
+
+        if (colon < 0) continue;
+
+        QByteArray name = line.left(colon).trimmed().toLower();
+        QByteArray value = line.mid(colon + 1).trimmed();
+
+        if (name == "range")
+            range = value;
+        else if (name == "if-range")
+            ifRange = value;
+        else if (name == "connection" && value.toLower() == "close")
+            inConnection.isClosing = true;
+    }
+
+    if (requestLine.size() != 3)
+    {
+        inConnection.isClosing = true;
+        sendError(inSocket, inConnection, 400, "Bad Request");
+        return;
+    }
+
+    QByteArray method = requestLine[0];
+
+    if (requestLine[2] == "HTTP/1.0") inConnection.isClosing = true;
+
+    if (method != "GET" && method != "HEAD")
+    {
+        sendError(inSocket, inConnection, 405, "Method Not Allowed");
+        return;
+    }
+
+    QString path = QUrl::fromPercentEncoding(
+        requestLine[1].split('?').first());
+    QString name = QDir::cleanPath(mDirectory.absolutePath() + "/" + path);
+    QFileInfo info(name);
+
+    if (!name.startsWith(mDirectory.absolutePath() + "/") || !info.isFile())
+    {
+        sendError(inSocket, inConnection, 404, "Not Found");
+        return;
+    }
+
+    qint64 size = info.size();
+
+    // A changed file gets a changed tag, and a range asked for against an
+    // older one is answered with the whole file.
+    QByteArray tag = "\"" + QByteArray::number(size) + "-"
+        + QByteArray::number(info.lastModified().toMSecsSinceEpoch()) + "\"";
+
+    if (!ifRange.isEmpty() && ifRange != tag) range.clear();
+
+    qint64 first = 0;
+    qint64 last = size - 1;
+    bool isPartial = false;
+
+    if (range.startsWith("bytes=") && !range.contains(','))
+    {
+        QList<QByteArray> bounds = range.mid(6).split('-');
+        bool isValid = bounds.size() == 2;
+
+        if (isValid && bounds[0].isEmpty())
+        {
+            // A suffix range: the last so many bytes.
+            qint64 count = bounds[1].toLongLong(&isValid);
+            first = qMax(size - count, qint64(0));
+        }
+        else if (isValid)
+        {
+            first = bounds[0].toLongLong(&isValid);
+
+            if (isValid && !bounds[1].isEmpty())
+                last = qMin(bounds[1].toLongLong(&isValid), size - 1);
+        }
+
+        if (isValid && first >= size)
+        {
+            inSocket->write("HTTP/1.1 416 Range Not Satisfiable\r\n"
+                "Content-Range: bytes */" + QByteArray::number(size)
+                + "\r\nContent-Length: 0\r\n\r\n");
+
+            if (inConnection.isClosing) inSocket->disconnectFromHost();
+            return;
+        }
+
+        isPartial = isValid && first <= last;
+
+        if (!isPartial)
+        {
+            first = 0;
+            last = size - 1;
+        }
+    }
+
+    QByteArray response = isPartial ? "HTTP/1.1 206 Partial Content\r\n"
+        : "HTTP/1.1 200 OK\r\n";
+    response += "Accept-Ranges: bytes\r\n";
+    response += "ETag: " + tag + "\r\n";
+    response += "Content-Type: application/octet-stream\r\n";
+    response += "Content-Length: " + QByteArray::number(last - first + 1)
+        + "\r\n";
+
+    if (isPartial)
+    {
+        response += "Content-Range: bytes " + QByteArray::number(first) + "-"
+            + QByteArray::number(last) + "/" + QByteArray::number(size)
+            + "\r\n";
+    }
+
+    if (inConnection.isClosing) response += "Connection: close\r\n";
+
+    response += "\r\n";
+    inSocket->write(response);
+
+    if (method == "HEAD" || last < first)
+    {
+        if (inConnection.isClosing) inSocket->disconnectFromHost();
+        return;
+    }
+
+    inConnection.file = new QFile(name);
+
+    if (!inConnection.file->open(QIODevice::ReadOnly)
+        || !inConnection.file->seek(first))
+    {
+        // Too late for an error status; cut the body short instead.
+        delete inConnection.file;
+        inConnection.file = 0;
+        inConnection.isClosing = true;
+        inSocket->disconnectFromHost();
+        return;
+    }
+
+    inConnection.remaining = last - first + 1;
+    inConnection.sent = 0;
+    sendBody(inSocket, inConnection);
+}
+
+void AssetServer::sendError(QTcpSocket* inSocket, Connection& inConnection,
+    int inStatus, const char* inReason)
+{
+    QByteArray body = QByteArray::number(inStatus) + " " + inReason + "\n";
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(inStatus) + " "
+        + inReason + "\r\nContent-Type: text/plain\r\nContent-Length: "
+        + QByteArray::number(body.size()) + "\r\n";
+
+    if (inConnection.isClosing) response += "Connection: close\r\n";
+
+    inSocket->write(response + "\r\n" + body);
+
+    if (inConnection.isClosing) inSocket->disconnectFromHost();
+}
+
+/// Only one slice is queued at a time, so the socket's buffer stays small
+/// however large the file is.
+void AssetServer::sendBody(QTcpSocket* inSocket, Connection& inConnection)
+{
+    if (!inConnection.file || inSocket->bytesToWrite() > 0) return;
+
+    if (mDropAfter >= 0 && inConnection.sent >= mDropAfter)
+    {
+        delete inConnection.file;
+        inConnection.file = 0;
+        inConnection.isClosing = true;
+        inSocket->abort();
+        return;
+    }
+
+    qint64 count = qMin(SliceSize, inConnection.remaining);
+
+    if (mDropAfter >= 0)
+        count = qMin(count, mDropAfter - inConnection.sent);
+
+    QByteArray slice = inConnection.file->read(count);
+
+    if (slice.isEmpty() && count > 0)
+    {
+        delete inConnection.file;
+        inConnection.file = 0;
+        inConnection.isClosing = true;
+        inSocket->disconnectFromHost();
+        return;
+    }
+
+    inSocket->write(slice);
+    inConnection.remaining -= slice.size();
+    inConnection.sent += slice.size();
+
+    if (inConnection.remaining > 0) return;
+
+    delete inConnection.file;
+    inConnection.file = 0;
+
+    if (inConnection.isClosing) inSocket->disconnectFromHost();
+}
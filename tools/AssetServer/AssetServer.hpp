@@ -0,0 +1,56 @@
+#ifndef ASSETSERVER_HPP
+#define ASSETSERVER_HPP
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+/// Answers GET and HEAD requests for files under one directory. Connections
+/// stay open between requests unless the client asks otherwise, and a Range
+/// header of the form bytes=first- or bytes=first-last gets a 206 with just
+/// that part, unless an If-Range header names an ETag other than the file's
+/// current one. Bodies are sent a slice at a time as the socket drains, so
+/// large files are never read into memory whole.
+class AssetServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    AssetServer(const QString& inDirectory, QObject* inParent = 0);
+    ~AssetServer();
+
+    bool listen(quint16 inPort);
+    inline void setDropAfter(qint64 inBytes) { mDropAfter = inBytes; }
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onBytesWritten();
+    void onDisconnected();
+
+private:
+    struct Connection
+    {
+        QByteArray request;
+        QFile* file;
+        qint64 remaining;
+        qint64 sent;
+        bool isClosing;
+    };
+
+    void respond(QTcpSocket* inSocket, Connection& inConnection,
+        const QByteArray& inHeader);
+    void sendError(QTcpSocket* inSocket, Connection& inConnection,
+        int inStatus, const char* inReason);
+    void sendBody(QTcpSocket* inSocket, Connection& inConnection);
+
+    QTcpServer mServer;
+    QDir mDirectory;
+    qint64 mDropAfter;
+    QHash<QTcpSocket*, Connection> mConnections;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# Serves a directory over HTTP/1.1 with keep-alive and byte ranges, as a
+# local stand-in for the asset server the download manager talks to:
+#
+#   AssetServer directory [port] [--drop-after bytes]
+#
+# --drop-after closes every connection once that many bytes of a body have
+# gone out, to exercise resuming.
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+TARGET = AssetServer
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+SOURCES += main.cpp \
+    AssetServer.cpp
+
+HEADERS  += AssetServer.hpp
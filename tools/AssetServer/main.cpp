@@ -0,0 +1,41 @@
+#include "AssetServer.hpp"
+#include <QCoreApplication>
+#include <QStringList>
+#include <cstdio>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList arguments = a.arguments();
+    qint64 dropAfter = -1;
+    int drop = arguments.indexOf("--drop-after");
+
+    if (drop > 0 && drop + 1 < arguments.size())
+    {
+        dropAfter = arguments[drop + 1].toLongLong();
+        arguments.removeAt(drop + 1);
+        arguments.removeAt(drop);
+    }
+
+    if (arguments.size() < 2 || arguments.size() > 3)
+    {
+        fprintf(stderr, "usage: AssetServer directory [port] "
+            "[--drop-after bytes]\n");
+        return 1;
+    }
+
+    quint16 port = arguments.size() > 2 ? arguments[2].toUShort() : 8080;
+    AssetServer server(arguments[1]);
+    server.setDropAfter(dropAfter);
+
+    if (!server.listen(port))
+    {
+        fprintf(stderr, "could not listen on port %u\n", unsigned(port));
+        return 1;
+    }
+
+    printf("serving %s on http://127.0.0.1:%u/\n", qPrintable(arguments[1]),
+        unsigned(port));
+    fflush(stdout);
+    return a.exec();
+}
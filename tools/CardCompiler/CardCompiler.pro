@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# Compiles a CSV or tab separated export of the card pool into the mapped
+# card database DEJARIX reads card details from:
+#
+#   CardCompiler cards.csv cards.db
+#   CardCompiler --search cards.db query
+#   CardCompiler --benchmark [cards]
+#
+# The first row names the columns: id, name, set, type, side, rarity, lore
+# and text, in any order and case. Only id and name are required; other
+# columns are ignored. --benchmark times searches over a synthetic card
+# pool, 20000 cards unless told otherwise.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = CardCompiler
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../../source
+
+SOURCES += main.cpp \
+    ../../source/CardDatabase.cpp \
+    ../../source/PostingList.cpp
+
+HEADERS  += ../../source/CardDatabase.hpp \
+    ../../source/PostingList.hpp
@@ -0,0 +1,380 @@
+#include "CardDatabase.hpp"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <algorithm>
+#include <cstdio>
+
+// Quoted values may hold separators, line breaks and doubled quotes.
+static QList<QStringList> readRows(const QString& text, QChar separator)
+{
+    QList<QStringList> result;
+    QStringList row;
+    QString value;
+    bool isQuoted = false;
+
+    for (int i = 0; i < text.size(); ++i)
+    {
+        QChar c = text[i];
+
+        if (isQuoted)
+        {
+            if (c != '"')
+                value += c;
+            else if (i + 1 < text.size() && text[i + 1] == '"')
+                value += text[++i];
+            else
+                isQuoted = false;
+        }
+        else if (c == '"')
+        {
+            isQuoted = true;
+        }
+        else if (c == separator)
+        {
+            row.append(value);
+            value.clear();
+        }
+        else if (c == '\n')
+        {
+            row.append(value);
+            value.clear();
+            result.append(row);
+            row.clear();
+        }
+        else if (c != '\r')
+        {
+            value += c;
+        }
+    }
+
+    if (!value.isEmpty() || !row.isEmpty())
+    {
+        row.append(value);
+        result.append(row);
+    }
+
+    return result;
+}
+
+static int compile(const QStringList& arguments)
+{
+    QFile input(arguments[1]);
+
+    if (!input.open(QIODevice::ReadOnly))
+    {
+        fprintf(stderr, "could not read %s\n", qPrintable(arguments[1]));
+        return 1;
+    }
+
+    QString text = QString::fromUtf8(input.readAll());
+    QString firstLine = text.left(text.indexOf('\n'));
+    QChar separator = firstLine.contains('\t') ? '\t' : ',';
+    QList<QStringList> rows = readRows(text, separator);
+
+    if (rows.isEmpty())
+    {
+        fprintf(stderr, "%s is empty\n", qPrintable(arguments[1]));
+        return 1;
+    }
+
+    int columns[CardDatabase::FieldCount];
+
+    for (int i = 0; i < CardDatabase::FieldCount; ++i)
+    {
+        CardDatabase::Field field = CardDatabase::Field(i);
+        columns[i] = -1;
+
+        for (int j = 0; j < rows[0].size(); ++j)
+        {
+            if (!rows[0][j].trimmed().compare(
+                CardDatabase::fieldName(field), Qt::CaseInsensitive))
+                columns[i] = j;
+        }
+    }
+
+    if (columns[CardDatabase::Id] < 0 || columns[CardDatabase::Name] < 0)
+    {
+        fprintf(stderr, "%s needs id and name columns\n",
+            qPrintable(arguments[1]));
+        return 1;
+    }
+
+    QList<CardDatabase::Card> cards;
+
+    for (int i = 1; i < rows.size(); ++i)
+    {
+        const QStringList& row = rows[i];
+
+        if (row.size() == 1 && row[0].trimmed().isEmpty()) continue;
+
+        CardDatabase::Card card;
+
+        for (int j = 0; j < CardDatabase::FieldCount; ++j)
+        {
+            if (columns[j] >= 0 && columns[j] < row.size())
+                card.fields[j] = row[columns[j]].trimmed();
+        }
+
+        if (card.fields[CardDatabase::Id].isEmpty())
+        {
+            fprintf(stderr, "%s: row %d has no id\n",
+                qPrintable(arguments[1]), i + 1);
+            return 1;
+        }
+
+        cards.append(card);
+    }
+
+    if (!CardDatabase::write(arguments[2], cards))
+    {
+        fprintf(stderr, "could not write %s; are the ids unique?\n",
+            qPrintable(arguments[2]));
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    CardDatabase database;
+
+    if (!database.open(arguments[2]) || database.count() != cards.size())
+    {
+        fprintf(stderr, "%s did not read back\n", qPrintable(arguments[2]));
+        return 1;
+    }
+
+    printf("%d cards in %s, opened in %lld us, %lld KiB\n", database.count(),
+        qPrintable(arguments[2]), (long long)(timer.nsecsElapsed() / 1000),
+        (long long)(QFile(arguments[2]).size() / 1024));
+    return 0;
+}
+
+static int search(const QStringList& arguments)
+{
+    CardDatabase database;
+
+    if (!database.open(arguments[2]))
+    {
+        fprintf(stderr, "could not open %s\n", qPrintable(arguments[2]));
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<CardDatabase::Match> matches =
+        database.search(QStringList(arguments.mid(3)).join(" "), 20);
+    qint64 nanoseconds = timer.nsecsElapsed();
+
+    for (int i = 0; i < matches.size(); ++i)
+    {
+        printf("%6.2f  %s  %s\n", matches[i].score,
+            database.utf8(matches[i].card, CardDatabase::Id).constData(),
+            database.utf8(matches[i].card, CardDatabase::Name).constData());
+    }
+
+    printf("%d shown in %lld us\n", matches.size(),
+        (long long)(nanoseconds / 1000));
+    return 0;
+}
+
+// The same numbers on every machine, so runs can be compared.
+class Random
+{
+public:
+    Random() : _state(Q_UINT64_C(0x9e3779b97f4a7c15)) {}
+
+    quint32 next()
+    {
+        _state ^= _state << 13;
+        _state ^= _state >> 7;
+        _state ^= _state << 17;
+        return quint32(_state >> 32);
+    }
+
+    inline int below(int count) { return int(next() % quint32(count)); }
+
+private:
+    quint64 _state;
+};
+
+// Words are made of syllables and drawn by Zipf's law, as in real text: the
+// commonest few are in most cards, and most are in only a handful.
+class Corpus
+{
+public:
+    Corpus(Random& random, int wordCount) : _random(random)
+    {
+        static const char* const Syllables[] =
+        {
+            "ka", "ro", "vi", "den", "sar", "tu", "mo", "lek", "an", "dro",
+            "je", "bi", "ith", "or", "ne", "wa", "za", "qui", "fel", "om"
+        };
+
+        double total = 0.0;
+
+        for (int i = 0; i < wordCount; ++i)
+        {
+            QString word;
+            int length = 2 + random.below(3);
+
+            for (int j = 0; j < length; ++j)
+                word += Syllables[random.below(20)];
+
+            _words.append(word + QString::number(i, 36));
+            total += 1.0 / (i + 1);
+            _cumulative.append(total);
+        }
+
+        for (int i = 0; i < wordCount; ++i)
+            _cumulative[i] /= total;
+    }
+
+    inline const QString& word(int rank) const { return _words[rank]; }
+
+    QString words(int count)
+    {
+        QStringList result;
+
+        for (int i = 0; i < count; ++i)
+        {
+            double x = (_random.next() + 0.5) / 4294967296.0;
+            int rank = int(std::lower_bound(_cumulative.begin(),
+                _cumulative.end(), x) - _cumulative.begin());
+            result.append(_words[qMin(rank, _words.size() - 1)]);
+        }
+
+        return result.join(" ");
+    }
+
+private:
+    Random& _random;
+    QStringList _words;
+    QVector<double> _cumulative;
+};
+
+static void measure(const CardDatabase& database, const char* name,
+    const QStringList& queries)
+{
+    QElapsedTimer timer;
+    qint64 results = 0;
+    timer.start();
+
+    for (int i = 0; i < queries.size(); ++i)
+        results += database.search(queries[i], 20).size();
+
+    qint64 nanoseconds = timer.nsecsElapsed();
+    qint64 matches = 0;
+
+    for (int i = 0; i < queries.size(); ++i)
+        matches += database.search(queries[i]).size();
+
+    printf("%-24s %8.1f us  %8.1f matches\n", name,
+        nanoseconds / 1000.0 / queries.size(),
+        double(matches) / queries.size());
+}
+
+static int benchmark(const QStringList& arguments)
+{
+    int cardCount = arguments.size() > 2 ? arguments[2].toInt() : 20000;
+
+    if (cardCount <= 0)
+    {
+        fprintf(stderr, "usage: CardCompiler --benchmark [cards]\n");
+        return 1;
+    }
+
+    Random random;
+    Corpus corpus(random, 20000);
+    QList<CardDatabase::Card> cards;
+
+    for (int i = 0; i < cardCount; ++i)
+    {
+        CardDatabase::Card card;
+        card.fields[CardDatabase::Id] = QString("card%1").arg(i, 6, 10,
+            QChar('0'));
+        card.fields[CardDatabase::Name] = corpus.words(2 + random.below(2));
+        card.fields[CardDatabase::Lore] = corpus.words(10 + random.below(16));
+        card.fields[CardDatabase::Text] = corpus.words(20 + random.below(21));
+        cards.append(card);
+    }
+
+    QString path = QDir::tempPath() + "/CardCompiler-benchmark.db";
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!CardDatabase::write(path, cards))
+    {
+        fprintf(stderr, "could not write %s\n", qPrintable(path));
+        return 1;
+    }
+
+    qint64 milliseconds = timer.elapsed();
+    CardDatabase database;
+
+    if (!database.open(path))
+    {
+        fprintf(stderr, "%s did not read back\n", qPrintable(path));
+        return 1;
+    }
+
+    printf("%d cards, %lld KiB, built in %lld ms\n", database.count(),
+        (long long)(QFile(path).size() / 1024), (long long)milliseconds);
+
+    QStringList common;
+    QStringList rare;
+    QStringList both;
+    QStringList lopsided;
+    QStringList either;
+    QStringList prefix;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        QString a = corpus.word(random.below(20));
+        QString b = corpus.word(20 + random.below(200));
+        QString c = corpus.word(1000 + random.below(10000));
+
+        common.append(a);
+        rare.append(c);
+        both.append(corpus.word(random.below(50)) + " " + b);
+        lopsided.append(a + " " + c);
+        either.append(b + " OR " + c);
+        prefix.append(b.left(3) + "*");
+    }
+
+    measure(database, "common word", common);
+    measure(database, "rare word", rare);
+    measure(database, "two words", both);
+    measure(database, "common and rare word", lopsided);
+    measure(database, "either of two words", either);
+    measure(database, "prefix of three letters", prefix);
+
+    database.close();
+    QFile::remove(path);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList arguments = a.arguments();
+
+    if (arguments.size() >= 4 && arguments[1] == "--search")
+        return search(arguments);
+
+    if (arguments.size() >= 2 && arguments[1] == "--benchmark")
+        return benchmark(arguments);
+
+    if (arguments.size() != 3 || arguments[1].startsWith("--"))
+    {
+        fprintf(stderr, "usage: CardCompiler cards.csv cards.db\n"
+            "       CardCompiler --search cards.db query\n"
+            "       CardCompiler --benchmark [cards]\n");
+        return 1;
+    }
+
+    return compile(arguments);
+}
@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Packs loose card images into the single mapped file DEJARIX reads them
+# from, and publishes and applies chunked updates to packs:
+#
+#   CardPacker cards.pack image...
+#   CardPacker --publish cards.pack directory version
+#   CardPacker --update cards.pack directory version
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = CardPacker
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../../source
+
+SOURCES += main.cpp \
+    ../../source/CardPack.cpp \
+    ../../source/PackUpdater.cpp
+
+HEADERS  += ../../source/CardPack.hpp \
+    ../../source/PackUpdater.hpp
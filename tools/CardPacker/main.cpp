@@ -0,0 +1,110 @@
+#include "CardPack.hpp"
+#include "PackUpdater.hpp"
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <cstdio>
+
+static int publish(const QStringList& arguments)
+{
+    if (!PackUpdater::publish(arguments[2], arguments[3], arguments[4]))
+    {
+        fprintf(stderr, "could not publish %s\n", qPrintable(arguments[2]));
+        return 1;
+    }
+
+    return 0;
+}
+
+// Run on a copy of an older version to see what an update would cost.
+static int update(const QStringList& arguments)
+{
+    PackUpdater::DirectorySource source(arguments[3]);
+    PackUpdater updater(source);
+    bool isUpdated = updater.update(arguments[2], arguments[4]);
+
+    printf("%s\n", qPrintable(updater.report()));
+
+    if (!isUpdated)
+    {
+        fprintf(stderr, "could not update %s\n", qPrintable(arguments[2]));
+        return 1;
+    }
+
+    return 0;
+}
+
+// Each image is filed under its file name without directory or extension,
+// which is the ID the game looks it up by.
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList arguments = a.arguments();
+
+    if (arguments.size() == 5 && arguments[1] == "--publish")
+        return publish(arguments);
+
+    if (arguments.size() == 5 && arguments[1] == "--update")
+        return update(arguments);
+
+    if (arguments.size() < 3 || arguments[1].startsWith("--"))
+    {
+        fprintf(stderr, "usage: CardPacker output.pack image...\n"
+            "       CardPacker --publish pack directory version\n"
+            "       CardPacker --update pack directory version\n");
+        return 1;
+    }
+
+    QMap<QByteArray, QByteArray> images;
+    qint64 bytes = 0;
+
+    for (int i = 2; i < arguments.size(); ++i)
+    {
+        QFile file(arguments[i]);
+
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            fprintf(stderr, "could not read %s\n", qPrintable(arguments[i]));
+            return 1;
+        }
+
+        QByteArray id = QFileInfo(arguments[i]).completeBaseName().toUtf8();
+
+        if (images.contains(id))
+        {
+            fprintf(stderr, "%s: %s is already packed\n",
+                qPrintable(arguments[i]), id.constData());
+            return 1;
+        }
+
+        QByteArray data = file.readAll();
+
+        if (CardPack::detect(data) == CardPack::Other)
+        {
+            fprintf(stderr, "%s: not PNG, JPEG or GIF; packing it anyway\n",
+                qPrintable(arguments[i]));
+        }
+
+        images.insert(id, data);
+        bytes += data.size();
+    }
+
+    if (!CardPack::write(arguments[1], images))
+    {
+        fprintf(stderr, "could not write %s\n", qPrintable(arguments[1]));
+        return 1;
+    }
+
+    CardPack pack;
+
+    if (!pack.open(arguments[1]))
+    {
+        fprintf(stderr, "%s did not read back\n", qPrintable(arguments[1]));
+        return 1;
+    }
+
+    printf("%d images, %lld KiB, in %s\n", pack.count(),
+        (long long)(bytes / 1024), qPrintable(arguments[1]));
+    return 0;
+}
@@ -0,0 +1,41 @@
+#-------------------------------------------------
+#
+# Times the card grid Droideka uses for hover and drop-target queries
+# against the scan over every card it replaced, on synthetic tables:
+#
+#   GridBenchmark [cards...]
+#
+# Each table is a random spread of piles of one to four cards, some of them
+# turned sideways, at roughly the density of a real game. Without arguments,
+# tables of 40, 1000, 5000 and 20000 cards are measured. The cards need a GL
+# context for their model, so a hidden GL widget provides one.
+#
+#-------------------------------------------------
+
+QT       += core gui opengl
+
+TARGET = GridBenchmark
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../../old
+
+SOURCES += main.cpp \
+    ../../old/Actor.cpp \
+    ../../old/CardActor.cpp \
+    ../../old/CardGrid.cpp \
+    ../../old/CardModel.cpp \
+    ../../old/CardPile.cpp \
+    ../../old/IndexBufferObject.cpp \
+    ../../old/TransformHierarchy.cpp \
+    ../../old/VertexBufferObject.cpp
+
+HEADERS  += ../../old/Actor.hpp \
+    ../../old/CardActor.hpp \
+    ../../old/CardGrid.hpp \
+    ../../old/CardModel.hpp \
+    ../../old/CardPile.hpp \
+    ../../old/IndexBufferObject.hpp \
+    ../../old/TransformHierarchy.hpp \
+    ../../old/VertexBufferObject.hpp
@@ -0,0 +1,195 @@
+#include "CardActor.hpp"
+#include "CardGrid.hpp"
+#include "CardModel.hpp"
+#include "CardPile.hpp"
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QGLWidget>
+#include <QStringList>
+#include <QVector>
+#include <cmath>
+#include <cstdio>
+
+static const int QueryCount = 2000;
+
+static quint64 randomState = Q_UINT64_C(0x9e3779b97f4a7c15);
+
+static float randomBelow(float inLimit)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return float(quint32(randomState >> 32)) / 4294967296.0f * inLimit;
+}
+
+/// the linear scan the canvas used before the grid
+static CardActor* scanTopAt(const QList<CardActor*>& inCardActors, float inX,
+    float inY)
+{
+    CardActor* outCardActor = 0;
+
+    for (int i = 0; i < inCardActors.size(); ++i)
+    {
+        CardActor* ca = inCardActors[i];
+
+        if (ca->contains(inX, inY)
+            && (!outCardActor || ca->z() > outCardActor->z()))
+            outCardActor = ca;
+    }
+
+    return outCardActor;
+}
+
+static void measure(CardModel& inCardModel, Actor& inParent, int inCardCount)
+{
+    QList<CardActor*> cardActors;
+    QList<CardPile*> piles;
+
+    // About a fifth of the table is covered, as in a game with a few
+    // locations and the cards deployed to them.
+    float side = sqrtf(float(inCardCount) * inCardModel.width()
+        * inCardModel.height() * 5.0f);
+
+    while (cardActors.size() < inCardCount)
+    {
+        CardPile* pile = new CardPile(randomBelow(side), randomBelow(side));
+        int size = 1 + int(randomBelow(4.0f));
+
+        for (int i = 0; i < size && cardActors.size() < inCardCount; ++i)
+        {
+            CardActor* cardActor = new CardActor(inCardModel, 0, 0, inParent);
+            cardActor->setPosition(randomBelow(1.0f), randomBelow(1.0f));
+
+            if (randomBelow(4.0f) < 1.0f) cardActor->rotate90();
+
+            pile->push(*cardActor);
+            cardActors.append(cardActor);
+        }
+
+        piles.append(pile);
+    }
+
+    CardGrid grid(qMax(inCardModel.width(), inCardModel.height()));
+
+    for (int i = 0; i < cardActors.size(); ++i)
+        grid.insert(*cardActors[i]);
+
+    QVector<float> points;
+    QVector<CardActor*> targets;
+
+    for (int i = 0; i < QueryCount; ++i)
+    {
+        points.append(randomBelow(side));
+        points.append(randomBelow(side));
+        targets.append(cardActors[int(randomBelow(float(inCardCount)))]);
+    }
+
+    QVector<CardActor*> gridTops(QueryCount);
+    QVector<CardActor*> scanTops(QueryCount);
+    QVector<CardActor*> candidates;
+    int gridOverlaps = 0;
+    int scanOverlaps = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+
+    for (int i = 0; i < QueryCount; ++i)
+        gridTops[i] = grid.topAt(points[i * 2], points[i * 2 + 1]);
+
+    qint64 gridTopTime = timer.nsecsElapsed();
+    timer.restart();
+
+    for (int i = 0; i < QueryCount; ++i)
+        scanTops[i] = scanTopAt(cardActors, points[i * 2], points[i * 2 + 1]);
+
+    qint64 scanTopTime = timer.nsecsElapsed();
+    timer.restart();
+
+    // A drop query looks for everything under the footprint of the card
+    // being dragged.
+    for (int i = 0; i < QueryCount; ++i)
+    {
+        CardActor* ca = targets[i];
+        candidates.clear();
+        grid.findOverlapping(ca->x() - ca->radiusX(), ca->y() - ca->radiusY(),
+            ca->x() + ca->radiusX(), ca->y() + ca->radiusY(), candidates);
+
+        for (int j = 0; j < candidates.size(); ++j)
+        {
+            if (candidates[j]->overlaps(*ca)) ++gridOverlaps;
+        }
+    }
+
+    qint64 gridOverlapTime = timer.nsecsElapsed();
+    timer.restart();
+
+    for (int i = 0; i < QueryCount; ++i)
+    {
+        for (int j = 0; j < cardActors.size(); ++j)
+        {
+            if (cardActors[j]->overlaps(*targets[i])) ++scanOverlaps;
+        }
+    }
+
+    qint64 scanOverlapTime = timer.nsecsElapsed();
+    int mismatches = gridOverlaps != scanOverlaps ? 1 : 0;
+
+    // Cards at the same height tie, and either may come out on top.
+    for (int i = 0; i < QueryCount; ++i)
+    {
+        if (!gridTops[i] != !scanTops[i]
+            || (gridTops[i] && gridTops[i]->z() != scanTops[i]->z()))
+            ++mismatches;
+    }
+
+    printf("%6d cards  point %8.2f us  scan %9.2f us  rectangle %8.2f us"
+        "  scan %9.2f us  %d mismatches\n", inCardCount,
+        gridTopTime / 1000.0 / QueryCount, scanTopTime / 1000.0 / QueryCount,
+        gridOverlapTime / 1000.0 / QueryCount,
+        scanOverlapTime / 1000.0 / QueryCount, mismatches);
+
+    grid.clear();
+
+    while (!cardActors.isEmpty())
+        delete cardActors.takeFirst();
+
+    while (!piles.isEmpty())
+        delete piles.takeFirst();
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+    QStringList arguments = a.arguments();
+    QList<int> cardCounts;
+
+    for (int i = 1; i < arguments.size(); ++i)
+    {
+        int cardCount = arguments[i].toInt();
+
+        if (cardCount <= 0)
+        {
+            fprintf(stderr, "usage: GridBenchmark [cards...]\n");
+            return 1;
+        }
+
+        cardCounts.append(cardCount);
+    }
+
+    if (cardCounts.isEmpty())
+        cardCounts << 40 << 1000 << 5000 << 20000;
+
+    QGLWidget widget;
+    widget.makeCurrent();
+
+    TransformHierarchy hierarchy;
+    Actor root(hierarchy);
+    CardModel cardModel;
+
+    printf("%d queries of each kind, time per query\n", QueryCount);
+
+    for (int i = 0; i < cardCounts.size(); ++i)
+        measure(cardModel, root, cardCounts[i]);
+
+    return 0;
+}